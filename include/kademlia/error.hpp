@@ -74,6 +74,8 @@ enum error_type
     TIMER_MALFUNCTION,
     /// Another call to session::run() is still blocked.
     ALREADY_RUNNING,
+    /// A routing table snapshot file is corrupted.
+    INVALID_ROUTING_TABLE_SNAPSHOT,
 };
 
 /**
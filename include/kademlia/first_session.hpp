@@ -31,6 +31,7 @@
 #endif
 
 #include <memory>
+#include <string>
 #include <system_error>
 
 #include <kademlia/detail/symbol_visibility.hpp>
@@ -87,6 +88,34 @@ public:
         ( first_session const& )
         = delete;
 
+    /**
+     *  @brief Write the routing table into a snapshot file.
+     *  @details This call must not be concurrent with first_session::run().
+     *
+     *  @param path The snapshot file path, overwritten if it exists.
+     *  @return The failure reason if any.
+     */
+    KADEMLIA_SYMBOL_VISIBILITY
+    std::error_code
+    save_routing_table
+        ( std::string const& path );
+
+    /**
+     *  @brief Fill the routing table from a snapshot file.
+     *  @details This allows a restarted first_session to
+     *           answer requests with a populated routing table.
+     *           Loaded peers aren't contacted upfront, a peer is
+     *           evicted if it fails to answer its first request.
+     *           This call must not be concurrent with first_session::run().
+     *
+     *  @param path The snapshot file path.
+     *  @return The failure reason if any.
+     */
+    KADEMLIA_SYMBOL_VISIBILITY
+    std::error_code
+    load_routing_table
+        ( std::string const& path );
+
     /**
      *  @brief This <b>blocking call</b> execute the first_session main loop.
      *
@@ -31,6 +31,8 @@
 #endif
 
 #include <memory>
+#include <string>
+#include <vector>
 #include <system_error>
 
 #include <kademlia/detail/symbol_visibility.hpp>
@@ -65,6 +67,29 @@ public:
         , endpoint const& listen_on_ipv4 = endpoint{ "0.0.0.0", DEFAULT_PORT }
         , endpoint const& listen_on_ipv6 = endpoint{ "::", DEFAULT_PORT } );
 
+    /**
+     *  @brief Construct an active session restarting
+     *         from a session::save_routing_table() snapshot.
+     *  @details The session takes back the id and the peers it had.
+     *           Once the initial peer has answered, only the k-buckets
+     *           left empty are refreshed. Restored peers aren't
+     *           contacted upfront, a peer is evicted if it fails to
+     *           answer its first request. If the snapshot can't be
+     *           read, the session starts with a new id.
+     *
+     *  @param initial_peer In order to discover network peers, the session
+     *         contacts this peer and retrieve it's neighbors.
+     *  @param routing_table_path The snapshot file path.
+     *  @param listen_on_ipv4 IPv4 listening endpoint.
+     *  @param listen_on_ipv6 IPv6 listening endpoint.
+     */
+    KADEMLIA_SYMBOL_VISIBILITY
+    session
+        ( endpoint const& initial_peer
+        , std::string const& routing_table_path
+        , endpoint const& listen_on_ipv4 = endpoint{ "0.0.0.0", DEFAULT_PORT }
+        , endpoint const& listen_on_ipv6 = endpoint{ "::", DEFAULT_PORT } );
+
     /**
      *  @brief Destruct the session.
      */
@@ -103,6 +128,8 @@ public:
 
     /**
      *  @brief Async load a data from the network.
+     *  @details A data stored on this session by other
+     *           peers is returned without any network request.
      *
      *  @param key The data to save key.
      *  @param handler Callback called to report call status.
@@ -113,6 +140,120 @@ public:
         ( key_type const& key
         , load_handler_type handler );
 
+    /**
+     *  @brief Async load a data from the network.
+     *
+     *  @param key The data to save key.
+     *  @param handler Callback called to report call status.
+     *  @param policy Use LOAD_FROM_NETWORK to skip the local copy.
+     */
+    KADEMLIA_SYMBOL_VISIBILITY
+    void
+    async_load
+        ( key_type const& key
+        , load_handler_type handler
+        , load_policy policy );
+
+    /**
+     *  @brief Async save many datas into the network.
+     *  @details Keys sharing their first bits share their
+     *           lookup, and the datas sent to the same peer
+     *           are grouped into few messages.
+     *
+     *  @param keys The datas to save keys.
+     *  @param datas The datas to save, in the keys order.
+     *  @param handler Callback called with the status of each key.
+     *  @throw std::system_error If keys and datas sizes differ.
+     */
+    KADEMLIA_SYMBOL_VISIBILITY
+    void
+    async_save_many
+        ( std::vector< key_type > const& keys
+        , std::vector< data_type > const& datas
+        , save_many_handler_type handler );
+
+    /**
+     *  @brief Async save many datas into the network.
+     *  @details With no keys, the handler is called at once.
+     *
+     *  @param keys The datas to save keys.
+     *  @param datas The datas to save, in the keys order.
+     *  @param handler Callback called once all datas have been
+     *         handled, with the first failure if any.
+     *  @throw std::system_error If keys and datas sizes differ.
+     */
+    KADEMLIA_SYMBOL_VISIBILITY
+    void
+    async_save_many
+        ( std::vector< key_type > const& keys
+        , std::vector< data_type > const& datas
+        , save_handler_type handler );
+
+    /**
+     *  @brief Async load many datas from the network.
+     *  @details Keys sharing their first bits share their
+     *           lookup, and the keys asked to the same peer
+     *           are grouped into few messages.
+     *
+     *  @param keys The datas to load keys.
+     *  @param handler Callback called with the status of each key.
+     *  @param policy Use LOAD_FROM_NETWORK to skip the local copies.
+     */
+    KADEMLIA_SYMBOL_VISIBILITY
+    void
+    async_load_many
+        ( std::vector< key_type > const& keys
+        , load_many_handler_type handler
+        , load_policy policy = LOAD_LOCAL_FIRST );
+
+    /**
+     *  @brief Async load many datas from the network.
+     *  @details With no keys, the handler is called at once.
+     *
+     *  @param keys The datas to load keys.
+     *  @param handler Callback called once all datas have been
+     *         handled, with the first failure if any and the
+     *         datas in the keys order, empty when not found.
+     *  @param policy Use LOAD_FROM_NETWORK to skip the local copies.
+     */
+    KADEMLIA_SYMBOL_VISIBILITY
+    void
+    async_load_many
+        ( std::vector< key_type > const& keys
+        , batch_load_handler_type handler
+        , load_policy policy = LOAD_LOCAL_FIRST );
+
+    /**
+     *  @brief Write the routing table into a snapshot file.
+     *  @details This call must not be concurrent with session::run().
+     *
+     *  @param path The snapshot file path, overwritten if it exists.
+     *  @return The failure reason if any.
+     */
+    KADEMLIA_SYMBOL_VISIBILITY
+    std::error_code
+    save_routing_table
+        ( std::string const& path );
+
+    /**
+     *  @brief Fill the routing table from a snapshot file.
+     *  @details The session id is kept, use the snapshot
+     *           constructor to restart with the saved one.
+     *           When called before session::run(), the lookups
+     *           refreshing every k-bucket after the neighbors
+     *           discovery start from the loaded peers.
+     *           Loaded peers aren't contacted upfront, a peer is
+     *           evicted if it fails to answer its first request.
+     *           This call must not be concurrent with session::run().
+     *
+     *  @param path The snapshot file path.
+     *  @return The failure reason if any.
+     */
+    KADEMLIA_SYMBOL_VISIBILITY
+    std::error_code
+    load_routing_table
+        ( std::string const& path );
+
     /**
      *  @brief This <b>blocking call</b> execute the session main loop.
      *  @details Callbacks are executed inside this call.
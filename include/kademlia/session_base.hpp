@@ -61,6 +61,35 @@ public:
                 , data_type const& data )
             >;
 
+    /// The callback type called for each key of an async batch save.
+    using save_many_handler_type = std::function
+            < void
+                ( std::size_t key_index
+                , std::error_code const& error )
+            >;
+    /// The callback type called for each key of an async batch load.
+    using load_many_handler_type = std::function
+            < void
+                ( std::size_t key_index
+                , std::error_code const& error
+                , data_type const& data )
+            >;
+    /// The callback type called once an async batch load completed.
+    using batch_load_handler_type = std::function
+            < void
+                ( std::error_code const& error
+                , std::vector< data_type > const& datas )
+            >;
+
+    /// Where an async load reads the data from.
+    enum load_policy
+    {
+        /// Use the copy held by this session if any.
+        LOAD_LOCAL_FIRST,
+        /// Always query the network.
+        LOAD_FROM_NETWORK,
+    };
+
     /// This kademlia implementation default port.
     enum { DEFAULT_PORT = 27980U };
 
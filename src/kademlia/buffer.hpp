@@ -31,6 +31,7 @@
 #endif
 
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
 namespace kademlia {
@@ -38,6 +39,39 @@ namespace detail {
 
 using buffer = std::vector< std::uint8_t >;
 
+/**
+ *  @brief Range of bytes read in place from a buffer.
+ *  @note It's valid as long as the buffer it refers to.
+ */
+struct buffer_view final
+{
+    ///
+    buffer::const_iterator
+    begin
+        ( void )
+        const
+    { return begin_; }
+
+    ///
+    buffer::const_iterator
+    end
+        ( void )
+        const
+    { return end_; }
+
+    ///
+    std::size_t
+    size
+        ( void )
+        const
+    { return std::size_t( end_ - begin_ ); }
+
+    ///
+    buffer::const_iterator begin_;
+    ///
+    buffer::const_iterator end_;
+};
+
 } // namespace detail
 } // namespace kademlia
 
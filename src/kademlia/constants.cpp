@@ -34,6 +34,17 @@ std::size_t const REDUNDANT_SAVE_COUNT{ 3 };
 
 std::chrono::milliseconds const INITIAL_CONTACT_RECEIVE_TIMEOUT{ 1000 };
 std::chrono::milliseconds const PEER_LOOKUP_TIMEOUT{ 20 };
+std::chrono::milliseconds const PEER_LIVENESS_TIMEOUT{ 1000 };
+std::chrono::seconds const CACHED_VALUE_TTL{ 3600 };
+std::size_t const CACHED_VALUES_MAX_COUNT{ 4096 };
+
+std::size_t const BATCH_KEY_PREFIX_BIT_SIZE{ 8 };
+std::size_t const BATCH_MESSAGE_MAX_SIZE{ 1400 };
+std::size_t const BATCH_RESPONSE_MAX_SIZE{ 65000 };
+
+std::size_t const LOOKUP_CACHE_MAX_SIZE{ 256 };
+std::size_t const LOOKUP_CACHE_PREFIX_BIT_SIZE{ 16 };
+std::chrono::seconds const LOOKUP_CACHE_TTL{ 30 };
 
 } // namespace detail
 } // namespace kademlia
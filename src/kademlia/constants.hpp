@@ -46,6 +46,27 @@ extern std::size_t const REDUNDANT_SAVE_COUNT;
 extern std::chrono::milliseconds const INITIAL_CONTACT_RECEIVE_TIMEOUT;
 //
 extern std::chrono::milliseconds const PEER_LOOKUP_TIMEOUT;
+// Delay granted to a least recently seen peer before it's evicted.
+extern std::chrono::milliseconds const PEER_LIVENESS_TIMEOUT;
+// Lifetime of a value cached on the lookup path.
+extern std::chrono::seconds const CACHED_VALUE_TTL;
+// Count of values cached on behalf of other peers.
+extern std::size_t const CACHED_VALUES_MAX_COUNT;
+
+// Least count of leading bits shared by the keys of a batch
+// served by one lookup, more are used in larger networks.
+extern std::size_t const BATCH_KEY_PREFIX_BIT_SIZE;
+// Size of batch requests, under the usual path MTU.
+extern std::size_t const BATCH_MESSAGE_MAX_SIZE;
+// Size of batch responses, under the UDP datagram limit.
+extern std::size_t const BATCH_RESPONSE_MAX_SIZE;
+
+// Count of key prefixes whose closest peers are remembered.
+extern std::size_t const LOOKUP_CACHE_MAX_SIZE;
+// Leading bits shared by the keys served by one cache entry.
+extern std::size_t const LOOKUP_CACHE_PREFIX_BIT_SIZE;
+// Delay after which the closest peers are looked up again.
+extern std::chrono::seconds const LOOKUP_CACHE_TTL;
 
 } // namespace detail
 } // namespace kademlia
@@ -31,6 +31,8 @@
 #endif
 
 #include <algorithm>
+#include <cassert>
+#include <numeric>
 #include <stdexcept>
 #include <queue>
 #include <chrono>
@@ -39,9 +41,14 @@
 #include <utility>
 #include <type_traits>
 #include <functional>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
 #include <boost/asio/io_service.hpp>
 
 #include <kademlia/endpoint.hpp>
+#include <kademlia/session_base.hpp>
 #include "kademlia/error_impl.hpp"
 
 #include "kademlia/log.hpp"
@@ -50,21 +57,33 @@
 #include "kademlia/response_router.hpp"
 #include "kademlia/network.hpp"
 #include "kademlia/message.hpp"
+#include "kademlia/peer_statistics.hpp"
 #include "kademlia/routing_table.hpp"
+#include "kademlia/routing_table_snapshot.hpp"
 #include "kademlia/value_store.hpp"
+#include "kademlia/value_cache.hpp"
 #include "kademlia/find_value_task.hpp"
+#include "kademlia/find_values_task.hpp"
+#include "kademlia/find_peers_task.hpp"
+#include "kademlia/key_batch.hpp"
 #include "kademlia/store_value_task.hpp"
 #include "kademlia/discover_neighbors_task.hpp"
 #include "kademlia/notify_peer_task.hpp"
 #include "kademlia/tracker.hpp"
+#include "kademlia/timer.hpp"
 
 namespace kademlia {
 namespace detail {
 
 /**
- *
+ *  @tparam RoutingTableType The routing table policy,
+ *          e.g. routing_table or split_routing_table
+ *          (smaller but sending more packets per lookup).
  */
-template< typename KeyType, typename DataType, typename UnderlyingSocketType >
+template< typename KeyType
+        , typename DataType
+        , typename UnderlyingSocketType
+        , typename RoutingTableType = routing_table< ip_endpoint > >
 class engine final
 {
 public:
@@ -78,7 +97,7 @@ public:
     using endpoint_type = ip_endpoint;
 
     ///
-    using routing_table_type = routing_table< endpoint_type >;
+    using routing_table_type = RoutingTableType;
 
     ///
     using value_store_type = value_store< id, data_type >;
@@ -91,7 +110,8 @@ public:
         ( boost::asio::io_service & io_service
         , endpoint const& ipv4
         , endpoint const& ipv6 )
-            : random_engine_( std::random_device{}() )
+            : io_service_( io_service )
+            , random_engine_( std::random_device{}() )
             , my_id_( random_engine_ )
             , network_( io_service
                       , message_socket_type::ipv4( io_service, ipv4 )
@@ -104,11 +124,18 @@ public:
             , tracker_( io_service
                       , my_id_
                       , network_
-                      , random_engine_ )
+                      , routing_table_ )
             , routing_table_( my_id_ )
+            , closest_peers_()
             , value_store_()
+            , cached_values_( CACHED_VALUES_MAX_COUNT )
             , is_connected_()
             , pending_tasks_()
+            , lookup_statistics_()
+            , lookup_cache_( LOOKUP_CACHE_MAX_SIZE
+                           , LOOKUP_CACHE_TTL
+                           , LOOKUP_CACHE_PREFIX_BIT_SIZE )
+            , pending_loads_()
     { }
 
     /**
@@ -119,7 +146,8 @@ public:
         , endpoint const& initial_peer
         , endpoint const& ipv4
         , endpoint const& ipv6 )
-            : random_engine_( std::random_device()() )
+            : io_service_( io_service )
+            , random_engine_( std::random_device()() )
             , my_id_( random_engine_ )
             , network_( io_service
                       , message_socket_type::ipv4( io_service, ipv4 )
@@ -132,11 +160,18 @@ public:
             , tracker_( io_service
                       , my_id_
                       , network_
-                      , random_engine_ )
+                      , routing_table_ )
             , routing_table_( my_id_ )
+            , closest_peers_()
             , value_store_()
+            , cached_values_( CACHED_VALUES_MAX_COUNT )
             , is_connected_()
             , pending_tasks_()
+            , lookup_statistics_()
+            , lookup_cache_( LOOKUP_CACHE_MAX_SIZE
+                           , LOOKUP_CACHE_TTL
+                           , LOOKUP_CACHE_PREFIX_BIT_SIZE )
+            , pending_loads_()
     {
         discover_neighbors( initial_peer );
 
@@ -144,6 +179,54 @@ public:
                 << initial_peer << "'." << std::endl;
     }
 
+    /**
+     *  Restart a peer from a routing table snapshot,
+     *  i.e. with its previous id and peers.
+     *  @note The restored peers already cover most of the
+     *        k_buckets, hence once the initial peer has been
+     *        contacted, only the empty ones are refreshed.
+     */
+    engine
+        ( boost::asio::io_service & io_service
+        , endpoint const& initial_peer
+        , endpoint const& ipv4
+        , endpoint const& ipv6
+        , routing_table_snapshot const& snapshot )
+            : io_service_( io_service )
+            , random_engine_( std::random_device()() )
+            , my_id_( snapshot.my_id_ )
+            , network_( io_service
+                      , message_socket_type::ipv4( io_service, ipv4 )
+                      , message_socket_type::ipv6( io_service, ipv6 )
+                      , std::bind( &engine::handle_new_message
+                                 , this
+                                 , std::placeholders::_1
+                                 , std::placeholders::_2
+                                 , std::placeholders::_3 ) )
+            , tracker_( io_service
+                      , my_id_
+                      , network_
+                      , routing_table_ )
+            , routing_table_( my_id_ )
+            , closest_peers_()
+            , value_store_()
+            , cached_values_( CACHED_VALUES_MAX_COUNT )
+            , is_connected_()
+            , pending_tasks_()
+            , lookup_statistics_()
+            , lookup_cache_( LOOKUP_CACHE_MAX_SIZE
+                           , LOOKUP_CACHE_TTL
+                           , LOOKUP_CACHE_PREFIX_BIT_SIZE )
+            , pending_loads_()
+    {
+        restore_peers( snapshot.peers_ );
+        discover_neighbors( initial_peer, true );
+
+        LOG_DEBUG( engine, this ) << "restarting with '"
+                << routing_table_.peer_count() << "' peer(s) using peer '"
+                << initial_peer << "'." << std::endl;
+    }
+
     /**
      *
      */
@@ -187,23 +270,42 @@ public:
             LOG_DEBUG( engine, this ) << "executing async save of key '"
                     << to_string( key ) << "'." << std::endl;
 
-            start_store_value_task( id( key )
-                                  , data
-                                  , tracker_
-                                  , routing_table_
-                                  , std::forward< HandlerType >( handler ) );
+            save_value( id( key ), data
+                      , std::forward< HandlerType >( handler ) );
         }
     }
 
     /**
-     *
+     *  @brief Load the value of key, from the values
+     *         stored on this peer first unless
+     *         policy is LOAD_FROM_NETWORK.
      */
     template< typename HandlerType >
     void
     async_load
         ( key_type const& key
-        , HandlerType && handler )
+        , HandlerType && handler
+        , session_base::load_policy policy = session_base::LOAD_LOCAL_FIRST )
     {
+        id const key_id{ key };
+
+        if ( policy == session_base::LOAD_LOCAL_FIRST )
+        {
+            if ( auto const found = find_local_value( key_id ) )
+            {
+                LOG_DEBUG( engine, this ) << "loading key '"
+                        << to_string( key ) << "' locally." << std::endl;
+
+                // Keep the handler from being called
+                // from within this call.
+                auto const data = *found;
+                auto h = std::forward< HandlerType >( handler );
+                io_service_.post( [ h, data ] ( void )
+                                  { h( std::error_code{}, data ); } );
+                return;
+            }
+        }
+
         // If the routing table is empty, save the
         // current request for processing when
         // the routing table will be filled.
@@ -212,8 +314,10 @@ public:
             LOG_DEBUG( engine, this ) << "delaying async load of key '"
                     << to_string( key ) << "'." << std::endl;
 
+            // The local copy has already been checked.
             auto t = [ this, key, handler ] ( void ) mutable
-            { async_load( key, std::move( handler ) ); };
+            { async_load( key, std::move( handler )
+                        , session_base::LOAD_FROM_NETWORK ); };
 
             pending_tasks_.push( std::move( t ) );
         }
@@ -222,13 +326,203 @@ public:
             LOG_DEBUG( engine, this ) << "executing async load of key '"
                     << to_string( key ) << "'." << std::endl;
 
-            start_find_value_task< data_type >( id( key )
-                                              , tracker_
-                                              , routing_table_
-                                              , std::forward< HandlerType >( handler ) );
+            load_value( key_id, std::forward< HandlerType >( handler ) );
         }
     }
 
+    /**
+     *  @brief Save the datas of many keys, calling
+     *         handler( key_index, failure ) for each.
+     *  @details
+     *  Keys sharing a prefix are served by a single
+     *  lookup and the values sent to the same peer
+     *  are batched. The keys whose closest peers may
+     *  differ from the group ones are saved one by one.
+     *  @throw std::system_error If keys and datas sizes differ.
+     */
+    template< typename HandlerType >
+    void
+    async_save_many
+        ( std::vector< key_type > const& keys
+        , std::vector< data_type > const& datas
+        , HandlerType && handler )
+    {
+        if ( keys.size() != datas.size() )
+            throw std::system_error{ make_error_code
+                    ( std::errc::invalid_argument ) };
+
+        if ( ! is_connected_ )
+        {
+            LOG_DEBUG( engine, this ) << "delaying async save of '"
+                    << keys.size() << "' key(s)." << std::endl;
+
+            auto t = [ this, keys, datas, handler ] ( void ) mutable
+            { async_save_many( keys, datas, std::move( handler ) ); };
+
+            pending_tasks_.push( std::move( t ) );
+            return;
+        }
+
+        LOG_DEBUG( engine, this ) << "executing async save of '"
+                << keys.size() << "' key(s)." << std::endl;
+
+        auto const ids = std::make_shared< std::vector< id > >( hash_keys( keys ) );
+        auto const values = std::make_shared< std::vector< data_type > >( datas );
+
+        key_indexes_type indexes( keys.size() );
+        std::iota( indexes.begin(), indexes.end(), std::size_t{ 0 } );
+
+        auto const prefix_bit_size = get_group_prefix_bit_size
+                ( my_id_, routing_table_.begin(), routing_table_.end() );
+        auto const groups = group_by_prefix( *ids, std::move( indexes )
+                                           , prefix_bit_size );
+        for ( auto const& group : groups )
+        {
+            auto const group_key = get_group_key( *ids, group );
+            auto on_peers_found = [ this, ids, values, group, group_key, handler ]
+                ( std::error_code const& failure
+                , std::vector< peer > const& peers )
+            {
+                key_indexes_type served;
+                for ( auto const i : group )
+                {
+                    if ( failure || are_closest_peers_of( ( *ids )[ i ]
+                                                        , group_key, peers
+                                                        , REDUNDANT_SAVE_COUNT ) )
+                    {
+                        served.push_back( i );
+                        continue;
+                    }
+
+                    // The group peers may not be its closest ones.
+                    auto on_save = [ handler, i ]
+                        ( std::error_code const& failure )
+                    { handler( i, failure ); };
+
+                    save_value( ( *ids )[ i ], ( *values )[ i ], on_save );
+                }
+
+                if ( ! failure )
+                    send_store_values_requests( *ids, *values, served, peers );
+
+                // The lookup ends at once when
+                // no peer can be queried.
+                auto notify = [ served, handler, failure ] ( void )
+                {
+                    for ( auto const i : served )
+                        handler( i, failure );
+                };
+                io_service_.post( notify );
+            };
+
+            start_find_peers_task( group_key
+                                 , tracker_
+                                 , routing_table_
+                                 , on_peers_found
+                                 , &lookup_statistics_
+                                 , &lookup_cache_ );
+        }
+    }
+
+    /**
+     *  @brief Load the datas of many keys, calling
+     *         handler( key_index, failure, data ) for each.
+     *  @details
+     *  Keys sharing a prefix are served by a single
+     *  lookup and the keys asked to the same peer
+     *  are batched. The keys the closest peers don't
+     *  know, or whose closest peers may differ from
+     *  the group ones, are looked up one by one.
+     */
+    template< typename HandlerType >
+    void
+    async_load_many
+        ( std::vector< key_type > const& keys
+        , HandlerType && handler
+        , session_base::load_policy policy = session_base::LOAD_LOCAL_FIRST )
+    {
+        auto const ids = std::make_shared< std::vector< id > >( hash_keys( keys ) );
+
+        key_indexes_type remaining;
+        for ( std::size_t i = 0; i != keys.size(); ++ i )
+        {
+            auto const found = policy == session_base::LOAD_LOCAL_FIRST
+                             ? find_local_value( ( *ids )[ i ] )
+                             : nullptr;
+            if ( ! found )
+                remaining.push_back( i );
+            else
+            {
+                auto const data = *found;
+                io_service_.post( [ handler, i, data ] ( void )
+                                  { handler( i, std::error_code{}, data ); } );
+            }
+        }
+
+        if ( remaining.empty() )
+            return;
+
+        LOG_DEBUG( engine, this ) << "loading '" << remaining.size()
+                << "' key(s) from the network." << std::endl;
+
+        load_values( ids, std::move( remaining )
+                   , typename std::decay< HandlerType >::type
+                           ( std::forward< HandlerType >( handler ) ) );
+    }
+
+    /**
+     *  Write known peers into the snapshot file located at path.
+     */
+    std::error_code
+    save_routing_table
+        ( std::string const& path )
+    {
+        routing_table_snapshot snapshot{ my_id_, {} };
+        snapshot.peers_.reserve( routing_table_.peer_count() );
+
+        for ( auto i = routing_table_.begin(), e = routing_table_.end()
+            ; i != e
+            ; ++ i )
+            snapshot.peers_.push_back( { i->first, i->second } );
+
+        LOG_DEBUG( engine, this ) << "saving '" << snapshot.peers_.size()
+                << "' peer(s) to '" << path << "'." << std::endl;
+
+        return save_routing_table_snapshot( path, snapshot );
+    }
+
+    /**
+     *  Push the peers of a snapshot file into the routing table.
+     *  They are not contacted: a peer which fails to answer
+     *  its first request is evicted by the tracker.
+     *  @note The id of this peer is kept, restarting with the
+     *        saved id is done by constructing from the snapshot.
+     */
+    std::error_code
+    load_routing_table
+        ( std::string const& path )
+    {
+        routing_table_snapshot snapshot;
+        if ( auto failure = load_routing_table_snapshot( path, snapshot ) )
+            return failure;
+
+        LOG_DEBUG( engine, this ) << "loading '" << snapshot.peers_.size()
+                << "' peer(s) from '" << path << "'." << std::endl;
+
+        restore_peers( snapshot.peers_ );
+
+        return std::error_code{};
+    }
+
+    /**
+     *  Return the totals of the save and load lookups.
+     */
+    lookup_statistics const&
+    get_lookup_statistics
+        ( void )
+        const
+    { return lookup_statistics_; }
+
 private:
     ///
     using pending_task_type = std::function< void ( void ) >;
@@ -243,7 +537,18 @@ private:
     using random_engine_type = std::default_random_engine;
 
     ///
-    using tracker_type = tracker< random_engine_type, network_type >;
+    using tracker_type = tracker< network_type
+                                , routing_table_type >;
+
+    ///
+    using load_handler_type = std::function< void ( std::error_code const&
+                                                  , data_type const& ) >;
+
+    ///
+    using pending_loads_type = std::unordered_map
+            < id
+            , std::vector< load_handler_type >
+            , value_store_key_hasher< id > >;
 
 private:
     /**
@@ -264,6 +569,15 @@ private:
             case header::STORE_REQUEST:
                 handle_store_request( sender, h, i, e );
                 break;
+            case header::CACHE_REQUEST:
+                handle_cache_request( sender, h, i, e );
+                break;
+            case header::STORE_VALUES_REQUEST:
+                handle_store_values_request( sender, h, i, e );
+                break;
+            case header::FIND_VALUES_REQUEST:
+                handle_find_values_request( sender, h, i, e );
+                break;
             case header::FIND_PEER_REQUEST:
                 handle_find_peer_request( sender, h, i, e );
                 break;
@@ -304,7 +618,7 @@ private:
         LOG_DEBUG( engine, this ) << "handling store request."
                 << std::endl;
 
-        store_value_request_body request;
+        store_value_request_view request;
         if ( auto failure = deserialize( i, e, request ) )
         {
             LOG_DEBUG( engine, this )
@@ -314,8 +628,145 @@ private:
             return;
         }
 
+        // This copy supersedes the cached one.
+        cached_values_.erase( request.data_key_hash_ );
+
+        // The value is copied once from the received
+        // buffer, into the storage of the previous one.
         value_store_[ request.data_key_hash_ ]
-                = std::move( request.data_value_ );
+                .assign( request.data_value_.begin()
+                       , request.data_value_.end() );
+    }
+
+    /**
+     *
+     */
+    void
+    handle_store_values_request
+        ( ip_endpoint const& sender
+        , header const& h
+        , buffer::const_iterator i
+        , buffer::const_iterator e )
+    {
+        LOG_DEBUG( engine, this ) << "handling store values request."
+                << std::endl;
+
+        store_values_request_body request;
+        if ( auto failure = deserialize( i, e, request ) )
+        {
+            LOG_DEBUG( engine, this )
+                    << "failed to deserialize store values request ("
+                    << failure.message() << ")." << std::endl;
+
+            return;
+        }
+
+        for ( auto & v : request.values_ )
+        {
+            cached_values_.erase( v.data_key_hash_ );
+            value_store_[ v.data_key_hash_ ] = std::move( v.data_value_ );
+        }
+    }
+
+    /**
+     *
+     */
+    void
+    handle_find_values_request
+        ( ip_endpoint const& sender
+        , header const& h
+        , buffer::const_iterator i
+        , buffer::const_iterator e )
+    {
+        LOG_DEBUG( engine, this ) << "handling find values request."
+                << std::endl;
+
+        find_values_request_body request;
+        if ( auto failure = deserialize( i, e, request ) )
+        {
+            LOG_DEBUG( engine, this )
+                    << "failed to deserialize find values request ("
+                    << failure.message() << ")" << std::endl;
+
+            return;
+        }
+
+        // The values which don't fit are omitted,
+        // the requester looks them up one by one.
+        find_values_response_body response;
+        auto size = get_batch_message_overhead();
+        for ( auto const& key : request.values_to_find_ )
+        {
+            auto const found = find_local_value( key );
+            if ( ! found )
+                continue;
+
+            store_value_request_body v{ key, *found };
+            size += get_serialized_size( v );
+            if ( size > BATCH_RESPONSE_MAX_SIZE )
+                break;
+
+            response.values_.push_back( std::move( v ) );
+        }
+
+        // The response is sent even if empty
+        // so that the requester doesn't wait.
+        tracker_.send_response( h.random_token_, response, sender );
+    }
+
+    /**
+     *
+     */
+    void
+    handle_cache_request
+        ( ip_endpoint const& sender
+        , header const& h
+        , buffer::const_iterator i
+        , buffer::const_iterator e )
+    {
+        LOG_DEBUG( engine, this ) << "handling cache request."
+                << std::endl;
+
+        cache_value_request_body request;
+        if ( auto failure = deserialize( i, e, request ) )
+        {
+            LOG_DEBUG( engine, this )
+                    << "failed to deserialize cache value request ("
+                    << failure.message() << ")." << std::endl;
+
+            return;
+        }
+
+        // Stored values outlive cached ones.
+        if ( value_store_.count( request.data_key_hash_ ) )
+            return;
+
+        // The requester chooses the ttl, hence
+        // it can't exceed the one we would choose.
+        auto const now = timer::clock::now();
+        auto const expiration_time = now
+                + std::min( std::chrono::seconds( request.ttl_ )
+                          , CACHED_VALUE_TTL );
+
+        cached_values_.insert( request.data_key_hash_
+                             , std::move( request.data_value_ )
+                             , expiration_time
+                             , now );
+    }
+
+    /**
+     *  @brief Return the value of key stored or
+     *         cached by this peer, or nullptr.
+     */
+    data_type const*
+    find_local_value
+        ( id const& key )
+    {
+        auto const stored = value_store_.find( key );
+        if ( stored != value_store_.end() )
+            return &stored->second;
+
+        return cached_values_.find( key, timer::clock::now() );
     }
 
     /**
@@ -360,12 +811,13 @@ private:
         // their location into the response..
         find_peer_response_body response;
 
-        auto remaining_peer = ROUTING_TABLE_BUCKET_SIZE;
-        for ( auto i = routing_table_.find( peer_to_find_id )
-                 , e = routing_table_.end()
-            ; i != e && remaining_peer > 0
-            ; ++i, -- remaining_peer )
-            response.peers_.push_back( { i->first, i->second } );
+        routing_table_.find_closest( peer_to_find_id
+                                   , ROUTING_TABLE_BUCKET_SIZE
+                                   , closest_peers_ );
+
+        response.peers_.reserve( closest_peers_.size() );
+        for ( auto const& p : closest_peers_ )
+            response.peers_.push_back( { p.first, p.second } );
 
         // Now send the response.
         tracker_.send_response( random_token, response, sender );
@@ -394,38 +846,245 @@ private:
             return;
         }
 
-        auto found = value_store_.find( request.value_to_find_ );
-        if ( found == value_store_.end() )
+        auto const found = find_local_value( request.value_to_find_ );
+        if ( ! found )
             send_find_peer_response( sender
                                    , h.random_token_
                                    , request.value_to_find_ );
         else
         {
-            find_value_response_body const response{ found->second };
+            find_value_response_body const response{ *found };
             tracker_.send_response( h.random_token_
                                   , response
                                   , sender );
         }
     }
 
+    /**
+     *  Store data on the closest peers of key.
+     */
+    template< typename HandlerType >
+    void
+    save_value
+        ( id const& key
+        , data_type const& data
+        , HandlerType && handler )
+    {
+        // The lookup ends at once when no peer can be
+        // queried, keep the handler from being called
+        // from within this call.
+        auto h = std::forward< HandlerType >( handler );
+        auto on_save = [ this, h ] ( std::error_code const& failure )
+        { io_service_.post( [ h, failure ] ( void ) { h( failure ); } ); };
+
+        start_store_value_task( key
+                              , data
+                              , tracker_
+                              , routing_table_
+                              , on_save
+                              , &lookup_statistics_
+                              , &lookup_cache_ );
+    }
+
+    /**
+     *  Attach handler to the in flight load of key
+     *  or start a new one.
+     */
+    template< typename HandlerType >
+    void
+    load_value
+        ( id const& key
+        , HandlerType && handler )
+    {
+        auto const i = pending_loads_.find( key );
+        if ( i != pending_loads_.end() )
+        {
+            LOG_DEBUG( engine, this ) << "joining in flight load of '"
+                    << key << "'." << std::endl;
+
+            i->second.emplace_back( std::forward< HandlerType >( handler ) );
+            return;
+        }
+
+        pending_loads_[ key ].emplace_back
+                ( std::forward< HandlerType >( handler ) );
+
+        auto on_load = [ this, key ]
+            ( std::error_code const& failure
+            , data_type const& data )
+        {
+            // Detach the waiters first, a handler
+            // may start a new load of the same key.
+            auto const i = pending_loads_.find( key );
+            auto const handlers = std::move( i->second );
+            pending_loads_.erase( i );
+
+            for ( auto const& h : handlers )
+                h( failure, data );
+        };
+
+        start_find_value_task< data_type >( key
+                                          , tracker_
+                                          , routing_table_
+                                          , on_load
+                                          , &lookup_statistics_
+                                          , &lookup_cache_ );
+    }
+
+    /**
+     *
+     */
+    static std::vector< id >
+    hash_keys
+        ( std::vector< key_type > const& keys )
+    {
+        std::vector< id > ids( keys.size() );
+        hash_values( keys.data(), keys.size(), ids.data() );
+        return ids;
+    }
+
+    /**
+     *  @brief Return the key a group lookup targets, its
+     *         middle one being the closest to the others.
+     */
+    static id const&
+    get_group_key
+        ( std::vector< id > const& ids
+        , key_indexes_type const& group )
+    { return ids[ group[ group.size() / 2 ] ]; }
+
+    /**
+     *  Send the values of a group to their closest peers.
+     */
+    void
+    send_store_values_requests
+        ( std::vector< id > const& ids
+        , std::vector< data_type > const& values
+        , key_indexes_type const& group
+        , std::vector< peer > const& peers )
+    {
+        auto const assignments = assign_to_closest_peers
+                ( ids, group, peers, REDUNDANT_SAVE_COUNT );
+
+        for ( std::size_t p = 0; p != peers.size(); ++ p )
+        {
+            std::vector< store_value_request_body > entries;
+            entries.reserve( assignments[ p ].size() );
+            for ( auto const i : assignments[ p ] )
+                entries.push_back( { ids[ i ], values[ i ] } );
+
+            auto messages = split_into_messages( std::move( entries )
+                                               , BATCH_MESSAGE_MAX_SIZE );
+            for ( auto & m : messages )
+                tracker_.send_request( store_values_request_body{ std::move( m ) }
+                                     , peers[ p ].endpoint_ );
+        }
+    }
+
+    /**
+     *  Load the values of the keys at indexes of ids.
+     */
+    template< typename HandlerType >
+    void
+    load_values
+        ( std::shared_ptr< std::vector< id > > const& ids
+        , key_indexes_type indexes
+        , HandlerType const& handler )
+    {
+        if ( ! is_connected_ )
+        {
+            auto t = [ this, ids, indexes, handler ] ( void )
+            { load_values( ids, indexes, handler ); };
+
+            pending_tasks_.push( std::move( t ) );
+            return;
+        }
+
+        auto const prefix_bit_size = get_group_prefix_bit_size
+                ( my_id_, routing_table_.begin(), routing_table_.end() );
+        auto const groups = group_by_prefix( *ids, std::move( indexes )
+                                           , prefix_bit_size );
+        for ( auto const& group : groups )
+        {
+            // The keys the closest peers don't know
+            // may still be cached farther.
+            auto on_value = [ this, ids, handler ]
+                ( std::size_t i
+                , std::error_code const& failure
+                , data_type const& data )
+            {
+                if ( failure != VALUE_NOT_FOUND )
+                {
+                    handler( i, failure, data );
+                    return;
+                }
+
+                auto on_load = [ handler, i ]
+                    ( std::error_code const& failure
+                    , data_type const& data )
+                { handler( i, failure, data ); };
+
+                load_value( ( *ids )[ i ], on_load );
+            };
+
+            auto const group_key = get_group_key( *ids, group );
+            auto on_peers_found = [ this, ids, group, group_key, handler, on_value ]
+                ( std::error_code const& failure
+                , std::vector< peer > const& peers )
+            {
+                if ( failure )
+                {
+                    for ( auto const i : group )
+                        handler( i, failure, data_type{} );
+                    return;
+                }
+
+                // The keys whose closest peers may not be
+                // the group peers are looked up one by one.
+                key_indexes_type served;
+                for ( auto const i : group )
+                {
+                    if ( are_closest_peers_of( ( *ids )[ i ], group_key, peers
+                                             , REDUNDANT_SAVE_COUNT ) )
+                        served.push_back( i );
+                    else
+                        on_value( i, make_error_code( VALUE_NOT_FOUND )
+                                , data_type{} );
+                }
+
+                if ( ! served.empty() )
+                    start_find_values_task< data_type >( *ids, served, peers
+                                                       , tracker_, on_value );
+            };
+
+            start_find_peers_task( group_key
+                                 , tracker_
+                                 , routing_table_
+                                 , on_peers_found
+                                 , &lookup_statistics_
+                                 , &lookup_cache_ );
+        }
+    }
+
     /**
      *
      */
     void
     discover_neighbors
-        ( endpoint const& initial_peer )
+        ( endpoint const& initial_peer
+        , bool only_refresh_empty_k_buckets = false )
     {
         // Initial peer should know our neighbors, hence ask
         // him which peers are close to our own id.
         auto endoints_to_query = network_.resolve_endpoint( initial_peer );
 
-        auto on_discovery = [ this ]
+        auto on_discovery = [ this, only_refresh_empty_k_buckets ]
             ( std::error_code const& failure )
         {
             if ( failure )
                 throw std::system_error{ failure };
 
-            notify_neighbors();
+            notify_neighbors( only_refresh_empty_k_buckets );
         };
 
         start_discover_neighbors_task( my_id_, tracker_, routing_table_
@@ -434,12 +1093,25 @@ private:
     }
 
     /**
-     *  Refresh each bucket.
+     *  Refresh each bucket, or only the empty ones.
      */
     void
     notify_neighbors
-        ( void )
+        ( bool only_empty_k_buckets )
     {
+        // K_buckets are indexed by the prefix shared with our id.
+        std::vector< bool > is_k_bucket_empty( id::BIT_SIZE, true );
+        if ( only_empty_k_buckets )
+            for ( auto i = routing_table_.begin(), e = routing_table_.end()
+                ; i != e
+                ; ++ i )
+            {
+                auto const index = std::min< std::size_t >
+                        ( common_prefix_length( i->first, my_id_ )
+                        , id::BIT_SIZE - 1 );
+                is_k_bucket_empty[ index ] = false;
+            }
+
         id refresh_id = my_id_;
 
         for ( std::size_t i = id::BIT_SIZE; i > 0; -- i )
@@ -448,10 +1120,24 @@ private:
             id::reference bit = refresh_id[ i - 1 ];
             bit = ! bit;
 
-            start_notify_peer_task( refresh_id, tracker_, routing_table_ );
+            if ( is_k_bucket_empty[ i - 1 ] )
+                start_notify_peer_task( refresh_id, tracker_, routing_table_ );
         }
     }
 
+    /**
+     *  Push peers read from a snapshot, they're
+     *  evicted unless they answer their first request.
+     */
+    void
+    restore_peers
+        ( std::vector< peer > const& peers )
+    {
+        for ( auto const& p : peers )
+            if ( p.id_ != my_id_ && routing_table_.push( p.id_, p.endpoint_ ) )
+                tracker_.add_restored_peer( p.id_ );
+    }
+
     /**
      *
      */
@@ -474,7 +1160,12 @@ private:
             return;
         }
 
-        routing_table_.push( h.source_id_, sender );
+        auto on_k_bucket_full = [ this ]
+            ( typename routing_table_type::value_type const& least_recently_seen )
+        { check_least_recently_seen_peer( least_recently_seen.first
+                                        , least_recently_seen.second ); };
+
+        routing_table_.push( h.source_id_, sender, on_k_bucket_full );
 
         process_new_message( sender, h, i, e );
 
@@ -487,6 +1178,49 @@ private:
         }
     }
 
+    /**
+     *  Ping the least recently seen peer of a full k_bucket
+     *  and evict it if it doesn't answer.
+     *  @note Long-lived peers are the most valuable ones, hence
+     *        they're granted a liveness delay rather than the
+     *        short lookup delay which would evict slow links.
+     */
+    void
+    check_least_recently_seen_peer
+        ( id const& peer_id
+        , ip_endpoint const& peer_endpoint )
+    {
+        LOG_DEBUG( engine, this ) << "checking least recently seen peer '"
+                << peer_id << "'." << std::endl;
+
+        // The response has already refreshed the peer
+        // in handle_new_message(), unless another peer answered.
+        auto on_pong = [ this, peer_id ]
+            ( ip_endpoint const&
+            , header const& h
+            , buffer::const_iterator
+            , buffer::const_iterator )
+        {
+            if ( h.source_id_ != peer_id )
+                routing_table_.remove( peer_id );
+        };
+
+        auto on_error = [ this, peer_id ]
+            ( std::error_code const& )
+        { routing_table_.remove( peer_id ); };
+
+        // A peer known to be slow is granted more time.
+        timer::duration timeout{ PEER_LIVENESS_TIMEOUT };
+        if ( auto const statistics = routing_table_.get_statistics( peer_id ) )
+            timeout = get_retransmission_timeout( *statistics, timeout );
+
+        tracker_.send_request( header::PING_REQUEST
+                             , peer{ peer_id, peer_endpoint }
+                             , timeout
+                             , on_pong
+                             , on_error );
+    }
+
     /**
      *
      */
@@ -507,6 +1241,8 @@ private:
     }
 
 private:
+    ///
+    boost::asio::io_service & io_service_;
     ///
     random_engine_type random_engine_;
     ///
@@ -517,12 +1253,22 @@ private:
     tracker_type tracker_;
     ///
     routing_table_type routing_table_;
+    /// Reused by send_find_peer_response().
+    std::vector< typename routing_table_type::value_type > closest_peers_;
     ///
     value_store_type value_store_;
+    /// Copies of values found by the lookups of other peers.
+    value_cache< data_type > cached_values_;
     ///
     bool is_connected_;
     ///
     std::queue< pending_task_type > pending_tasks_;
+    ///
+    lookup_statistics lookup_statistics_;
+    /// Closest peers found by recent lookups.
+    lookup_cache lookup_cache_;
+    /// Handlers waiting for each in flight load.
+    pending_loads_type pending_loads_;
 };
 
 } // namespace detail
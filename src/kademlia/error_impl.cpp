@@ -88,6 +88,8 @@ struct kademlia_error_category : std::error_category
                 return "timer malfunction";
             case ALREADY_RUNNING:
                 return "already running";
+            case INVALID_ROUTING_TABLE_SNAPSHOT:
+                return "invalid routing table snapshot";
             default:
                 return "unknown error";
         }
@@ -0,0 +1,309 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_FIND_PEERS_TASK_HPP
+#define KADEMLIA_FIND_PEERS_TASK_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <cassert>
+#include <memory>
+#include <type_traits>
+#include <system_error>
+#include <vector>
+
+#include "kademlia/error_impl.hpp"
+
+#include "kademlia/lookup_task.hpp"
+#include "kademlia/log.hpp"
+#include "kademlia/message.hpp"
+#include "kademlia/constants.hpp"
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  @brief Find the k closest peers of a key.
+ *  @details
+ *  The found peers are given to the handler,
+ *  e.g. store_value_task asks them to store a value.
+ */
+template< typename HandlerType, typename TrackerType >
+class find_peers_task final
+    : public lookup_task
+{
+public:
+    ///
+    using handler_type = HandlerType;
+
+    ///
+    using tracker_type = TrackerType;
+
+public:
+    /**
+     *
+     */
+    template< typename RoutingTableType >
+    static void
+    start
+        ( detail::id const & key
+        , tracker_type & tracker
+        , RoutingTableType & routing_table
+        , handler_type handler
+        , lookup_statistics * statistics
+        , lookup_cache * cache )
+    {
+        std::shared_ptr< find_peers_task > t;
+        t.reset( new find_peers_task( key
+                                    , tracker
+                                    , routing_table
+                                    , std::move( handler )
+                                    , statistics
+                                    , cache ) );
+
+        try_candidates( t );
+    }
+
+private:
+    /**
+     *
+     */
+    template< typename RoutingTableType >
+    find_peers_task
+        ( detail::id const & key
+        , tracker_type & tracker
+        , RoutingTableType & routing_table
+        , handler_type handler
+        , lookup_statistics * statistics
+        , lookup_cache * cache )
+            : lookup_task( key, routing_table )
+            , tracker_( tracker )
+            , handler_( std::move( handler ) )
+            , statistics_( statistics )
+            , cache_( cache )
+            , is_finished_()
+    {
+        LOG_DEBUG( find_peers_task, this )
+                << "create find peers task for '"
+                << key << "'." << std::endl;
+
+        // The peers found by a recent lookup of a
+        // close key may save a few hops.
+        add_cached_candidates( cache_ );
+    }
+
+    /**
+     *
+     */
+    void
+    notify_caller
+        ( void )
+    {
+        assert( ! is_caller_notified() );
+        record_statistics( statistics_ );
+        record_closest_candidates( cache_ );
+        is_finished_ = true;
+
+        auto const peers = select_closest_valid_candidates
+                ( ROUTING_TABLE_BUCKET_SIZE );
+
+        if ( peers.empty() )
+            handler_( make_error_code( INITIAL_PEER_FAILED_TO_RESPOND )
+                    , peers );
+        else
+            handler_( std::error_code{}, peers );
+    }
+
+    /**
+     *
+     */
+    bool
+    is_caller_notified
+        ( void )
+        const
+    { return is_finished_; }
+
+    /**
+     *
+     */
+    static void
+    try_candidates
+        ( std::shared_ptr< find_peers_task > task )
+    {
+        // Responses received once the peers
+        // have been found are ignored.
+        if ( task->is_caller_notified() )
+            return;
+
+        // The k closest peers are known.
+        if ( task->have_closest_candidates_responded
+                ( ROUTING_TABLE_BUCKET_SIZE ) )
+        {
+            task->notify_caller();
+            return;
+        }
+
+        find_peer_request_body const request{ task->get_key() };
+
+        auto const closest_candidates = task->select_new_closest_candidates
+                ( CONCURRENT_FIND_PEER_REQUESTS_COUNT );
+
+        for ( auto const& c : closest_candidates )
+            send_find_peer_request( request, c, task );
+
+        if ( task->have_all_requests_completed() )
+            task->notify_caller();
+    }
+
+    /**
+     *
+     */
+    static void
+    send_find_peer_request
+        ( find_peer_request_body const& request
+        , peer const& current_candidate
+        , std::shared_ptr< find_peers_task > task )
+    {
+        LOG_DEBUG( find_peers_task, task.get() )
+                << "sending find peer request for '"
+                << task->get_key() << "' to '"
+                << current_candidate << "'." << std::endl;
+
+        auto const sent_time = timer::clock::now();
+
+        // On message received, process it.
+        auto on_message_received = [ task, current_candidate, sent_time ]
+            ( ip_endpoint const& s
+            , header const& h
+            , buffer::const_iterator i
+            , buffer::const_iterator e )
+        {
+            task->record_response_time( timer::clock::now() - sent_time );
+            handle_find_peer_response( current_candidate.id_
+                                     , h, i, e, task );
+        };
+
+        // On error, retry with another endpoint.
+        auto on_error = [ task, current_candidate ]
+            ( std::error_code const& )
+        {
+            task->flag_candidate_as_invalid( current_candidate.id_ );
+            try_candidates( task );
+        };
+
+        // On slow response, query another candidate meanwhile.
+        auto on_soft_timeout = [ task, current_candidate ]
+            ( void )
+        {
+            if ( task->flag_candidate_as_stalled( current_candidate.id_ ) )
+                try_candidates( task );
+        };
+
+        task->tracker_.send_request( request
+                                   , current_candidate
+                                   , PEER_LOOKUP_TIMEOUT
+                                   , on_message_received
+                                   , on_error );
+        task->tracker_.schedule( task->get_soft_timeout(), on_soft_timeout );
+    }
+
+    /**
+     *
+     */
+    static void
+    handle_find_peer_response
+        ( id const& candidate_id
+        , header const& h
+        , buffer::const_iterator i
+        , buffer::const_iterator e
+        , std::shared_ptr< find_peers_task > task )
+    {
+        find_peer_response_body response;
+        if ( h.type_ != header::FIND_PEER_RESPONSE )
+        {
+            LOG_DEBUG( find_peers_task, task.get() )
+                    << "unexpected find peer response (type="
+                    << int( h.type_ ) << ")" << std::endl;
+
+            task->flag_candidate_as_invalid( candidate_id );
+        }
+        else if ( auto failure = deserialize( i, e, response ) )
+        {
+            LOG_DEBUG( find_peers_task, task.get() )
+                    << "failed to deserialize find peer response ("
+                    << failure.message() << ")" << std::endl;
+
+            task->flag_candidate_as_invalid( candidate_id );
+        }
+        else
+        {
+            task->flag_candidate_as_valid( candidate_id );
+            task->add_candidates( response.peers_, candidate_id );
+        }
+
+        try_candidates( task );
+    }
+
+private:
+    ///
+    tracker_type & tracker_;
+    ///
+    handler_type handler_;
+    ///
+    lookup_statistics * statistics_;
+    ///
+    lookup_cache * cache_;
+    ///
+    bool is_finished_;
+};
+
+/**
+ *
+ */
+template< typename TrackerType
+        , typename RoutingTableType
+        , typename HandlerType >
+void
+start_find_peers_task
+    ( id const& key
+    , TrackerType & tracker
+    , RoutingTableType & routing_table
+    , HandlerType && handler
+    , lookup_statistics * statistics = nullptr
+    , lookup_cache * cache = nullptr )
+{
+    using handler_type = typename std::decay< HandlerType >::type;
+    using task = find_peers_task< handler_type, TrackerType >;
+
+    task::start( key, tracker, routing_table
+               , std::forward< HandlerType >( handler ), statistics, cache );
+}
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
@@ -30,6 +30,8 @@
 #   pragma once
 #endif
 
+#include <algorithm>
+#include <cstdint>
 #include <system_error>
 #include <memory>
 #include <type_traits>
@@ -106,13 +108,17 @@ public:
         ( detail::id const & key
         , tracker_type & tracker
         , RoutingTableType & routing_table
-        , load_handler_type handler )
+        , load_handler_type handler
+        , lookup_statistics * statistics
+        , lookup_cache * cache )
     {
         std::shared_ptr< find_value_task > t;
         t.reset( new find_value_task( key
                                     , tracker
                                     , routing_table
-                                    , std::move( handler ) ) );
+                                    , std::move( handler )
+                                    , statistics
+                                    , cache ) );
 
         try_candidates( t );
     }
@@ -126,17 +132,23 @@ private:
         ( id const & searched_key
         , tracker_type & tracker
         , RoutingTableType & routing_table
-        , load_handler_type load_handler )
-            : lookup_task( searched_key
-                         , routing_table.find( searched_key )
-                         , routing_table.end() )
+        , load_handler_type load_handler
+        , lookup_statistics * statistics
+        , lookup_cache * cache )
+            : lookup_task( searched_key, routing_table )
             , tracker_( tracker )
             , load_handler_( std::move( load_handler ) )
+            , statistics_( statistics )
+            , cache_( cache )
             , is_finished_()
     {
         LOG_DEBUG( find_value_task, this )
                 << "create find value task for '"
                 << searched_key << "' value." << std::endl;
+
+        // The peers close to the key are asked first
+        // as they are the likeliest to hold the value.
+        add_cached_candidates( cache_ );
     }
 
     /**
@@ -147,6 +159,8 @@ private:
         ( data_type const& data )
     {
         assert( ! is_caller_notified() );
+        record_statistics( statistics_ );
+        record_closest_candidates( cache_ );
         load_handler_( std::error_code(), data );
         is_finished_ = true;
     }
@@ -159,6 +173,8 @@ private:
         ( std::error_code const& failure )
     {
         assert( ! is_caller_notified() );
+        record_statistics( statistics_ );
+        record_closest_candidates( cache_ );
         load_handler_( failure, data_type{} );
         is_finished_ = true;
     }
@@ -180,6 +196,15 @@ private:
         ( std::shared_ptr< find_value_task > task
         , std::size_t concurrent_requests_count = CONCURRENT_FIND_PEER_REQUESTS_COUNT )
     {
+        // The k closest peers don't know the value,
+        // farther ones are unlikely to know it.
+        if ( task->have_closest_candidates_responded
+                ( ROUTING_TABLE_BUCKET_SIZE ) )
+        {
+            task->notify_caller( make_error_code( VALUE_NOT_FOUND ) );
+            return;
+        }
+
         auto const closest_candidates = task->select_new_closest_candidates
                 ( concurrent_requests_count );
 
@@ -204,8 +229,10 @@ private:
                 << "' value request to '"
                 << current_candidate << "'." << std::endl;
 
+        auto const sent_time = timer::clock::now();
+
         // On message received, process it.
-        auto on_message_received = [ task, current_candidate ]
+        auto on_message_received = [ task, current_candidate, sent_time ]
             ( ip_endpoint const& s
             , header const& h
             , buffer::const_iterator i
@@ -214,6 +241,7 @@ private:
             if ( task->is_caller_notified() )
                 return;
 
+            task->record_response_time( timer::clock::now() - sent_time );
             task->flag_candidate_as_valid( current_candidate.id_ );
             handle_find_value_response( s, h, i, e, task );
         };
@@ -230,11 +258,23 @@ private:
             try_candidates( task );
         };
 
+        // On slow response, query another candidate meanwhile.
+        auto on_soft_timeout = [ task, current_candidate ]
+            ( void )
+        {
+            if ( task->is_caller_notified() )
+                return;
+
+            if ( task->flag_candidate_as_stalled( current_candidate.id_ ) )
+                try_candidates( task );
+        };
+
         task->tracker_.send_request( request
-                                   , current_candidate.endpoint_
+                                   , current_candidate
                                    , PEER_LOOKUP_TIMEOUT
                                    , on_message_received
                                    , on_error );
+        task->tracker_.schedule( task->get_soft_timeout(), on_soft_timeout );
     }
 
     /**
@@ -257,10 +297,11 @@ private:
         if ( h.type_ == header::FIND_PEER_RESPONSE )
             // The current peer didn't know the value
             // but provided closest peers.
-            send_find_value_requests_on_closer_peers( i, e, task );
+            send_find_value_requests_on_closer_peers( h.source_id_
+                                                    , i, e, task );
         else if ( h.type_ == header::FIND_VALUE_RESPONSE )
             // The current peer knows the value.
-            process_found_value( i, e, task );
+            process_found_value( h.source_id_, i, e, task );
     }
 
     /**
@@ -272,7 +313,8 @@ private:
      */
     static void
     send_find_value_requests_on_closer_peers
-        ( buffer::const_iterator i
+        ( id const& sender_id
+        , buffer::const_iterator i
         , buffer::const_iterator e
         , std::shared_ptr< find_value_task > task )
     {
@@ -291,7 +333,7 @@ private:
             return;
         }
 
-        task->add_candidates( response.peers_ );
+        task->add_candidates( response.peers_, sender_id );
         try_candidates( task );
     }
 
@@ -302,7 +344,8 @@ private:
      */
     static void
     process_found_value
-        ( buffer::const_iterator i
+        ( id const& sender_id
+        , buffer::const_iterator i
         , buffer::const_iterator e
         , std::shared_ptr< find_value_task > task )
     {
@@ -310,7 +353,7 @@ private:
                 << "found '" << task->get_key()
                 << "' value." << std::endl;
 
-        find_value_response_body response;
+        find_value_response_view response;
         if ( auto failure = deserialize( i, e, response ) )
         {
             LOG_DEBUG( find_value_task, task.get() )
@@ -319,7 +362,55 @@ private:
             return;
         }
 
-        task->notify_caller( response.data_ );
+        // The value is copied once from the received buffer,
+        // then handed over to the cache request.
+        data_type data( response.data_.begin(), response.data_.end() );
+        task->notify_caller( data );
+        cache_found_value( sender_id, std::move( data ), task );
+    }
+
+    /**
+     *  @brief Store a copy of the value on the closest
+     *         peer which answered it didn't have it, so
+     *         later lookups of the key end sooner.
+     */
+    static void
+    cache_found_value
+        ( id const& holder_id
+        , data_type data
+        , std::shared_ptr< find_value_task > task )
+    {
+        peer cache_candidate;
+        std::size_t closer_count;
+        if ( ! task->select_closest_valid_candidate( holder_id
+                                                   , cache_candidate
+                                                   , closer_count ) )
+            return;
+
+        LOG_DEBUG( find_value_task, task.get() )
+                << "caching '" << task->get_key() << "' value on '"
+                << cache_candidate << "'." << std::endl;
+
+        cache_value_request_body const request
+                { task->get_key()
+                , get_cached_value_ttl( closer_count )
+                , std::move( data ) };
+        task->tracker_.send_request( request, cache_candidate.endpoint_ );
+    }
+
+    /**
+     *  @brief Return the lifetime in seconds of a copy cached
+     *         on a peer with closer_count peers closer to the key.
+     *  @details
+     *  It's halved by each closer peer, the farther copies
+     *  being reached by fewer lookups.
+     */
+    static std::uint32_t
+    get_cached_value_ttl
+        ( std::size_t closer_count )
+    {
+        auto const shift = std::min< std::size_t >( closer_count, 8 );
+        return std::uint32_t( CACHED_VALUE_TTL.count() >> shift );
     }
 
 private:
@@ -328,6 +419,10 @@ private:
     ///
     load_handler_type load_handler_;
     ///
+    lookup_statistics * statistics_;
+    ///
+    lookup_cache * cache_;
+    ///
     bool is_finished_;
 };
 
@@ -343,13 +438,15 @@ start_find_value_task
     ( id const& key
     , TrackerType & tracker
     , RoutingTableType & routing_table
-    , HandlerType && handler )
+    , HandlerType && handler
+    , lookup_statistics * statistics = nullptr
+    , lookup_cache * cache = nullptr )
 {
     using handler_type = typename std::decay< HandlerType >::type;
     using task = find_value_task< handler_type, TrackerType, DataType >;
 
     task::start( key, tracker, routing_table
-               , std::forward< HandlerType >( handler ) );
+               , std::forward< HandlerType >( handler ), statistics, cache );
 }
 
 } // namespace detail
@@ -0,0 +1,302 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_FIND_VALUES_TASK_HPP
+#define KADEMLIA_FIND_VALUES_TASK_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <memory>
+#include <type_traits>
+#include <system_error>
+#include <vector>
+
+#include "kademlia/error_impl.hpp"
+
+#include "kademlia/log.hpp"
+#include "kademlia/constants.hpp"
+#include "kademlia/message.hpp"
+#include "kademlia/key_batch.hpp"
+#include "kademlia/value_store.hpp"
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  @brief Ask the closest peers of a group of keys
+ *         for their values, with few messages.
+ *  @details
+ *  Each key is asked to its closest peer only, the
+ *  keys sent to the same peer being batched. The keys
+ *  whose value isn't returned are reported as
+ *  VALUE_NOT_FOUND, the caller being expected to
+ *  look them up one by one.
+ */
+template< typename HandlerType, typename TrackerType, typename DataType >
+class find_values_task final
+{
+public:
+    ///
+    using handler_type = HandlerType;
+
+    ///
+    using tracker_type = TrackerType;
+
+    ///
+    using data_type = DataType;
+
+public:
+    /**
+     *  @param ids The keys of the batch.
+     *  @param group The indexes of the keys to find.
+     *  @param peers The closest peers of the group.
+     */
+    static void
+    start
+        ( std::vector< id > const& ids
+        , key_indexes_type const& group
+        , std::vector< peer > const& peers
+        , tracker_type & tracker
+        , handler_type handler )
+    {
+        std::shared_ptr< find_values_task > t;
+        t.reset( new find_values_task( ids, group
+                                     , tracker, std::move( handler ) ) );
+
+        send_find_values_requests( ids, group, peers, t );
+    }
+
+private:
+    ///
+    using pending_keys_type = value_store< id, key_indexes_type >;
+
+private:
+    /**
+     *
+     */
+    find_values_task
+        ( std::vector< id > const& ids
+        , key_indexes_type const& group
+        , tracker_type & tracker
+        , handler_type handler )
+            : tracker_( tracker )
+            , handler_( std::move( handler ) )
+            , pending_keys_()
+            , in_flight_requests_count_()
+    {
+        // A key may appear more than once in a batch.
+        for ( auto const i : group )
+            pending_keys_[ ids[ i ] ].push_back( i );
+
+        LOG_DEBUG( find_values_task, this )
+                << "create find values task for '"
+                << pending_keys_.size() << "' key(s)." << std::endl;
+    }
+
+    /**
+     *
+     */
+    void
+    notify_caller
+        ( id const& key
+        , data_type const& data )
+    {
+        auto const found = pending_keys_.find( key );
+        if ( found == pending_keys_.end() )
+            return;
+
+        auto const indexes = std::move( found->second );
+        pending_keys_.erase( found );
+
+        for ( auto const i : indexes )
+            handler_( i, std::error_code{}, data );
+    }
+
+    /**
+     *  Report the keys whose value hasn't been returned.
+     */
+    void
+    notify_missing_keys
+        ( void )
+    {
+        auto const pending_keys = std::move( pending_keys_ );
+        pending_keys_.clear();
+
+        for ( auto const& k : pending_keys )
+            for ( auto const i : k.second )
+                handler_( i, make_error_code( VALUE_NOT_FOUND ), data_type{} );
+    }
+
+    /**
+     *
+     */
+    static void
+    send_find_values_requests
+        ( std::vector< id > const& ids
+        , key_indexes_type const& group
+        , std::vector< peer > const& peers
+        , std::shared_ptr< find_values_task > task )
+    {
+        auto const assignments = assign_to_closest_peers( ids, group
+                                                        , peers, 1 );
+
+        // Keep the task from completing while
+        // requests are being sent.
+        ++ task->in_flight_requests_count_;
+
+        for ( std::size_t p = 0; p != peers.size(); ++ p )
+        {
+            std::vector< id > keys;
+            keys.reserve( assignments[ p ].size() );
+            for ( auto const i : assignments[ p ] )
+                keys.push_back( ids[ i ] );
+
+            auto messages = split_into_messages( std::move( keys )
+                                               , BATCH_MESSAGE_MAX_SIZE );
+            for ( auto & m : messages )
+                send_find_values_request( find_values_request_body{ std::move( m ) }
+                                        , peers[ p ], task );
+        }
+
+        complete_request( task );
+    }
+
+    /**
+     *
+     */
+    static void
+    send_find_values_request
+        ( find_values_request_body const& request
+        , peer const& current_peer
+        , std::shared_ptr< find_values_task > task )
+    {
+        LOG_DEBUG( find_values_task, task.get() )
+                << "sending find '" << request.values_to_find_.size()
+                << "' values request to '"
+                << current_peer << "'." << std::endl;
+
+        auto on_message_received = [ task ]
+            ( ip_endpoint const&
+            , header const& h
+            , buffer::const_iterator i
+            , buffer::const_iterator e )
+        {
+            handle_find_values_response( h, i, e, task );
+            complete_request( task );
+        };
+
+        // The values of this peer are looked up one by one.
+        auto on_error = [ task ]
+            ( std::error_code const& )
+        { complete_request( task ); };
+
+        ++ task->in_flight_requests_count_;
+        task->tracker_.send_request( request
+                                   , current_peer
+                                   , PEER_LOOKUP_TIMEOUT
+                                   , on_message_received
+                                   , on_error );
+    }
+
+    /**
+     *
+     */
+    static void
+    handle_find_values_response
+        ( header const& h
+        , buffer::const_iterator i
+        , buffer::const_iterator e
+        , std::shared_ptr< find_values_task > task )
+    {
+        if ( h.type_ != header::FIND_VALUES_RESPONSE )
+        {
+            LOG_DEBUG( find_values_task, task.get() )
+                    << "unexpected find values response (type="
+                    << int( h.type_ ) << ")" << std::endl;
+            return;
+        }
+
+        find_values_response_body response;
+        if ( auto failure = deserialize( i, e, response ) )
+        {
+            LOG_DEBUG( find_values_task, task.get() )
+                    << "failed to deserialize find values response ("
+                    << failure.message() << ")" << std::endl;
+            return;
+        }
+
+        for ( auto const& v : response.values_ )
+            task->notify_caller( v.data_key_hash_, v.data_value_ );
+    }
+
+    /**
+     *
+     */
+    static void
+    complete_request
+        ( std::shared_ptr< find_values_task > task )
+    {
+        if ( -- task->in_flight_requests_count_ == 0 )
+            task->notify_missing_keys();
+    }
+
+private:
+    ///
+    tracker_type & tracker_;
+    ///
+    handler_type handler_;
+    /// Indexes of the keys whose value is still expected.
+    pending_keys_type pending_keys_;
+    ///
+    std::size_t in_flight_requests_count_;
+};
+
+/**
+ *
+ */
+template< typename DataType
+        , typename TrackerType
+        , typename HandlerType >
+void
+start_find_values_task
+    ( std::vector< id > const& ids
+    , key_indexes_type const& group
+    , std::vector< peer > const& peers
+    , TrackerType & tracker
+    , HandlerType && handler )
+{
+    using handler_type = typename std::decay< HandlerType >::type;
+    using task = find_values_task< handler_type, TrackerType, DataType >;
+
+    task::start( ids, group, peers, tracker
+               , std::forward< HandlerType >( handler ) );
+}
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
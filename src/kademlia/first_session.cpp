@@ -56,6 +56,16 @@ first_session::~first_session
     ( void )
 { }
 
+std::error_code
+first_session::save_routing_table
+    ( std::string const& path )
+{ return impl_->save_routing_table( path ); }
+
+std::error_code
+first_session::load_routing_table
+    ( std::string const& path )
+{ return impl_->load_routing_table( path ); }
+
 std::error_code
 first_session::run
     ( void )
@@ -25,16 +25,11 @@
 
 #include "kademlia/id.hpp"
 
-#include <cctype>
-#include <iostream>
-#include <iterator>
-#include <cassert>
-#include <cstdint>
 #include <algorithm>
-#include <utility>
-#include <sstream>
-#include <iomanip>
+#include <cstdint>
 
+// The low level hash functions are deprecated since OpenSSL 3.
+#define OPENSSL_SUPPRESS_DEPRECATED
 #include <openssl/sha.h>
 
 #include "kademlia/error_impl.hpp"
@@ -42,86 +37,143 @@
 namespace kademlia {
 namespace detail {
 
-static CXX11_CONSTEXPR std::size_t HEX_CHAR_PER_BLOCK = id::BYTE_PER_BLOCK * 2;
-
 namespace {
 
-id::block_type
-to_block
-    ( std::string const& s )
+/// Value of each hexadecimal digit, -1 for other characters.
+CXX11_CONSTEXPR std::int8_t HEX_DIGIT_VALUES[ 256 ] =
 {
-    auto is_id_digit = []( int c ) { return std::isxdigit( c ); };
-    if ( ! std::all_of( s.begin(), s.end(), is_id_digit ) )
-        throw std::system_error{ make_error_code( INVALID_ID ) };
-
-    std::stringstream converter{ s };
-
-    std::uint64_t result;
-    converter >> std::hex >> result;
-
-    assert( ! converter.fail() && "hexa to decimal conversion failed" );
-
-    return static_cast< id::block_type >( result );
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+///
+CXX11_CONSTEXPR char HEX_DIGITS[] = "0123456789abcdef";
+
+/**
+ *  The one-shot SHA1() & co. look the algorithm up on each
+ *  call since OpenSSL 3, costing several times the hash of
+ *  a short key. The low level functions hash directly,
+ *  using the SHA extensions or vector instructions when the
+ *  CPU provides them.
+ */
+template< typename ContextType
+        , typename InitType
+        , typename UpdateType
+        , typename FinalType >
+void
+hash_all
+    ( value_to_hash_type const* values
+    , std::size_t values_count
+    , std::uint8_t * digests
+    , std::size_t digest_size
+    , InitType init
+    , UpdateType update
+    , FinalType finalize )
+{
+    ContextType context;
+
+    for ( auto e = values + values_count; values != e; ++ values )
+    {
+        init( &context );
+        update( &context, values->data(), values->size() );
+        finalize( digests, &context );
+        digests += digest_size;
+    }
 }
 
 } // namespace
 
-id::id
-    ( std::default_random_engine & random_engine )
-{
-    // The output of the generator is treated as boolean value.
-    std::uniform_int_distribution<> distribution
-            ( std::numeric_limits< block_type >::min()
-            , std::numeric_limits< block_type >::max() );
+CXX11_CONSTEXPR std::size_t sha1_hasher::DIGEST_BIT_SIZE;
 
-    std::generate( blocks_.begin(), blocks_.end()
-                 , std::bind( distribution, std::ref( random_engine ) ) );
-}
-
-id::id
-    ( std::string s )
+void
+sha1_hasher::operator()
+    ( value_to_hash_type const* values
+    , std::size_t values_count
+    , std::uint8_t * digests )
+    const
 {
-    auto CXX11_CONSTEXPR STRING_MAX_SIZE = BLOCKS_COUNT * HEX_CHAR_PER_BLOCK;
-
-    if ( s.size() > STRING_MAX_SIZE )
-        throw std::system_error{ make_error_code( INVALID_ID ) };
+    hash_all< SHA_CTX >( values, values_count, digests, SHA_DIGEST_LENGTH
+                       , &SHA1_Init, &SHA1_Update, &SHA1_Final );
+}
 
-    // Insert leading 0.
-    s.insert( s.begin(), STRING_MAX_SIZE - s.size(), '0' );
+CXX11_CONSTEXPR std::size_t sha256_hasher::DIGEST_BIT_SIZE;
 
-    assert( s.size() == STRING_MAX_SIZE && "string padding failed" );
-    for ( std::size_t i = 0; i != BLOCKS_COUNT; ++ i )
-        blocks_[ i ] = to_block( s.substr( i * HEX_CHAR_PER_BLOCK
-                                         , HEX_CHAR_PER_BLOCK ) );
+void
+sha256_hasher::operator()
+    ( value_to_hash_type const* values
+    , std::size_t values_count
+    , std::uint8_t * digests )
+    const
+{
+    hash_all< SHA256_CTX >( values, values_count, digests
+                          , SHA256_DIGEST_LENGTH
+                          , &SHA256_Init, &SHA256_Update, &SHA256_Final );
 }
 
-id::id
-    ( value_to_hash_type const& value )
+std::error_code
+from_hex
+    ( char const* first
+    , char const* last
+    , std::uint8_t * blocks
+    , std::size_t blocks_count )
 {
-    // Use OpenSSL crypto hash.
-    SHA1( value.data(), value.size(), blocks_.data() );
+    std::size_t const digits_count = last - first;
+    if ( digits_count > 2 * blocks_count )
+        return make_error_code( INVALID_ID );
+
+    // Missing leading digits are 0.
+    std::size_t const padding = 2 * blocks_count - digits_count;
+    std::fill_n( blocks, padding / 2, 0 );
+    blocks += padding / 2;
+
+    // Odd count of digits, the first block only has its low nibble.
+    if ( padding % 2 )
+    {
+        auto const value = HEX_DIGIT_VALUES[ std::uint8_t( *first ++ ) ];
+        if ( value < 0 )
+            return make_error_code( INVALID_ID );
+
+        *blocks ++ = std::uint8_t( value );
+    }
+
+    for ( ; first != last; first += 2 )
+    {
+        auto const high = HEX_DIGIT_VALUES[ std::uint8_t( first[ 0 ] ) ];
+        auto const low = HEX_DIGIT_VALUES[ std::uint8_t( first[ 1 ] ) ];
+        if ( ( high | low ) < 0 )
+            return make_error_code( INVALID_ID );
+
+        *blocks ++ = std::uint8_t( high << 4 | low );
+    }
+
+    return std::error_code{};
 }
 
-std::ostream &
-operator<<
-    ( std::ostream & out
-    , id const& id_to_print )
+char *
+to_hex
+    ( std::uint8_t const* blocks
+    , std::size_t blocks_count
+    , char * out )
 {
-    auto e = id_to_print.end();
-
-    // Skip leading 0.
-    auto is_not_0 = []( id::block_type b ) { return b != 0; };
-    auto i = std::find_if( id_to_print.begin(), e, is_not_0 );
-
-    auto const previous_flags = out.flags();
-
-    out << std::hex
-        << std::setfill( '0' )
-        << std::setw( HEX_CHAR_PER_BLOCK );
-
-    std::copy( i, e, std::ostream_iterator< std::uint64_t >{ out } );
-
-    out.flags( previous_flags );
+    for ( auto e = blocks + blocks_count; blocks != e; ++ blocks )
+    {
+        *out ++ = HEX_DIGITS[ *blocks >> 4 ];
+        *out ++ = HEX_DIGITS[ *blocks & 0xf ];
+    }
 
     return out;
 }
@@ -32,24 +32,160 @@
 
 #include <cstdint>
 #include <array>
-#include <iosfwd>
+#include <ostream>
 #include <random>
 #include <string>
+#include <system_error>
 #include <vector>
 #include <functional>
+#include <limits>
+#include <type_traits>
 #include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#ifdef _MSC_VER
+#   include <intrin.h>
+#endif
 
 #include <kademlia/detail/cxx11_macros.hpp>
 
 namespace kademlia {
 namespace detail {
 
+/**
+ *  @brief Convert a word read from the memory of an id
+ *         into its big-endian value, i.e. the value whose
+ *         highest bit is the first bit of the id.
+ */
+inline std::uint64_t
+to_big_endian_value
+    ( std::uint64_t word )
+{
+#if defined( __GNUC__ ) && defined( __BYTE_ORDER__ )                          \
+    && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return __builtin_bswap64( word );
+#elif defined( __GNUC__ ) && defined( __BYTE_ORDER__ )                        \
+    && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return word;
+#elif defined( _MSC_VER )
+    return _byteswap_uint64( word );
+#else
+    std::uint8_t bytes[ sizeof( word ) ];
+    std::memcpy( bytes, &word, sizeof( word ) );
+
+    std::uint64_t value = 0;
+    for ( auto b : bytes )
+        value = value << 8 | b;
+
+    return value;
+#endif
+}
+
 ///
-class id final
+using value_to_hash_type = std::vector< std::uint8_t >;
+
+/**
+ *  @brief Hash values into ids using SHA-1.
+ */
+struct sha1_hasher final
+{
+    ///
+    static CXX11_CONSTEXPR std::size_t DIGEST_BIT_SIZE = 160;
+
+    /**
+     *  @brief Write the DIGEST_BIT_SIZE / 8 bytes digest of value.
+     */
+    void
+    operator()
+        ( value_to_hash_type const& value
+        , std::uint8_t * digest )
+        const
+    { ( *this )( &value, 1, digest ); }
+
+    /**
+     *  @brief Write the digests of values_count values,
+     *         DIGEST_BIT_SIZE / 8 bytes apart.
+     */
+    void
+    operator()
+        ( value_to_hash_type const* values
+        , std::size_t values_count
+        , std::uint8_t * digests )
+        const;
+};
+
+/**
+ *  @brief Hash values into ids using SHA-256.
+ */
+struct sha256_hasher final
+{
+    ///
+    static CXX11_CONSTEXPR std::size_t DIGEST_BIT_SIZE = 256;
+
+    /**
+     *  @brief Write the DIGEST_BIT_SIZE / 8 bytes digest of value.
+     */
+    void
+    operator()
+        ( value_to_hash_type const& value
+        , std::uint8_t * digest )
+        const
+    { ( *this )( &value, 1, digest ); }
+
+    /**
+     *  @brief Write the digests of values_count values,
+     *         DIGEST_BIT_SIZE / 8 bytes apart.
+     */
+    void
+    operator()
+        ( value_to_hash_type const* values
+        , std::size_t values_count
+        , std::uint8_t * digests )
+        const;
+};
+
+/**
+ *  @brief Parse the hexadecimal representation of blocks_count blocks.
+ *  @note The string is left padded with 0. INVALID_ID is returned
+ *        if it's too long or not hexadecimal, leaving the blocks
+ *        content unspecified.
+ */
+std::error_code
+from_hex
+    ( char const* first
+    , char const* last
+    , std::uint8_t * blocks
+    , std::size_t blocks_count );
+
+/**
+ *  @brief Write the 2 * blocks_count hexadecimal digits of blocks.
+ *  @return The end of the written characters.
+ */
+char *
+to_hex
+    ( std::uint8_t const* blocks
+    , std::size_t blocks_count
+    , char * out );
+
+/**
+ *  @brief Identifier of BitSize bits, built by hashing
+ *         values with Hasher.
+ */
+template< std::size_t BitSize, typename Hasher >
+class basic_id final
 {
+    static_assert( BitSize > 0 && BitSize % 8 == 0
+                 , "id bit size must be a non null multiple of 8" );
+    static_assert( BitSize <= Hasher::DIGEST_BIT_SIZE
+                 , "hasher digest is too short for this id size" );
+
 public:
     ///
-    static CXX11_CONSTEXPR std::size_t BIT_SIZE = 160;
+    static CXX11_CONSTEXPR std::size_t BIT_SIZE = BitSize;
+
+    ///
+    using hasher_type = Hasher;
 
     ///
     using block_type = std::uint8_t;
@@ -64,10 +200,32 @@ public:
     static CXX11_CONSTEXPR std::size_t BLOCKS_COUNT = BIT_SIZE / BIT_PER_BLOCK;
 
     ///
-    using blocks_type = std::array< block_type, BLOCKS_COUNT >;
+    using word_type = std::uint64_t;
+
+    ///
+    static CXX11_CONSTEXPR std::size_t BIT_PER_WORD = sizeof( word_type ) * 8;
+
+    ///
+    static CXX11_CONSTEXPR std::size_t WORDS_COUNT
+            = ( BIT_SIZE + BIT_PER_WORD - 1 ) / BIT_PER_WORD;
+
+    /**
+     *  The blocks are stored in wire order within the words
+     *  memory, the trailing padding bytes being always 0.
+     *  Hence words can be xored and compared for equality
+     *  as is, and ordered once converted with
+     *  to_big_endian_value().
+     */
+    using words_type = std::array< word_type, WORDS_COUNT >;
+
+    ///
+    using iterator = block_type *;
 
     ///
-    using value_to_hash_type = std::vector< std::uint8_t >;
+    using const_iterator = block_type const*;
+
+    ///
+    using value_to_hash_type = detail::value_to_hash_type;
 
     /**
      *
@@ -123,81 +281,120 @@ public:
     /**
      *  @brief Construct a null id.
      */
-    id
+    basic_id
         ( void )
-        : blocks_{ }
+        : words_{ }
     { }
 
     /**
      *  @brief Construct a random id.
      */
     explicit
-    id
-        ( std::default_random_engine & random_engine );
+    basic_id
+        ( std::default_random_engine & random_engine )
+        : words_{ }
+    {
+        // The output of the generator is treated as boolean value.
+        std::uniform_int_distribution<> distribution
+                ( std::numeric_limits< block_type >::min()
+                , std::numeric_limits< block_type >::max() );
+
+        std::generate( begin(), end()
+                     , std::bind( distribution, std::ref( random_engine ) ) );
+    }
 
     /**
      *  @brief Construct an id from a string representation.
      */
     explicit
-    id
-        ( std::string value );
+    basic_id
+        ( std::string const& value )
+        : words_{ }
+    {
+        auto const failure = from_hex( value.data()
+                                     , value.data() + value.size()
+                                     , begin(), BLOCKS_COUNT );
+        if ( failure )
+            throw std::system_error{ failure };
+    }
 
     /**
      *  @brief Construct an id by hashing a value.
+     *  @note The digest is truncated to BIT_SIZE.
      */
     explicit
-    id
-        ( value_to_hash_type const& value );
+    basic_id
+        ( value_to_hash_type const& value )
+        : words_{ }
+    {
+        std::array< block_type, Hasher::DIGEST_BIT_SIZE / 8 > digest;
+        Hasher{}( value, digest.data() );
+        std::copy_n( digest.begin(), BLOCKS_COUNT, begin() );
+    }
 
     /**
      *
      */
-    blocks_type::iterator
+    iterator
     begin
         ( void )
-    { return blocks_.begin(); }
+    { return reinterpret_cast< iterator >( words_.data() ); }
 
     /**
      *
      */
-    blocks_type::iterator
+    iterator
     end
         ( void )
-    { return blocks_.end(); }
+    { return begin() + BLOCKS_COUNT; }
 
     /**
      *
      */
-    blocks_type::const_iterator
+    const_iterator
     begin
         ( void )
         const
-    { return blocks_.begin(); }
+    { return reinterpret_cast< const_iterator >( words_.data() ); }
 
     /**
      *
      */
-    blocks_type::const_iterator
+    const_iterator
     end
         ( void )
         const
-    { return blocks_.end(); }
+    { return begin() + BLOCKS_COUNT; }
+
+    /**
+     *
+     */
+    words_type const&
+    words
+        ( void )
+        const
+    { return words_; }
 
     /**
      *
      */
     bool
     operator==
-        ( id const& o )
+        ( basic_id const& o )
         const
-    { return o.blocks_ == blocks_; }
+    {
+        bool equal = true;
+        for ( std::size_t i = 0; i != WORDS_COUNT; ++ i )
+            equal &= o.words_[ i ] == words_[ i ];
+        return equal;
+    }
 
     /**
      *
      */
     bool
     operator!=
-        ( id const& o )
+        ( basic_id const& o )
         const
     { return ! (o == *this); }
 
@@ -222,6 +419,18 @@ public:
         ( std::size_t index )
     { return reference{ get_block( index ), get_mask( index ) }; }
 
+    /**
+     *  @brief Set this id to the xor of two ids.
+     */
+    void
+    assign_xor
+        ( basic_id const& a
+        , basic_id const& b )
+    {
+        for ( std::size_t i = 0; i != WORDS_COUNT; ++ i )
+            words_[ i ] = a.words_[ i ] ^ b.words_[ i ];
+    }
+
 private:
     /**
      *
@@ -229,7 +438,7 @@ private:
     block_type &
     get_block
         ( std::size_t index )
-    { return blocks_[ index / BIT_PER_BLOCK ]; }
+    { return begin()[ index / BIT_PER_BLOCK ]; }
 
     /**
      *
@@ -238,7 +447,7 @@ private:
     get_block
         ( std::size_t index )
         const
-    { return blocks_[ index / BIT_PER_BLOCK ]; }
+    { return begin()[ index / BIT_PER_BLOCK ]; }
 
     /**
      *
@@ -250,48 +459,248 @@ private:
 
 private:
     ///
-    blocks_type blocks_;
+    alignas( word_type ) words_type words_;
 };
 
+template< std::size_t BitSize, typename Hasher >
+CXX11_CONSTEXPR std::size_t basic_id< BitSize, Hasher >::BIT_SIZE;
+
+template< std::size_t BitSize, typename Hasher >
+CXX11_CONSTEXPR std::size_t basic_id< BitSize, Hasher >::BLOCKS_COUNT;
+
 /**
  *
  */
+template< std::size_t BitSize, typename Hasher >
 inline bool
 operator<
-    ( id const& a
-    , id const& b )
+    ( basic_id< BitSize, Hasher > const& a
+    , basic_id< BitSize, Hasher > const& b )
 {
-    return std::lexicographical_compare( a.begin(), a.end()
-                                       , b.begin(), b.end() );
+    auto const& a_words = a.words();
+    auto const& b_words = b.words();
+
+    for ( std::size_t i = 0; i != a_words.size(); ++ i )
+        if ( a_words[ i ] != b_words[ i ] )
+            return to_big_endian_value( a_words[ i ] )
+                 < to_big_endian_value( b_words[ i ] );
+
+    return false;
 }
 
 /**
- *
+ *  @brief Parse the hexadecimal representation of an id.
+ *  @note new_id is left unchanged on failure.
+ */
+template< std::size_t BitSize, typename Hasher >
+inline std::error_code
+from_hex
+    ( char const* first
+    , char const* last
+    , basic_id< BitSize, Hasher > & new_id )
+{
+    basic_id< BitSize, Hasher > parsed_id;
+
+    auto const failure = from_hex( first, last
+                                 , parsed_id.begin(), parsed_id.BLOCKS_COUNT );
+    if ( ! failure )
+        new_id = parsed_id;
+
+    return failure;
+}
+
+/**
+ *  @brief Write the 2 * BLOCKS_COUNT hexadecimal digits of an id.
+ *  @return The end of the written characters.
  */
-std::ostream &
+template< std::size_t BitSize, typename Hasher >
+inline char *
+to_hex
+    ( basic_id< BitSize, Hasher > const& i
+    , char * out )
+{ return to_hex( i.begin(), i.BLOCKS_COUNT, out ); }
+
+/**
+ *  @brief Print the id without its leading null blocks.
+ *  @note A null id is printed as 0.
+ */
+template< std::size_t BitSize, typename Hasher >
+inline std::ostream &
 operator<<
     ( std::ostream & out
-    , id const& i );
+    , basic_id< BitSize, Hasher > const& i )
+{
+    char digits[ 2 * basic_id< BitSize, Hasher >::BLOCKS_COUNT ];
+
+    auto const is_not_0 = []( std::uint8_t b ) { return b != 0; };
+    auto const first = std::find_if( i.begin(), i.end(), is_not_0 );
+    if ( first == i.end() )
+        return out << '0';
+
+    auto const e = to_hex( first, std::size_t( i.end() - first ), digits );
+    return out.write( digits, e - digits );
+}
 
 /**
  *
  */
-inline id
+template< std::size_t BitSize, typename Hasher >
+inline basic_id< BitSize, Hasher >
 distance
-    ( id const& a
-    , id const& b )
+    ( basic_id< BitSize, Hasher > const& a
+    , basic_id< BitSize, Hasher > const& b )
 {
-    id result;
+    basic_id< BitSize, Hasher > result;
+    result.assign_xor( a, b );
+    return result;
+}
 
-    std::transform( a.begin(), a.end(), b.begin()
-                  , result.begin()
-                  , std::bit_xor< id::block_type >{} );
+/**
+ *  @brief Check if an id is closer to a target than another one.
+ *  @return distance( a, target ) < distance( b, target ).
+ *  @note The distances are compared word by word without
+ *        being built, stopping at the first different word.
+ */
+template< std::size_t BitSize, typename Hasher >
+inline bool
+is_closer
+    ( basic_id< BitSize, Hasher > const& a
+    , basic_id< BitSize, Hasher > const& b
+    , basic_id< BitSize, Hasher > const& target )
+{
+    auto const& a_words = a.words();
+    auto const& b_words = b.words();
+    auto const& t_words = target.words();
 
-    return std::move( result );
+    for ( std::size_t i = 0; i != a_words.size(); ++ i )
+    {
+        auto const distance_a = a_words[ i ] ^ t_words[ i ]
+                 , distance_b = b_words[ i ] ^ t_words[ i ];
+        if ( distance_a != distance_b )
+            return to_big_endian_value( distance_a )
+                 < to_big_endian_value( distance_b );
+    }
+
+    return false;
 }
 
+/**
+ *  @brief Count the leading zero bits of a non null word.
+ */
+inline std::size_t
+count_leading_zeros
+    ( std::uint64_t value )
+{
+    assert( value != 0 && "can't count leading zeros of a null word" );
+
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return __builtin_clzll( value );
+#elif defined( _MSC_VER ) && defined( _M_X64 )
+    unsigned long index;
+    _BitScanReverse64( &index, value );
+    return 63 - index;
+#else
+    std::size_t count = 0;
+    for ( ; ( value & 0x8000000000000000ULL ) == 0; value <<= 1 )
+        ++ count;
+    return count;
+#endif
+}
+
+/**
+ *  @brief Return the count of leading bits shared by two ids.
+ *  @return A value between 0 and BIT_SIZE (when a == b).
+ *  @note The xor distance is evaluated 64 bits at a time.
+ */
+template< std::size_t BitSize, typename Hasher >
+inline std::size_t
+common_prefix_length
+    ( basic_id< BitSize, Hasher > const& a
+    , basic_id< BitSize, Hasher > const& b )
+{
+    using id_type = basic_id< BitSize, Hasher >;
+
+    auto const& a_words = a.words();
+    auto const& b_words = b.words();
+
+    for ( std::size_t i = 0; i != a_words.size(); ++ i )
+    {
+        auto const word = a_words[ i ] ^ b_words[ i ];
+        if ( word != 0 )
+            return i * id_type::BIT_PER_WORD
+                 + count_leading_zeros( to_big_endian_value( word ) );
+    }
+
+    return id_type::BIT_SIZE;
+}
+
+/**
+ *  @brief Hash ids for unordered containers.
+ *  @note Ids are uniformly distributed hash outputs,
+ *        hence their first word is already a good hash.
+ */
+struct id_hasher final
+{
+    ///
+    template< std::size_t BitSize, typename Hasher >
+    std::size_t
+    operator()
+        ( basic_id< BitSize, Hasher > const& i )
+        const
+    { return static_cast< std::size_t >( i.words()[ 0 ] ); }
+};
+
+/**
+ *  @brief Build the ids of values_count values.
+ *  @note Values are given to the hasher by chunks, which is
+ *        cheaper than building each id from its value.
+ */
+template< typename IdType >
+void
+hash_values
+    ( value_to_hash_type const* values
+    , std::size_t values_count
+    , IdType * ids )
+{
+    using hasher_type = typename IdType::hasher_type;
+
+    CXX11_CONSTEXPR std::size_t DIGEST_SIZE = hasher_type::DIGEST_BIT_SIZE / 8;
+    CXX11_CONSTEXPR std::size_t CHUNK_SIZE = 64;
+
+    std::array< std::uint8_t, CHUNK_SIZE * DIGEST_SIZE > digests;
+
+    while ( values_count > 0 )
+    {
+        auto const count = std::min( values_count, CHUNK_SIZE );
+        hasher_type{}( values, count, digests.data() );
+
+        // Digests are truncated to the id size.
+        for ( std::size_t i = 0; i != count; ++ i )
+            std::copy_n( digests.data() + i * DIGEST_SIZE
+                       , IdType::BLOCKS_COUNT
+                       , ids[ i ].begin() );
+
+        values += count;
+        ids += count;
+        values_count -= count;
+    }
+}
+
+#ifndef KADEMLIA_ID_BIT_SIZE
+#   define KADEMLIA_ID_BIT_SIZE 160
+#endif
+
+/**
+ *  @brief The id type used by the protocol, its size is
+ *         selected at compile time with KADEMLIA_ID_BIT_SIZE.
+ *  @note Ids longer than 160 bits are built using SHA-256.
+ */
+using id = basic_id< KADEMLIA_ID_BIT_SIZE
+                   , typename std::conditional< ( KADEMLIA_ID_BIT_SIZE > 160 )
+                                              , sha256_hasher
+                                              , sha1_hasher >::type >;
+
 } // namespace detail
 } // namespace kademlia
 
 #endif
-
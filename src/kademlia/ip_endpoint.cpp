@@ -34,7 +34,7 @@ std::ostream &
 operator<<
     ( std::ostream & out
     , ip_endpoint const& i )
-{ return out << i.address_ << ":" << i.port_; }
+{ return out << to_address( i ) << ":" << i.port_; }
 
 
 } // namespace detail
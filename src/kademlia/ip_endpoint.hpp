@@ -32,20 +32,76 @@
 
 #include <iosfwd>
 
+#include <array>
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <type_traits>
 #include <boost/asio/ip/address.hpp>
 
 namespace kademlia {
 namespace detail {
 
-///
+/**
+ *  A compact and trivially copyable IP endpoint,
+ *  converted to boost::asio types only by sockets.
+ *  @note The scope id of link-local IPv6 addresses is kept
+ *        but not serialized, as it only makes sense on this
+ *        host: a link-local peer is reachable when its
+ *        endpoint comes from a received message, not when
+ *        another peer advertised it.
+ */
 struct ip_endpoint final
 {
-    boost::asio::ip::address address_;
-    uint16_t port_;
+    ///
+    enum family_type : std::uint8_t
+    {
+        IPV4,
+        IPV6,
+    };
+
+    /// IPv4 addresses only use the first 4 bytes.
+    std::array< std::uint8_t, 16 > address_;
+    ///
+    family_type family_;
+    ///
+    std::uint16_t port_;
+    /// IPv6 interface index, 0 if none.
+    std::uint32_t scope_id_;
 };
 
+static_assert( std::is_trivially_copyable< ip_endpoint >::value
+             , "ip_endpoint must be trivially copyable" );
+
+/**
+ *
+ */
+inline ip_endpoint
+to_ip_endpoint
+    ( boost::asio::ip::address const& address
+    , std::uint16_t port )
+{
+    ip_endpoint e{};
+    e.port_ = port;
+
+    if ( address.is_v4() )
+    {
+        e.family_ = ip_endpoint::IPV4;
+        auto const bytes = address.to_v4().to_bytes();
+        std::memcpy( e.address_.data(), bytes.data(), bytes.size() );
+    }
+    else
+    {
+        e.family_ = ip_endpoint::IPV6;
+        auto const v6 = address.to_v6();
+        auto const bytes = v6.to_bytes();
+        std::memcpy( e.address_.data(), bytes.data(), bytes.size() );
+        e.scope_id_ = std::uint32_t( v6.scope_id() );
+    }
+
+    return e;
+}
+
 /**
  *
  */
@@ -53,9 +109,43 @@ inline ip_endpoint
 to_ip_endpoint( std::string const& ip
               , std::uint16_t port )
 {
-    return ip_endpoint
-        { boost::asio::ip::address::from_string( ip )
-        , port };
+    return to_ip_endpoint( boost::asio::ip::address::from_string( ip )
+                         , port );
+}
+
+/**
+ *
+ */
+inline bool
+is_ipv4
+    ( ip_endpoint const& e )
+{ return e.family_ == ip_endpoint::IPV4; }
+
+/**
+ *
+ */
+inline bool
+is_ipv6
+    ( ip_endpoint const& e )
+{ return e.family_ == ip_endpoint::IPV6; }
+
+/**
+ *
+ */
+inline boost::asio::ip::address
+to_address
+    ( ip_endpoint const& e )
+{
+    if ( is_ipv4( e ) )
+    {
+        boost::asio::ip::address_v4::bytes_type bytes;
+        std::memcpy( bytes.data(), e.address_.data(), bytes.size() );
+        return boost::asio::ip::address_v4{ bytes };
+    }
+
+    boost::asio::ip::address_v6::bytes_type bytes;
+    std::memcpy( bytes.data(), e.address_.data(), bytes.size() );
+    return boost::asio::ip::address_v6{ bytes, e.scope_id_ };
 }
 
 /**
@@ -73,7 +163,10 @@ inline bool
 operator==
     ( const ip_endpoint & a
     , const ip_endpoint & b )
-{ return a.address_ == b.address_ && a.port_ == b.port_; }
+{
+    return a.port_ == b.port_ && a.family_ == b.family_
+            && a.address_ == b.address_ && a.scope_id_ == b.scope_id_;
+}
 
 /**
  *
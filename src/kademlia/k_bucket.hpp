@@ -0,0 +1,495 @@
+// Copyright (c) 2013-2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef KADEMLIA_K_BUCKET_HPP
+#define KADEMLIA_K_BUCKET_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "kademlia/id.hpp"
+#include "kademlia/peer_statistics.hpp"
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  This class contains peers sharing a common prefix with our own id.
+ *  @note Ids and peers are stored into separate contiguous arrays
+ *        (i.e. struct of arrays) so looking for an id only walks
+ *        packed ids. Arrays are allocated once, on first push,
+ *        with the bucket capacity and never grow beyond.
+ *  @note Each peer is stamped with the bucket contact counter
+ *        when seen, hence refreshing a peer doesn't move it and
+ *        the least recently seen peer has the lowest stamp.
+ *  @note Each peer carries its statistics, which follow
+ *        it when it is promoted from the replacement cache.
+ *        Peers seen while the k_bucket is full are kept into
+ *        a replacement cache of the same capacity.
+ */
+template< typename PeerType >
+class k_bucket final
+{
+public:
+    ///
+    using peer_type = PeerType;
+
+    ///
+    using size_type = std::size_t;
+
+public:
+    /**
+     *  Construct an empty k_bucket.
+     *  @param capacity The maximum number of peers this k_bucket can hold.
+     */
+    explicit
+    k_bucket
+        ( size_type capacity )
+        : peers_(), replacements_()
+        , capacity_( capacity ), last_contact_()
+        , has_pending_check_()
+    { assert( capacity_ > 0 && "k_bucket capacity must be > 0" ); }
+
+    /**
+     *  @return The number of peers inside this k_bucket.
+     */
+    size_type
+    size
+        ( void )
+        const
+    { return peers_.size(); }
+
+    /**
+     *  @return true if this k_bucket doesn't contain any peer.
+     */
+    bool
+    empty
+        ( void )
+        const
+    { return peers_.size() == 0; }
+
+    /**
+     *  @return true if this k_bucket reached its capacity.
+     */
+    bool
+    full
+        ( void )
+        const
+    { return peers_.size() == capacity_; }
+
+    /**
+     *  @return The maximum number of peers this k_bucket can hold.
+     */
+    size_type
+    capacity
+        ( void )
+        const
+    { return capacity_; }
+
+    /**
+     *  Find the position of a peer.
+     *  @return The position of the peer or size() if not found.
+     *  @note Complexity: O(k)
+     */
+    size_type
+    find
+        ( id const& peer_id )
+        const
+    { return peers_.find( peer_id ); }
+
+    /**
+     *  Append a peer at the end of the k_bucket
+     *  as the most recently seen one.
+     *  @note The k_bucket must not be full.
+     */
+    void
+    push_back
+        ( id const& peer_id
+        , peer_type const& new_peer
+        , timer::clock::time_point const& now )
+    {
+        assert( ! full() && "can't push a peer into a full k_bucket" );
+
+        peers_.push_back( peer_id, new_peer, ++ last_contact_
+                        , new_statistics( now ), capacity_ );
+    }
+
+    /**
+     *  Flag the peer at the provided position as the most recently seen.
+     *  @note Complexity: O(1)
+     */
+    void
+    touch
+        ( size_type index
+        , timer::clock::time_point const& now )
+    {
+        assert( index < size() && "can't touch a peer outside k_bucket" );
+
+        peers_.last_contacts_[ index ] = ++ last_contact_;
+        peers_.statistics_[ index ].last_seen_ = now;
+    }
+
+    /**
+     *  Remove the peer at the provided position.
+     *  @note The last peer takes its position.
+     */
+    void
+    erase
+        ( size_type index )
+    {
+        assert( index < size() && "can't erase a peer outside k_bucket" );
+
+        peers_.erase( index );
+    }
+
+    /**
+     *  @return The position of the least recently seen peer.
+     *  @note The k_bucket must not be empty.
+     *  @note Complexity: O(k)
+     */
+    size_type
+    least_recently_seen
+        ( void )
+        const
+    {
+        assert( ! empty() && "an empty k_bucket has no peer" );
+
+        return peers_.least_recently_seen();
+    }
+
+    /**
+     *  @return The id of the peer at the provided position.
+     */
+    id const&
+    get_id
+        ( size_type index )
+        const
+    { return peers_.ids_[ index ]; }
+
+    /**
+     *  @return The peer at the provided position.
+     */
+    peer_type const&
+    get_peer
+        ( size_type index )
+        const
+    { return peers_.peers_[ index ]; }
+
+    /**
+     *  @return The statistics of the peer at the provided position.
+     */
+    peer_statistics const&
+    get_statistics
+        ( size_type index )
+        const
+    { return peers_.statistics_[ index ]; }
+
+    /**
+     *  @return The statistics of the peer at the provided position.
+     */
+    peer_statistics &
+    get_statistics
+        ( size_type index )
+    { return peers_.statistics_[ index ]; }
+
+    /**
+     *  @return The number of peers inside the replacement cache.
+     */
+    size_type
+    replacement_count
+        ( void )
+        const
+    { return replacements_.size(); }
+
+    /**
+     *  Save a peer into the replacement cache as the most recently
+     *  seen one. When the cache is full, the least recently seen
+     *  replacement is dropped.
+     *  @note Complexity: O(k)
+     */
+    void
+    push_replacement
+        ( id const& peer_id
+        , peer_type const& new_peer
+        , timer::clock::time_point const& now )
+    {
+        auto const i = replacements_.find( peer_id );
+
+        if ( i != replacements_.size() )
+        {
+            replacements_.peers_[ i ] = new_peer;
+            replacements_.last_contacts_[ i ] = ++ last_contact_;
+            replacements_.statistics_[ i ].last_seen_ = now;
+        }
+        else if ( replacements_.size() != capacity_ )
+            replacements_.push_back( peer_id, new_peer, ++ last_contact_
+                                   , new_statistics( now ), capacity_ );
+        else
+        {
+            auto const j = replacements_.least_recently_seen();
+            replacements_.ids_[ j ] = peer_id;
+            replacements_.peers_[ j ] = new_peer;
+            replacements_.last_contacts_[ j ] = ++ last_contact_;
+            replacements_.statistics_[ j ] = new_statistics( now );
+        }
+    }
+
+    /**
+     *  Remove a peer from the replacement cache.
+     *  @return true if the peer was inside.
+     */
+    bool
+    remove_replacement
+        ( id const& peer_id )
+    {
+        auto const i = replacements_.find( peer_id );
+        if ( i == replacements_.size() )
+            return false;
+
+        replacements_.erase( i );
+
+        return true;
+    }
+
+    /**
+     *  Move the most recently seen replacement into the k_bucket.
+     *  @note The k_bucket must not be full and
+     *        the replacement cache must not be empty.
+     */
+    void
+    promote_replacement
+        ( void )
+    {
+        assert( ! full() && "can't promote into a full k_bucket" );
+        assert( replacement_count() > 0 && "no replacement to promote" );
+
+        auto const& last_contacts = replacements_.last_contacts_;
+        auto const i = size_type( std::distance( last_contacts.begin()
+                                               , std::max_element( last_contacts.begin()
+                                                                 , last_contacts.end() ) ) );
+
+        peers_.push_back( replacements_.ids_[ i ], replacements_.peers_[ i ]
+                        , last_contacts[ i ], replacements_.statistics_[ i ]
+                        , capacity_ );
+        replacements_.erase( i );
+    }
+
+    /**
+     *  Move the peers and replacements whose id
+     *  matches is_moved into the empty k_bucket other.
+     *  @note Contact stamps are kept, hence peers
+     *        keep their recency order.
+     */
+    template< typename Predicate >
+    void
+    split
+        ( k_bucket & other
+        , Predicate const& is_moved )
+    {
+        assert( other.empty() && other.replacement_count() == 0
+              && "can't split into a non empty k_bucket" );
+        assert( other.capacity_ >= capacity_
+              && "can't split into a smaller k_bucket" );
+
+        peers_.move_if( other.peers_, other.capacity_, is_moved );
+        replacements_.move_if( other.replacements_, other.capacity_, is_moved );
+        other.last_contact_ = last_contact_;
+
+        // The least recently seen peer may have moved.
+        has_pending_check_ = false;
+    }
+
+    /**
+     *  @return true if the least recently seen peer
+     *          is being checked.
+     */
+    bool
+    has_pending_check
+        ( void )
+        const
+    { return has_pending_check_; }
+
+    /**
+     *  Flag the least recently seen peer as being checked or not.
+     */
+    void
+    set_pending_check
+        ( bool value )
+    { has_pending_check_ = value; }
+
+private:
+    /**
+     *
+     */
+    static peer_statistics
+    new_statistics
+        ( timer::clock::time_point const& now )
+    {
+        peer_statistics s{};
+        s.last_seen_ = now;
+        return s;
+    }
+
+    /**
+     *  Peers stored as struct of arrays.
+     */
+    struct entries final
+    {
+        /**
+         *
+         */
+        size_type
+        size
+            ( void )
+            const
+        { return ids_.size(); }
+
+        /**
+         *
+         */
+        size_type
+        find
+            ( id const& peer_id )
+            const
+        {
+            auto const i = std::find( ids_.begin(), ids_.end(), peer_id );
+            return size_type( std::distance( ids_.begin(), i ) );
+        }
+
+        /**
+         *
+         */
+        void
+        push_back
+            ( id const& peer_id
+            , peer_type const& new_peer
+            , std::uint64_t last_contact
+            , peer_statistics const& statistics
+            , size_type capacity )
+        {
+            // Allocate the whole array at once
+            // on first insertion.
+            if ( ids_.capacity() == 0 )
+            {
+                ids_.reserve( capacity );
+                peers_.reserve( capacity );
+                last_contacts_.reserve( capacity );
+                statistics_.reserve( capacity );
+            }
+
+            ids_.push_back( peer_id );
+            peers_.push_back( new_peer );
+            last_contacts_.push_back( last_contact );
+            statistics_.push_back( statistics );
+        }
+
+        /**
+         *
+         */
+        void
+        erase
+            ( size_type index )
+        {
+            auto const last = size() - 1;
+            if ( index != last )
+            {
+                ids_[ index ] = ids_[ last ];
+                peers_[ index ] = peers_[ last ];
+                last_contacts_[ index ] = last_contacts_[ last ];
+                statistics_[ index ] = statistics_[ last ];
+            }
+
+            ids_.pop_back();
+            peers_.pop_back();
+            last_contacts_.pop_back();
+            statistics_.pop_back();
+        }
+
+        /**
+         *
+         */
+        template< typename Predicate >
+        void
+        move_if
+            ( entries & other
+            , size_type capacity
+            , Predicate const& is_moved )
+        {
+            // Walk backward as erase() swaps the last entry in.
+            for ( auto i = size(); i > 0; -- i )
+                if ( is_moved( ids_[ i - 1 ] ) )
+                {
+                    other.push_back( ids_[ i - 1 ], peers_[ i - 1 ]
+                                   , last_contacts_[ i - 1 ]
+                                   , statistics_[ i - 1 ], capacity );
+                    erase( i - 1 );
+                }
+        }
+
+        /**
+         *
+         */
+        size_type
+        least_recently_seen
+            ( void )
+            const
+        {
+            auto const i = std::min_element( last_contacts_.begin()
+                                           , last_contacts_.end() );
+            return size_type( std::distance( last_contacts_.begin(), i ) );
+        }
+
+        /// Peer ids, packed together.
+        std::vector< id > ids_;
+        /// Peers, at the same position as their id.
+        std::vector< peer_type > peers_;
+        /// Contact stamps, at the same position as their id.
+        std::vector< std::uint64_t > last_contacts_;
+        /// Statistics, at the same position as their id.
+        std::vector< peer_statistics > statistics_;
+    };
+
+private:
+    /// Peers of the k_bucket.
+    entries peers_;
+    /// Peers waiting for room in the k_bucket.
+    entries replacements_;
+    /// The maximum number of peers (and replacements).
+    size_type capacity_;
+    /// Incremented on each contact.
+    std::uint64_t last_contact_;
+    /// Set while the least recently seen peer is being checked.
+    bool has_pending_check_;
+};
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
@@ -0,0 +1,221 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_KEY_BATCH_HPP
+#define KADEMLIA_KEY_BATCH_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "kademlia/id.hpp"
+#include "kademlia/peer.hpp"
+#include "kademlia/message.hpp"
+#include "kademlia/constants.hpp"
+
+namespace kademlia {
+namespace detail {
+
+///
+using key_indexes_type = std::vector< std::size_t >;
+
+/**
+ *  @brief Split indexes of ids into groups of
+ *         ids sharing their prefix_bit_size first bits.
+ *  @details
+ *  Such ids have mostly the same closest peers,
+ *  hence a single lookup can serve a whole group.
+ *  The indexes of a group are sorted by id.
+ */
+inline std::vector< key_indexes_type >
+group_by_prefix
+    ( std::vector< id > const& ids
+    , key_indexes_type sorted
+    , std::size_t prefix_bit_size )
+{
+    // The distance from the null id is the id itself.
+    id const origin{};
+    std::sort( sorted.begin(), sorted.end()
+             , [ &ids, &origin ]( std::size_t a, std::size_t b )
+               { return is_closer( ids[ a ], ids[ b ], origin ); } );
+
+    std::vector< key_indexes_type > groups;
+    for ( auto const i : sorted )
+    {
+        if ( groups.empty()
+           || common_prefix_length( ids[ groups.back().front() ], ids[ i ] )
+              < prefix_bit_size )
+            groups.emplace_back();
+
+        groups.back().push_back( i );
+    }
+
+    return groups;
+}
+
+/**
+ *  @brief Return the count of leading bits the keys of a group
+ *         must share for its lookup to serve them all.
+ *  @details
+ *  In a network of N peers, the k closest peers of an id share
+ *  about log2(N / k) leading bits with it. This depth is read
+ *  from the bits shared with my_id by its k closest known peers,
+ *  as the routing table is complete around our id. Keys sharing
+ *  2 more bits mostly have the same k closest peers, see
+ *  are_closest_peers_of(). BATCH_KEY_PREFIX_BIT_SIZE is the least
+ *  count used, which keeps the groups narrow in small networks.
+ *  @param i,e Known peers, as pairs whose first member is the id.
+ */
+template< typename PeerIterator >
+std::size_t
+get_group_prefix_bit_size
+    ( id const& my_id
+    , PeerIterator i
+    , PeerIterator e )
+{
+    std::vector< std::size_t > counts( id::BIT_SIZE + 1 );
+    for ( ; i != e; ++ i )
+        ++ counts[ common_prefix_length( i->first, my_id ) ];
+
+    // The deepest prefix shared by k peers.
+    std::size_t depth = counts.size();
+    std::size_t closest_count = 0;
+    while ( depth > 0 && closest_count < ROUTING_TABLE_BUCKET_SIZE )
+        closest_count += counts[ -- depth ];
+
+    return std::min( id::BIT_SIZE
+                   , std::max( BATCH_KEY_PREFIX_BIT_SIZE, depth + 2 ) );
+}
+
+/**
+ *  @brief Check whether the count closest peers of key are
+ *         surely among peers, the k closest peers of group_key.
+ *  @details
+ *  A peer missing from peers shares at most m leading bits
+ *  with group_key, m being the least count shared with it by
+ *  peers. When key shares more than m bits with group_key,
+ *  such a peer shares at most m bits with key too, hence it's
+ *  farther from key than any of peers sharing more than m bits
+ *  with key. With fewer than k peers, the lookup has reached
+ *  all the peers which respond.
+ */
+inline bool
+are_closest_peers_of
+    ( id const& key
+    , id const& group_key
+    , std::vector< peer > const& peers
+    , std::size_t count )
+{
+    if ( peers.size() < ROUTING_TABLE_BUCKET_SIZE )
+        return true;
+
+    std::size_t shared_bit_count = id::BIT_SIZE;
+    for ( auto const& p : peers )
+        shared_bit_count = std::min( shared_bit_count
+                                   , common_prefix_length( p.id_, group_key ) );
+
+    if ( common_prefix_length( key, group_key ) <= shared_bit_count )
+        return false;
+
+    auto const closer_count = std::count_if( peers.begin(), peers.end()
+            , [ &key, shared_bit_count ]( peer const& p )
+              { return common_prefix_length( p.id_, key ) > shared_bit_count; } );
+
+    return std::size_t( closer_count ) >= count;
+}
+
+/**
+ *  @brief Assign each key of a group to its count
+ *         closest peers among the group's peers.
+ *  @return The indexes of the keys assigned to each peer.
+ */
+inline std::vector< key_indexes_type >
+assign_to_closest_peers
+    ( std::vector< id > const& ids
+    , key_indexes_type const& group
+    , std::vector< peer > const& peers
+    , std::size_t count )
+{
+    std::vector< key_indexes_type > assignments( peers.size() );
+
+    key_indexes_type closest( peers.size() );
+    count = std::min( count, peers.size() );
+
+    for ( auto const i : group )
+    {
+        std::iota( closest.begin(), closest.end(), std::size_t{ 0 } );
+        std::partial_sort( closest.begin(), closest.begin() + count
+                         , closest.end()
+                         , [ &ids, &peers, i ]( std::size_t a, std::size_t b )
+                           { return is_closer( peers[ a ].id_, peers[ b ].id_
+                                             , ids[ i ] ); } );
+
+        for ( std::size_t j = 0; j != count; ++ j )
+            assignments[ closest[ j ] ].push_back( i );
+    }
+
+    return assignments;
+}
+
+/**
+ *  @brief Split entries into batch bodies whose message
+ *         doesn't exceed max_size, an entry too large
+ *         being sent alone.
+ */
+template< typename Entry >
+std::vector< std::vector< Entry > >
+split_into_messages
+    ( std::vector< Entry > entries
+    , std::size_t max_size )
+{
+    std::vector< std::vector< Entry > > messages;
+
+    std::size_t size = 0;
+    for ( auto & e : entries )
+    {
+        auto const entry_size = get_serialized_size( e );
+        if ( messages.empty()
+           || ( ! messages.back().empty() && size + entry_size > max_size ) )
+        {
+            messages.emplace_back();
+            size = get_batch_message_overhead();
+        }
+
+        messages.back().push_back( std::move( e ) );
+        size += entry_size;
+    }
+
+    return messages;
+}
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
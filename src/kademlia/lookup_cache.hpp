@@ -0,0 +1,193 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_LOOKUP_CACHE_HPP
+#define KADEMLIA_LOOKUP_CACHE_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <cassert>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "kademlia/id.hpp"
+#include "kademlia/peer.hpp"
+#include "kademlia/timer.hpp"
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  @brief Remember the closest peers found by recent lookups.
+ *  @details
+ *  Entries are keyed by the leading bits of the looked
+ *  up key, hence a lookup of a nearby key can start from
+ *  the peers which responded instead of walking the
+ *  network again. Entries expire after a while, and the
+ *  least recently used one is dropped when full.
+ */
+class lookup_cache final
+{
+public:
+    /**
+     *
+     */
+    lookup_cache
+        ( std::size_t max_size
+        , timer::duration const& ttl
+        , std::size_t prefix_bit_size )
+            : max_size_( max_size )
+            , ttl_( ttl )
+            , prefix_bit_size_( prefix_bit_size )
+            , entries_()
+            , index_()
+    {
+        assert( prefix_bit_size <= id::BIT_PER_WORD
+              && "the prefix must fit in the first word of the key" );
+    }
+
+    /**
+     *  @brief Copy the peers recently found close to key.
+     *  @return false if there is no fresh entry.
+     */
+    bool
+    find
+        ( id const& key
+        , std::vector< peer > & peers )
+    {
+        auto const i = index_.find( get_prefix( key ) );
+        if ( i == index_.end() )
+            return false;
+
+        if ( timer::clock::now() - i->second->save_time_ >= ttl_ )
+        {
+            entries_.erase( i->second );
+            index_.erase( i );
+            return false;
+        }
+
+        // Move the entry in front of the list.
+        entries_.splice( entries_.begin(), entries_, i->second );
+        peers = i->second->peers_;
+
+        return true;
+    }
+
+    /**
+     *  @brief Remember the peers found close to key.
+     */
+    void
+    save
+        ( id const& key
+        , std::vector< peer > peers )
+    {
+        if ( peers.empty() || max_size_ == 0 )
+            return;
+
+        auto const prefix = get_prefix( key );
+
+        auto const i = index_.find( prefix );
+        if ( i != index_.end() )
+        {
+            entries_.erase( i->second );
+            index_.erase( i );
+        }
+        else if ( entries_.size() == max_size_ )
+        {
+            index_.erase( entries_.back().prefix_ );
+            entries_.pop_back();
+        }
+
+        entries_.push_front( entry{ prefix
+                                  , std::move( peers )
+                                  , timer::clock::now() } );
+        index_.emplace( prefix, entries_.begin() );
+    }
+
+    /**
+     *
+     */
+    std::size_t
+    size
+        ( void )
+        const
+    { return entries_.size(); }
+
+private:
+    ///
+    struct entry final
+    {
+        std::uint64_t prefix_;
+        std::vector< peer > peers_;
+        timer::clock::time_point save_time_;
+    };
+
+    ///
+    using entries_type = std::list< entry >;
+
+    ///
+    using index_type = std::unordered_map
+            < std::uint64_t
+            , entries_type::iterator >;
+
+private:
+    /**
+     *
+     */
+    std::uint64_t
+    get_prefix
+        ( id const& key )
+        const
+    {
+        // Shifting a word by its own size is undefined.
+        if ( prefix_bit_size_ == 0 )
+            return 0;
+
+        return to_big_endian_value( key.words()[ 0 ] )
+                >> ( id::BIT_PER_WORD - prefix_bit_size_ );
+    }
+
+private:
+    ///
+    std::size_t max_size_;
+    ///
+    timer::duration ttl_;
+    ///
+    std::size_t prefix_bit_size_;
+    /// Most recently used first.
+    entries_type entries_;
+    ///
+    index_type index_;
+};
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
+
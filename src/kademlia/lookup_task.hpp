@@ -30,17 +30,49 @@
 #   pragma once
 #endif
 
+#include <algorithm>
 #include <cassert>
-#include <map>
 #include <vector>
 
+#include "kademlia/lookup_cache.hpp"
 #include "kademlia/peer.hpp"
+#include "kademlia/peer_statistics.hpp"
+#include "kademlia/timer.hpp"
 #include "kademlia/log.hpp"
+#include "kademlia/constants.hpp"
 
 namespace kademlia {
 namespace detail {
 
-///
+/**
+ *  @brief Totals of the lookups performed by tasks.
+ */
+struct lookup_statistics final
+{
+    ///
+    std::size_t lookups_count_;
+    /// Sum of the hops count of each lookup.
+    std::size_t hops_count_;
+    /// Sum of the requests sent by each lookup.
+    std::size_t requests_count_;
+};
+
+/**
+ *  The candidates are kept sorted by distance to the key
+ *  into a bounded array, the farthest ones being dropped
+ *  when it's full. As all candidates before the first
+ *  unknown one have already been contacted, selecting
+ *  new candidates starts from this position. Likewise
+ *  the count of candidates which responded is kept for
+ *  the leading candidates whose request has completed,
+ *  so that checking whether the lookup converged
+ *  doesn't scan the candidates.
+ *
+ *  A request still waiting for its response after the
+ *  soft timeout is stalled: it stops counting as in flight
+ *  so that another candidate can be queried meanwhile,
+ *  but its response is still accepted.
+ */
 class lookup_task
 {
 public:
@@ -58,6 +90,34 @@ public:
     flag_candidate_as_invalid
         ( id const& candidate_id );
 
+    /**
+     *  @brief Flag a contacted candidate as slow to respond.
+     *  @return true if another candidate can be
+     *          queried in its stead.
+     */
+    bool
+    flag_candidate_as_stalled
+        ( id const& candidate_id );
+
+    /**
+     *  @brief Account for a response received after rtt.
+     */
+    void
+    record_response_time
+        ( timer::duration const& rtt );
+
+    /**
+     *  @brief Return the delay after which a request
+     *         is considered stalled.
+     *  @details
+     *  It's derived from the response times observed by
+     *  this lookup as TCP derives its retransmission timeout.
+     */
+    timer::duration
+    get_soft_timeout
+        ( void )
+        const;
+
     /**
      *
      */
@@ -72,6 +132,20 @@ public:
     select_closest_valid_candidates
         ( std::size_t max_count );
 
+    /**
+     *  @brief Select the closest candidate which responded,
+     *         excluding excluded_id.
+     *  @param closer_count Receives the count of candidates
+     *         closer to the key than the selected one.
+     *  @return false if there is no such candidate.
+     */
+    bool
+    select_closest_valid_candidate
+        ( id const& excluded_id
+        , peer & selected
+        , std::size_t & closer_count )
+        const;
+
     /**
      *
      */
@@ -80,6 +154,16 @@ public:
     add_candidates 
         ( Peers const& peers );
 
+    /**
+     *  @brief Add peers returned by sender_id, they
+     *         are one hop farther than sender_id.
+     */
+    template< typename Peers >
+    void
+    add_candidates
+        ( Peers const& peers
+        , id const& sender_id );
+
     /**
      *
      */
@@ -88,6 +172,35 @@ public:
         ( void )
         const;
 
+    /**
+     *  @brief Check whether the count closest candidates
+     *         have responded while no closer one is pending.
+     *  @details
+     *  Timeouted candidates are skipped. Once true,
+     *  querying farther candidates is useless.
+     */
+    bool
+    have_closest_candidates_responded
+        ( std::size_t count )
+        const;
+
+    /**
+     *  @brief Return the hops count of the farthest
+     *         candidate which responded.
+     */
+    std::size_t
+    get_hops_count
+        ( void )
+        const;
+
+    /**
+     *
+     */
+    std::size_t
+    get_requests_count
+        ( void )
+        const;
+
     /**
      *
      */
@@ -111,6 +224,46 @@ protected:
         ( id const & key
         , Iterator i, Iterator e );
 
+    /**
+     *  Seed the candidates with the peers
+     *  of routing_table closest to key.
+     */
+    template< typename RoutingTableType >
+    lookup_task
+        ( id const & key
+        , RoutingTableType & routing_table );
+
+    /**
+     *  @brief Add this lookup to statistics if not null.
+     */
+    void
+    record_statistics
+        ( lookup_statistics * statistics )
+        const;
+
+    /**
+     *  @brief Add the peers a recent lookup found close
+     *         to the key, if cache is not null.
+     *  @details
+     *  They're all queried by the first round, hence when
+     *  the k closest candidates respond without knowing
+     *  closer peers, the lookup completes within one round
+     *  trip. Otherwise it proceeds as usual: the cache is
+     *  shared by the keys of a prefix, hence they're not
+     *  necessarily the closest peers of this key.
+     */
+    void
+    add_cached_candidates
+        ( lookup_cache * cache );
+
+    /**
+     *  @brief Save the closest candidates which
+     *         responded into cache if not null.
+     */
+    void
+    record_closest_candidates
+        ( lookup_cache * cache );
+
 private:
     ///
     struct candidate final
@@ -119,21 +272,41 @@ private:
         enum {
             STATE_UNKNOWN,
             STATE_CONTACTED,
+            STATE_STALLED,
             STATE_RESPONDED,
             STATE_TIMEOUTED,
         } state_;
+        /// The routing table peers are one hop away.
+        std::size_t hops_count_;
     };
 
     ///
-    using candidates_type = std::map< id, candidate >;
+    using candidates_type = std::vector< candidate >;
 
 private:
+    /**
+     *  @brief Return the count of candidates kept, i.e. k
+     *         plus alpha times the k peers of a response.
+     */
+    static std::size_t
+    get_max_candidates_count
+        ( void );
+
     /**
      *
      */
     void
     add_candidate
-        ( peer const& p );
+        ( peer const& p
+        , std::size_t hops_count );
+
+    /**
+     *  @brief Return the position of the first candidate
+     *         not closer to key than candidate_id.
+     */
+    candidates_type::iterator
+    lower_bound
+        ( id const& candidate_id );
 
     /**
      *
@@ -142,13 +315,58 @@ private:
     find_candidate
         ( id const& candidate_id );
 
+    /**
+     *
+     */
+    void
+    flag_candidate
+        ( id const& candidate_id
+        , decltype( candidate::state_ ) state );
+
+    /**
+     *  @brief Extend the completed prefix over the
+     *         candidates which completed in the meantime.
+     */
+    void
+    extend_completed_prefix
+        ( void );
+
+    /**
+     *  @brief Shrink the completed prefix so that it
+     *         ends before the candidate at index.
+     */
+    void
+    shrink_completed_prefix
+        ( std::size_t index );
+
+    /**
+     *
+     */
+    static bool
+    has_completed
+        ( candidate const& c );
+
 private:
     ///
     id key_;
     ///
     std::size_t in_flight_requests_count_;
     ///
+    std::size_t stalled_requests_count_;
+    ///
+    std::size_t requests_count_;
+    /// Count of cached candidates the first round queries at once.
+    std::size_t cached_candidates_count_;
+    ///
+    peer_statistics response_times_;
+    ///
     candidates_type candidates_;
+    /// Index of the first candidate which may be unknown.
+    std::size_t next_candidate_index_;
+    /// Count of leading candidates which responded or timeouted.
+    std::size_t completed_prefix_size_;
+    /// Count of candidates which responded within this prefix.
+    std::size_t completed_prefix_responded_count_;
 };
 
 inline
@@ -163,36 +381,94 @@ lookup_task::lookup_task
     , Iterator i, Iterator e )
         : key_{ key }
         , in_flight_requests_count_{ 0 }
+        , stalled_requests_count_{ 0 }
+        , requests_count_{ 0 }
+        , cached_candidates_count_{ 0 }
+        , response_times_{}
         , candidates_{}
+        , next_candidate_index_{ 0 }
+        , completed_prefix_size_{ 0 }
+        , completed_prefix_responded_count_{ 0 }
 {
     for ( ; i != e; ++i )
-        add_candidate( peer{ i->first, i->second } );
+        add_candidate( peer{ i->first, i->second }, 1 );
+}
+
+template< typename RoutingTableType >
+inline
+lookup_task::lookup_task
+    ( id const & key
+    , RoutingTableType & routing_table )
+        : key_{ key }
+        , in_flight_requests_count_{ 0 }
+        , stalled_requests_count_{ 0 }
+        , requests_count_{ 0 }
+        , cached_candidates_count_{ 0 }
+        , response_times_{}
+        , candidates_{}
+        , next_candidate_index_{ 0 }
+        , completed_prefix_size_{ 0 }
+        , completed_prefix_responded_count_{ 0 }
+{
+    std::vector< typename RoutingTableType::value_type > closest_peers;
+    routing_table.find_closest( key, ROUTING_TABLE_BUCKET_SIZE
+                              , closest_peers );
+
+    for ( auto const& p : closest_peers )
+        add_candidate( peer{ p.first, p.second }, 1 );
 }
 
 inline void
 lookup_task::flag_candidate_as_valid
     ( id const& candidate_id )
+{ flag_candidate( candidate_id, candidate::STATE_RESPONDED ); }
+
+inline void
+lookup_task::flag_candidate_as_invalid
+    ( id const& candidate_id )
+{ flag_candidate( candidate_id, candidate::STATE_TIMEOUTED ); }
+
+inline bool
+lookup_task::flag_candidate_as_stalled
+    ( id const& candidate_id )
 {
+    // At most twice as many requests as usual are in flight.
+    if ( stalled_requests_count_ == CONCURRENT_FIND_PEER_REQUESTS_COUNT )
+        return false;
+
     auto i = find_candidate( candidate_id );
     if ( i == candidates_.end()
-       && i->second.state_ == candidate::STATE_CONTACTED )
-        return;
+       || i->state_ != candidate::STATE_CONTACTED )
+        return false;
 
     -- in_flight_requests_count_;
-    i->second.state_ = candidate::STATE_RESPONDED;
+    ++ stalled_requests_count_;
+    i->state_ = candidate::STATE_STALLED;
+
+    return true;
 }
 
 inline void
-lookup_task::flag_candidate_as_invalid
-    ( id const& candidate_id )
+lookup_task::record_response_time
+    ( timer::duration const& rtt )
+{ record_response( response_times_, rtt, timer::clock::now() ); }
+
+inline timer::duration
+lookup_task::get_soft_timeout
+    ( void )
+    const
 {
-    auto i = find_candidate( candidate_id );
-    if ( i == candidates_.end()
-       && i->second.state_ == candidate::STATE_CONTACTED )
-        return;
+    timer::duration const min_timeout = PEER_LOOKUP_TIMEOUT / 8;
+    timer::duration const max_timeout = PEER_LOOKUP_TIMEOUT / 2;
 
-    -- in_flight_requests_count_;
-    i->second.state_ = candidate::STATE_TIMEOUTED;
+    if ( response_times_.responses_count_ == 0 )
+        return max_timeout;
+
+    // RTO = SRTT + 4 RTTVAR
+    auto const timeout = response_times_.smoothed_rtt_
+                       + 4 * response_times_.rtt_variance_;
+
+    return std::min( std::max( timeout, min_timeout ), max_timeout );
 }
 
 inline std::vector< peer >
@@ -201,21 +477,30 @@ lookup_task::select_new_closest_candidates
 {
     std::vector< peer > candidates;
 
-    // Iterate over all candidates until we picked
-    // candidates_max_count not-contacted candidates.
-    for ( auto i = candidates_.begin(), e = candidates_.end()
+    // The cached candidates are verified all at once.
+    max_count = std::max( max_count, cached_candidates_count_ );
+    cached_candidates_count_ = 0;
+
+    // Iterate over the candidates following the last contacted
+    // one until we picked max_count in flight requests.
+    for ( auto i = candidates_.begin() + next_candidate_index_
+             , e = candidates_.end()
         ; i != e && in_flight_requests_count_ < max_count
         ; ++ i )
     {
-        if ( i->second.state_ == candidate::STATE_UNKNOWN )
+        if ( i->state_ == candidate::STATE_UNKNOWN )
         {
-            i->second.state_ = candidate::STATE_CONTACTED;
+            i->state_ = candidate::STATE_CONTACTED;
             ++ in_flight_requests_count_;
-            candidates.push_back( i->second.peer_ );
+            ++ requests_count_;
+            candidates.push_back( i->peer_ );
         }
+
+        if ( next_candidate_index_ == std::size_t( i - candidates_.begin() ) )
+            ++ next_candidate_index_;
     }
 
-    return std::move( candidates );
+    return candidates;
 }
 
 inline std::vector< peer >
@@ -230,11 +515,33 @@ lookup_task::select_closest_valid_candidates
         ; i != e && candidates.size() < max_count
         ; ++ i )
     {
-        if ( i->second.state_ == candidate::STATE_RESPONDED )
-            candidates.push_back( i->second.peer_ );
+        if ( i->state_ == candidate::STATE_RESPONDED )
+            candidates.push_back( i->peer_ );
     }
 
-    return std::move( candidates );
+    return candidates;
+}
+
+inline bool
+lookup_task::select_closest_valid_candidate
+    ( id const& excluded_id
+    , peer & selected
+    , std::size_t & closer_count )
+    const
+{
+    for ( std::size_t i = 0, e = candidates_.size(); i != e; ++ i )
+    {
+        auto const& c = candidates_[ i ];
+        if ( c.state_ == candidate::STATE_RESPONDED
+           && c.peer_.id_ != excluded_id )
+        {
+            selected = c.peer_;
+            closer_count = i;
+            return true;
+        }
+    }
+
+    return false;
 }
 
 template< typename Peers >
@@ -243,14 +550,60 @@ lookup_task::add_candidates
     ( Peers const& peers )
 {
     for ( auto const& p : peers )
-        add_candidate( p );
+        add_candidate( p, 1 );
+}
+
+template< typename Peers >
+inline void
+lookup_task::add_candidates
+    ( Peers const& peers
+    , id const& sender_id )
+{
+    // Look for the sender before the insertions
+    // invalidate the iterator.
+    auto const sender = find_candidate( sender_id );
+    auto const hops_count = sender == candidates_.end()
+                          ? 1 : sender->hops_count_ + 1;
+
+    for ( auto const& p : peers )
+        add_candidate( p, hops_count );
 }
 
 inline bool
 lookup_task::have_all_requests_completed
     ( void )
     const
-{ return in_flight_requests_count_ == 0; }
+{ return in_flight_requests_count_ == 0 && stalled_requests_count_ == 0; }
+
+inline bool
+lookup_task::have_closest_candidates_responded
+    ( std::size_t count )
+    const
+{
+    // The candidate following the completed prefix, if
+    // any, may still provide closer peers.
+    return completed_prefix_responded_count_ >= count;
+}
+
+inline std::size_t
+lookup_task::get_hops_count
+    ( void )
+    const
+{
+    std::size_t hops_count = 0;
+
+    for ( auto const& c : candidates_ )
+        if ( c.state_ == candidate::STATE_RESPONDED )
+            hops_count = std::max( hops_count, c.hops_count_ );
+
+    return hops_count;
+}
+
+inline std::size_t
+lookup_task::get_requests_count
+    ( void )
+    const
+{ return requests_count_; }
 
 inline id const&
 lookup_task::get_key
@@ -258,28 +611,180 @@ lookup_task::get_key
     const
 { return key_; }
 
+inline void
+lookup_task::record_statistics
+    ( lookup_statistics * statistics )
+    const
+{
+    if ( ! statistics )
+        return;
+
+    ++ statistics->lookups_count_;
+    statistics->hops_count_ += get_hops_count();
+    statistics->requests_count_ += get_requests_count();
+}
+
+inline void
+lookup_task::add_cached_candidates
+    ( lookup_cache * cache )
+{
+    std::vector< peer > peers;
+    if ( ! cache || ! cache->find( key_, peers ) )
+        return;
+
+    for ( auto const& p : peers )
+        add_candidate( p, 1 );
+
+    cached_candidates_count_ = peers.size();
+}
+
+inline void
+lookup_task::record_closest_candidates
+    ( lookup_cache * cache )
+{
+    // Only the candidates which responded are
+    // saved, hence an entry is refreshed once verified.
+    if ( ! cache || requests_count_ == 0 )
+        return;
+
+    cache->save( key_, select_closest_valid_candidates
+            ( ROUTING_TABLE_BUCKET_SIZE ) );
+}
+
+inline std::size_t
+lookup_task::get_max_candidates_count
+    ( void )
+{
+    return ROUTING_TABLE_BUCKET_SIZE
+         * ( 1 + CONCURRENT_FIND_PEER_REQUESTS_COUNT );
+}
+
 inline void
 lookup_task::add_candidate
-    ( peer const& p )
+    ( peer const& p
+    , std::size_t hops_count )
 {
+    auto const max_count = get_max_candidates_count();
+
+    // Too far to be kept.
+    if ( candidates_.size() == max_count
+       && ! is_closer( p.id_, candidates_.back().peer_.id_, key_ ) )
+        return;
+
+    auto i = lower_bound( p.id_ );
+    if ( i != candidates_.end() && i->peer_.id_ == p.id_ )
+        return;
+
     LOG_DEBUG( lookup_task, this )
             << "adding '" << p << "'." << std::endl;
 
-    auto const d = distance( p.id_, key_ );
-    candidate const c{ p, candidate::STATE_UNKNOWN };
-    candidates_.emplace( d, c );
+    auto const index = std::size_t( i - candidates_.begin() );
+    next_candidate_index_ = std::min( next_candidate_index_, index );
+    shrink_completed_prefix( index );
+    candidates_.insert( i, candidate{ p
+                                    , candidate::STATE_UNKNOWN
+                                    , hops_count } );
+
+    if ( candidates_.size() <= max_count )
+        return;
+
+    // The response of a dropped candidate
+    // is no longer waited for.
+    if ( candidates_.back().state_ == candidate::STATE_CONTACTED )
+        -- in_flight_requests_count_;
+    else if ( candidates_.back().state_ == candidate::STATE_STALLED )
+        -- stalled_requests_count_;
+
+    candidates_.pop_back();
+    next_candidate_index_ = std::min( next_candidate_index_
+                                    , candidates_.size() );
+}
+
+inline lookup_task::candidates_type::iterator
+lookup_task::lower_bound
+    ( id const& candidate_id )
+{
+    auto is_closer_to_key = [ this ]
+        ( candidate const& c, id const& i )
+    { return is_closer( c.peer_.id_, i, key_ ); };
+
+    return std::lower_bound( candidates_.begin(), candidates_.end()
+                           , candidate_id, is_closer_to_key );
 }
 
 inline lookup_task::candidates_type::iterator
 lookup_task::find_candidate
     ( id const& candidate_id )
 {
-    auto const d = distance( candidate_id, key_ );
-    return candidates_.find( d );
+    auto i = lower_bound( candidate_id );
+    if ( i != candidates_.end() && i->peer_.id_ != candidate_id )
+        return candidates_.end();
+
+    return i;
+}
+
+inline void
+lookup_task::flag_candidate
+    ( id const& candidate_id
+    , decltype( candidate::state_ ) state )
+{
+    // Ignore unknown candidates (e.g. dropped ones)
+    // and the ones whose response has been handled.
+    auto i = find_candidate( candidate_id );
+    if ( i == candidates_.end() )
+        return;
+
+    if ( i->state_ == candidate::STATE_CONTACTED )
+        -- in_flight_requests_count_;
+    else if ( i->state_ == candidate::STATE_STALLED )
+        -- stalled_requests_count_;
+    else
+        return;
+
+    i->state_ = state;
+
+    if ( std::size_t( i - candidates_.begin() ) == completed_prefix_size_ )
+        extend_completed_prefix();
+}
+
+inline void
+lookup_task::extend_completed_prefix
+    ( void )
+{
+    for ( auto const e = candidates_.size()
+        ; completed_prefix_size_ != e
+          && has_completed( candidates_[ completed_prefix_size_ ] )
+        ; ++ completed_prefix_size_ )
+    {
+        if ( candidates_[ completed_prefix_size_ ].state_
+                == candidate::STATE_RESPONDED )
+            ++ completed_prefix_responded_count_;
+    }
+}
+
+inline void
+lookup_task::shrink_completed_prefix
+    ( std::size_t index )
+{
+    // A candidate is seldom found closer than the
+    // ones which already responded.
+    for ( ; completed_prefix_size_ > index; -- completed_prefix_size_ )
+    {
+        if ( candidates_[ completed_prefix_size_ - 1 ].state_
+                == candidate::STATE_RESPONDED )
+            -- completed_prefix_responded_count_;
+    }
+}
+
+inline bool
+lookup_task::has_completed
+    ( candidate const& c )
+{
+    return c.state_ == candidate::STATE_RESPONDED
+        || c.state_ == candidate::STATE_TIMEOUTED;
 }
 
 } // namespace detail
 } // namespace kademlia
 
 #endif
-
@@ -74,12 +74,11 @@ deserialize_integer
 
 inline void
 serialize
-    ( std::vector< std::uint8_t > data
+    ( std::vector< std::uint8_t > const& data
     , buffer & b )
 {
     serialize_integer( data.size(), b );
-    for ( auto const& d : data )
-        b.push_back( d );
+    b.insert( b.end(), data.begin(), data.end() );
 }
 
 /**
@@ -89,25 +88,46 @@ inline std::error_code
 deserialize
     ( buffer::const_iterator & i
     , buffer::const_iterator e
-    , std::vector< std::uint8_t > & data )
+    , buffer_view & data )
 {
     std::uint64_t size;
     auto failure = deserialize_integer( i, e, size );
     if ( failure )
         return failure;
 
-    if ( std::size_t( std::distance( i, e ) ) < size )
+    if ( std::uint64_t( std::distance( i, e ) ) < size )
         return make_error_code( CORRUPTED_BODY );
 
-    for ( ; size > 0; -- size )
-        data.push_back( *i++ );
+    data.begin_ = i;
+    std::advance( i, size );
+    data.end_ = i;
 
     return std::error_code{};
 }
 
+/**
+ *
+ */
+inline std::error_code
+deserialize
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , std::vector< std::uint8_t > & data )
+{
+    buffer_view view;
+    auto failure = deserialize( i, e, view );
+    if ( failure )
+        return failure;
+
+    data.assign( view.begin(), view.end() );
+
+    return std::error_code{};
+}
+
+template< std::size_t BitSize, typename Hasher >
 inline void
 serialize
-    ( id const& i
+    ( basic_id< BitSize, Hasher > const& i
     , buffer & b )
 {
     std::copy( i.begin()
@@ -118,17 +138,22 @@ serialize
 /**
  *
  */
+template< std::size_t BitSize, typename Hasher >
 inline std::error_code
 deserialize
     ( buffer::const_iterator & i
     , buffer::const_iterator e
-    , id & new_id )
+    , basic_id< BitSize, Hasher > & new_id )
 {
-    if ( std::size_t( std::distance( i, e ) ) < id::BLOCKS_COUNT )
+    // The serialized length is known at compile time.
+    CXX11_CONSTEXPR std::size_t SIZE
+            = basic_id< BitSize, Hasher >::BLOCKS_COUNT;
+
+    if ( std::size_t( std::distance( i, e ) ) < SIZE )
         return make_error_code( TRUNCATED_ID );
 
-    std::copy_n( i, id::BLOCKS_COUNT, new_id.begin() );
-    std::advance( i, id::BLOCKS_COUNT );
+    std::copy_n( i, SIZE, new_id.begin() );
+    std::advance( i, SIZE );
 
     return std::error_code{};
 }
@@ -165,21 +190,20 @@ enum
  *
  */
 inline void
-serialize
-    ( boost::asio::ip::address const& address
+serialize_address
+    ( ip_endpoint const& endpoint
     , buffer & b )
 {
-    if ( address.is_v4() )
+    auto const& a = endpoint.address_;
+
+    if ( is_ipv4( endpoint ) )
     {
         b.push_back( KADEMLIA_ENDPOINT_SERIALIZATION_IPV4 );
-        auto const& a = address.to_v4().to_bytes();
-        b.insert( b.end(), a.begin(), a.end() );
+        b.insert( b.end(), a.begin(), std::next( a.begin(), 4 ) );
     }
     else
     {
-        assert( address.is_v6() && "unknown IP version" );
         b.push_back( KADEMLIA_ENDPOINT_SERIALIZATION_IPV6 );
-        auto const& a = address.to_v6().to_bytes();
         b.insert( b.end(), a.begin(), a.end() );
     }
 }
@@ -187,59 +211,38 @@ serialize
 /**
  *
  */
-template< typename Address >
 inline std::error_code
 deserialize_address
     ( buffer::const_iterator & i
     , buffer::const_iterator e
-    , Address & address )
-{
-    typename Address::bytes_type buffer;
-    if ( std::size_t( std::distance( i, e ) ) < buffer.size() )
-        return make_error_code( TRUNCATED_ADDRESS );
-
-    std::copy_n( i, buffer.size(), buffer.begin() );
-    std::advance( i, buffer.size() );
-
-    address = Address{ buffer };
-
-    return std::error_code{};
-}
-
-/**
- *
- */
-inline std::error_code
-deserialize
-    ( buffer::const_iterator & i
-    , buffer::const_iterator e
-    , boost::asio::ip::address & address )
+    , ip_endpoint & endpoint )
 {
     if ( std::distance( i, e ) < 1 )
         return make_error_code( TRUNCATED_ENDPOINT );
 
     auto const protocol = *i++;
+    std::size_t size;
     if ( protocol == KADEMLIA_ENDPOINT_SERIALIZATION_IPV4 )
     {
-        boost::asio::ip::address_v4 a;
-        auto const failure = deserialize_address( i, e, a );
-        if ( failure )
-            return failure;
-
-        address = a;
+        endpoint.family_ = ip_endpoint::IPV4;
+        size = 4;
     }
-    else
+    else if ( protocol == KADEMLIA_ENDPOINT_SERIALIZATION_IPV6 )
     {
-        assert( protocol == KADEMLIA_ENDPOINT_SERIALIZATION_IPV6
-              && "unknown IP version");
+        endpoint.family_ = ip_endpoint::IPV6;
+        size = endpoint.address_.size();
+    }
+    else
+        return make_error_code( CORRUPTED_BODY );
 
-        boost::asio::ip::address_v6 a;
-        auto const failure = deserialize_address( i, e, a );
-        if ( failure )
-            return failure;
+    if ( std::size_t( std::distance( i, e ) ) < size )
+        return make_error_code( TRUNCATED_ADDRESS );
 
-        address = a;
-    }
+    // The scope of a link-local address isn't sent.
+    endpoint.scope_id_ = 0;
+    endpoint.address_.fill( 0 );
+    std::copy_n( i, size, endpoint.address_.begin() );
+    std::advance( i, size );
 
     return std::error_code{};
 }
@@ -254,7 +257,7 @@ serialize
 {
     serialize( n.id_, b );
     serialize_integer( n.endpoint_.port_, b );
-    serialize( n.endpoint_.address_, b );
+    serialize_address( n.endpoint_, b );
 }
 
 /**
@@ -274,7 +277,7 @@ deserialize
     if ( failure )
         return failure;
 
-    return deserialize( i, e, n.endpoint_.address_ );
+    return deserialize_address( i, e, n.endpoint_ );
 }
 
 } // anonymous namespace
@@ -388,6 +391,15 @@ deserialize
     return deserialize( i, e, body.data_ );
 }
 
+std::error_code
+deserialize
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , find_value_response_view & body )
+{
+    return deserialize( i, e, body.data_ );
+}
+
 void
 serialize
     ( store_value_request_body const& body
@@ -411,6 +423,141 @@ deserialize
     return deserialize( i, e, body.data_value_ );
 }
 
+std::error_code
+deserialize
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , store_value_request_view & body )
+{
+    auto failure = deserialize( i, e, body.data_key_hash_ );
+    if ( failure )
+        return failure;
+
+    return deserialize( i, e, body.data_value_ );
+}
+
+void
+serialize
+    ( cache_value_request_body const& body
+    , buffer & b )
+{
+    serialize( body.data_key_hash_, b );
+
+    serialize_integer( body.ttl_, b );
+
+    serialize( body.data_value_, b );
+}
+
+std::error_code
+deserialize
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , cache_value_request_body & body )
+{
+    auto failure = deserialize( i, e, body.data_key_hash_ );
+    if ( failure )
+        return failure;
+
+    failure = deserialize_integer( i, e, body.ttl_ );
+    if ( failure )
+        return failure;
+
+    return deserialize( i, e, body.data_value_ );
+}
+
+void
+serialize
+    ( store_values_request_body const& body
+    , buffer & b )
+{
+    serialize_integer( body.values_.size(), b );
+
+    for ( auto const& v : body.values_ )
+        serialize( v, b );
+}
+
+std::error_code
+deserialize
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , store_values_request_body & body )
+{
+    std::uint64_t size;
+    auto failure = deserialize_integer( i, e, size );
+
+    for (
+        ; size > 0 && ! failure
+        ; -- size )
+    {
+        body.values_.resize( body.values_.size() + 1 );
+        failure = deserialize( i, e, body.values_.back() );
+    }
+
+    return failure;
+}
+
+void
+serialize
+    ( find_values_request_body const& body
+    , buffer & b )
+{
+    serialize_integer( body.values_to_find_.size(), b );
+
+    for ( auto const& v : body.values_to_find_ )
+        serialize( v, b );
+}
+
+std::error_code
+deserialize
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , find_values_request_body & body )
+{
+    std::uint64_t size;
+    auto failure = deserialize_integer( i, e, size );
+
+    for (
+        ; size > 0 && ! failure
+        ; -- size )
+    {
+        body.values_to_find_.resize( body.values_to_find_.size() + 1 );
+        failure = deserialize( i, e, body.values_to_find_.back() );
+    }
+
+    return failure;
+}
+
+void
+serialize
+    ( find_values_response_body const& body
+    , buffer & b )
+{
+    serialize_integer( body.values_.size(), b );
+
+    for ( auto const& v : body.values_ )
+        serialize( v, b );
+}
+
+std::error_code
+deserialize
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , find_values_response_body & body )
+{
+    std::uint64_t size;
+    auto failure = deserialize_integer( i, e, size );
+
+    for (
+        ; size > 0 && ! failure
+        ; -- size )
+    {
+        body.values_.resize( body.values_.size() + 1 );
+        failure = deserialize( i, e, body.values_.back() );
+    }
+
+    return failure;
+}
+
 } // namespace detail
 } // namespace kademlia
 
@@ -75,6 +75,14 @@ struct header final
         FIND_VALUE_REQUEST,
         ///
         FIND_VALUE_RESPONSE,
+        ///
+        CACHE_REQUEST,
+        ///
+        STORE_VALUES_REQUEST,
+        ///
+        FIND_VALUES_REQUEST,
+        ///
+        FIND_VALUES_RESPONSE,
     } type_;
 
     ///
@@ -240,6 +248,25 @@ deserialize
     , buffer::const_iterator e
     , find_value_response_body & body );
 
+/**
+ *  @brief A find_value_response_body whose
+ *         data is left in the received buffer.
+ */
+struct find_value_response_view final
+{
+    ///
+    buffer_view data_;
+};
+
+/**
+ *
+ */
+std::error_code
+deserialize
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , find_value_response_view & body );
+
 /**
  *
  */
@@ -276,6 +303,193 @@ deserialize
     , buffer::const_iterator e
     , store_value_request_body & body );
 
+/**
+ *  @brief A store_value_request_body whose
+ *         value is left in the received buffer.
+ */
+struct store_value_request_view final
+{
+    ///
+    id data_key_hash_;
+    ///
+    buffer_view data_value_;
+};
+
+/**
+ *
+ */
+std::error_code
+deserialize
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , store_value_request_view & body );
+
+/**
+ *  @brief Store a short lived copy of a value.
+ */
+struct cache_value_request_body final
+{
+    ///
+    id data_key_hash_;
+    /// Lifetime of the copy, in seconds.
+    std::uint32_t ttl_;
+    ///
+    std::vector< std::uint8_t > data_value_;
+};
+
+/**
+ *
+ */
+template<>
+struct message_traits< cache_value_request_body >
+{ static CXX11_CONSTEXPR header::type TYPE_ID = header::CACHE_REQUEST; };
+
+
+/**
+ *
+ */
+void
+serialize
+    ( cache_value_request_body const& body
+    , buffer & b );
+
+/**
+ *
+ */
+std::error_code
+deserialize
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , cache_value_request_body & body );
+
+/**
+ *  @brief Store many values at once.
+ */
+struct store_values_request_body final
+{
+    ///
+    std::vector< store_value_request_body > values_;
+};
+
+/**
+ *
+ */
+template<>
+struct message_traits< store_values_request_body >
+{ static CXX11_CONSTEXPR header::type TYPE_ID = header::STORE_VALUES_REQUEST; };
+
+/**
+ *
+ */
+void
+serialize
+    ( store_values_request_body const& body
+    , buffer & b );
+
+/**
+ *
+ */
+std::error_code
+deserialize
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , store_values_request_body & body );
+
+/**
+ *  @brief Find many values at once.
+ */
+struct find_values_request_body final
+{
+    ///
+    std::vector< id > values_to_find_;
+};
+
+/**
+ *
+ */
+template<>
+struct message_traits< find_values_request_body >
+{ static CXX11_CONSTEXPR header::type TYPE_ID = header::FIND_VALUES_REQUEST; };
+
+/**
+ *
+ */
+void
+serialize
+    ( find_values_request_body const& body
+    , buffer & b );
+
+/**
+ *
+ */
+std::error_code
+deserialize
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , find_values_request_body & body );
+
+/**
+ *  @brief The requested values known by the peer,
+ *         the other ones being omitted.
+ */
+struct find_values_response_body final
+{
+    ///
+    std::vector< store_value_request_body > values_;
+};
+
+/**
+ *
+ */
+template<>
+struct message_traits< find_values_response_body >
+{ static CXX11_CONSTEXPR header::type TYPE_ID = header::FIND_VALUES_RESPONSE; };
+
+/**
+ *
+ */
+void
+serialize
+    ( find_values_response_body const& body
+    , buffer & b );
+
+/**
+ *
+ */
+std::error_code
+deserialize
+    ( buffer::const_iterator & i
+    , buffer::const_iterator e
+    , find_values_response_body & body );
+
+/**
+ *  @brief Return the serialized size of a header
+ *         followed by an empty batch body.
+ */
+inline std::size_t
+get_batch_message_overhead
+    ( void )
+{ return 1 + 2 * id::BLOCKS_COUNT + sizeof( std::uint64_t ); }
+
+/**
+ *  @brief Return the size added to a batch body by an id.
+ */
+inline std::size_t
+get_serialized_size
+    ( id const& )
+{ return id::BLOCKS_COUNT; }
+
+/**
+ *  @brief Return the size added to a batch body by a value.
+ */
+inline std::size_t
+get_serialized_size
+    ( store_value_request_body const& body )
+{
+    return id::BLOCKS_COUNT + sizeof( std::uint64_t )
+         + body.data_value_.size();
+}
+
 } // namespace detail
 } // namespace kademlia
 
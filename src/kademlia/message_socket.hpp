@@ -199,7 +199,7 @@ message_socket< UnderlyingSocketType >::ipv4
 
     for ( auto const& i : endpoints )
     {
-        if ( i.address_.is_v4() )
+        if ( is_ipv4( i ) )
             return message_socket{ io_service, i };
     }
 
@@ -217,7 +217,7 @@ message_socket< UnderlyingSocketType >::ipv6
 
     for ( auto const& i : endpoints )
     {
-        if ( i.address_.is_v6() )
+        if ( is_ipv6( i ) )
             return message_socket{ io_service, i };
     }
 
@@ -310,8 +310,7 @@ message_socket< UnderlyingSocketType >::local_endpoint
     ( void )
     const
 {
-    return endpoint_type{ socket_.local_endpoint().address()
-                        , socket_.local_endpoint().port() };
+    return convert_endpoint( socket_.local_endpoint() );
 }
 
 template< typename UnderlyingSocketType >
@@ -361,13 +360,13 @@ template< typename UnderlyingSocketType >
 inline typename message_socket< UnderlyingSocketType >::endpoint_type
 message_socket< UnderlyingSocketType >::convert_endpoint
     ( underlying_endpoint_type const& e )
-{ return endpoint_type{ e.address(), e.port() }; }
+{ return to_ip_endpoint( e.address(), e.port() ); }
 
 template< typename UnderlyingSocketType >
 inline typename message_socket< UnderlyingSocketType >::underlying_endpoint_type
 message_socket< UnderlyingSocketType >::convert_endpoint
     ( endpoint_type const& e )
-{ return underlying_endpoint_type{ e.address_, e.port_ }; }
+{ return underlying_endpoint_type{ to_address( e ), e.port_ }; }
 
 } // namespace detail
 } // namespace kademlia
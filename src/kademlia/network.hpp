@@ -160,7 +160,7 @@ private:
     get_socket_for
         ( endpoint_type const& e )
     {
-        if ( e.address_.is_v4() )
+        if ( is_ipv4( e ) )
             return socket_ipv4_;
 
         return socket_ipv6_;
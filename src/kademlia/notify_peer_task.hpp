@@ -79,9 +79,7 @@ private:
         ( detail::id const & key
         , tracker_type & tracker
         , RoutingTableType & routing_table )
-            : lookup_task( key
-                         , routing_table.find( key )
-                         , routing_table.end() )
+            : lookup_task( key, routing_table )
             , tracker_( tracker )
     {
         LOG_DEBUG( notify_peer_task, this )
@@ -137,7 +135,7 @@ private:
         { task->flag_candidate_as_invalid( current_peer.id_ ); };
 
         task->tracker_.send_request( request
-                                   , current_peer.endpoint_
+                                   , current_peer
                                    , PEER_LOOKUP_TIMEOUT
                                    , on_message_received
                                    , on_error );
@@ -170,7 +168,7 @@ private:
         }
 
         // If new candidate have been discovered, ask them.
-        task->add_candidates( response.peers_ );
+        task->add_candidates( response.peers_, h.source_id_ );
         try_to_notify_neighbors( task );
     }
 
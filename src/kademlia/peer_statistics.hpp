@@ -0,0 +1,122 @@
+// Copyright (c) 2013-2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef KADEMLIA_PEER_STATISTICS_HPP
+#define KADEMLIA_PEER_STATISTICS_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <cstdint>
+#include <algorithm>
+
+#include "kademlia/timer.hpp"
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  Responsiveness of a peer, as observed by our requests.
+ *  @note Round trip times are smoothed as TCP does (RFC 6298).
+ */
+struct peer_statistics final
+{
+    /// Smoothed round trip time.
+    timer::duration smoothed_rtt_;
+    /// Round trip time variation.
+    timer::duration rtt_variance_;
+    /// Count of responses received.
+    std::uint32_t responses_count_;
+    /// Count of requests that failed since the last response.
+    std::uint32_t consecutive_failures_;
+    /// Last time a message has been received from the peer.
+    timer::clock::time_point last_seen_;
+};
+
+/**
+ *  Update statistics with a new round trip time sample.
+ */
+inline void
+record_response
+    ( peer_statistics & statistics
+    , timer::duration const& rtt
+    , timer::clock::time_point const& now )
+{
+    if ( statistics.responses_count_ == 0 )
+    {
+        statistics.smoothed_rtt_ = rtt;
+        statistics.rtt_variance_ = rtt / 2;
+    }
+    else
+    {
+        auto const error = statistics.smoothed_rtt_ > rtt
+                         ? statistics.smoothed_rtt_ - rtt
+                         : rtt - statistics.smoothed_rtt_;
+
+        // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|
+        // SRTT = 7/8 SRTT + 1/8 R
+        statistics.rtt_variance_ = ( 3 * statistics.rtt_variance_ + error ) / 4;
+        statistics.smoothed_rtt_ = ( 7 * statistics.smoothed_rtt_ + rtt ) / 8;
+    }
+
+    ++ statistics.responses_count_;
+    statistics.consecutive_failures_ = 0;
+    statistics.last_seen_ = now;
+}
+
+/**
+ *  Update statistics with a request failure.
+ */
+inline void
+record_failure
+    ( peer_statistics & statistics )
+{ ++ statistics.consecutive_failures_; }
+
+/**
+ *  Return the delay after which a request sent to the peer
+ *  is deemed lost, i.e. SRTT + 4 RTTVAR doubled on each
+ *  consecutive failure (RFC 6298), and no less than minimum.
+ */
+inline timer::duration
+get_retransmission_timeout
+    ( peer_statistics const& statistics
+    , timer::duration const& minimum )
+{
+    if ( statistics.responses_count_ == 0 )
+        return minimum;
+
+    // Bound the backoff to 2^3.
+    auto const backoff = std::min< std::uint32_t >
+            ( statistics.consecutive_failures_, 3 );
+    auto const timeout = ( statistics.smoothed_rtt_
+                         + 4 * statistics.rtt_variance_ ) * ( 1 << backoff );
+
+    return std::max( minimum, timeout );
+}
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
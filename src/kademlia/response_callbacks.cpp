@@ -25,27 +25,167 @@
 
 #include "kademlia/response_callbacks.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <random>
+#include <utility>
 
 #include "kademlia/error_impl.hpp"
 
 namespace kademlia {
 namespace detail {
 
-void
+namespace {
+
+CXX11_CONSTEXPR std::size_t SLOT_INDEX_SIZE
+        = sizeof( response_callbacks::slot_index_type );
+
+static_assert( SLOT_INDEX_SIZE < id::BLOCKS_COUNT
+             , "tokens must contain random bytes after the slot index" );
+
+inline std::uint64_t
+rotate_left
+    ( std::uint64_t word
+    , int count )
+{ return ( word << count ) | ( word >> ( 64 - count ) ); }
+
+inline void
+sip_round
+    ( std::uint64_t & v0
+    , std::uint64_t & v1
+    , std::uint64_t & v2
+    , std::uint64_t & v3 )
+{
+    v0 += v1; v1 = rotate_left( v1, 13 ); v1 ^= v0; v0 = rotate_left( v0, 32 );
+    v2 += v3; v3 = rotate_left( v3, 16 ); v3 ^= v2;
+    v0 += v3; v3 = rotate_left( v3, 21 ); v3 ^= v0;
+    v2 += v1; v1 = rotate_left( v1, 17 ); v1 ^= v2; v2 = rotate_left( v2, 32 );
+}
+
+/**
+ *  SipHash-2-4 of a single 64 bits word. Unlike a
+ *  seeded generator, its outputs don't reveal the
+ *  key, hence the next tokens can't be predicted
+ *  from the previous ones.
+ */
+std::uint64_t
+sip_hash
+    ( response_callbacks::key_type const& key
+    , std::uint64_t message )
+{
+    std::uint64_t v0 = key[ 0 ] ^ 0x736f6d6570736575ULL;
+    std::uint64_t v1 = key[ 1 ] ^ 0x646f72616e646f6dULL;
+    std::uint64_t v2 = key[ 0 ] ^ 0x6c7967656e657261ULL;
+    std::uint64_t v3 = key[ 1 ] ^ 0x7465646279746573ULL;
+
+    v3 ^= message;
+    sip_round( v0, v1, v2, v3 );
+    sip_round( v0, v1, v2, v3 );
+    v0 ^= message;
+
+    // Final block, containing only the message length.
+    std::uint64_t const length = std::uint64_t( sizeof( message ) ) << 56;
+    v3 ^= length;
+    sip_round( v0, v1, v2, v3 );
+    sip_round( v0, v1, v2, v3 );
+    v0 ^= length;
+
+    v2 ^= 0xff;
+    for ( int i = 0; i != 4; ++ i )
+        sip_round( v0, v1, v2, v3 );
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+} // namespace
+
+response_callbacks::response_callbacks
+    ( void )
+    : response_callbacks( generate_key() )
+{ }
+
+response_callbacks::response_callbacks
+    ( key_type const& key )
+    : key_( key )
+    , counter_()
+    , slots_()
+    , free_slots_()
+{ }
+
+response_callbacks::key_type
+response_callbacks::generate_key
+    ( void )
+{
+    std::random_device device;
+    std::uniform_int_distribution< std::uint64_t > distribution;
+
+    return key_type{ { distribution( device ), distribution( device ) } };
+}
+
+id
+response_callbacks::generate_token
+    ( void )
+{
+    id token;
+
+    for ( auto i = token.begin(), e = token.end(); i != e; )
+    {
+        auto const word = sip_hash( key_, counter_ ++ );
+        auto const count = std::min( std::size_t( e - i ), sizeof( word ) );
+        std::memcpy( i, &word, count );
+        i += count;
+    }
+
+    return token;
+}
+
+id
 response_callbacks::push_callback
-    ( id const& message_id
-    , callback const& on_message_received )
+    ( callback const& on_message_received )
 {
-    auto i = callbacks_.emplace( message_id, on_message_received );
-    (void)i;
-    assert( i.second && "an id can't be registered twice" );
+    slot_index_type index;
+    if ( free_slots_.empty() )
+    {
+        index = slot_index_type( slots_.size() );
+        slots_.emplace_back();
+    }
+    else
+    {
+        index = free_slots_.back();
+        free_slots_.pop_back();
+    }
+
+    id token = generate_token();
+    // Write the slot index as big-endian.
+    for ( std::size_t i = 0; i != SLOT_INDEX_SIZE; ++ i )
+    {
+        auto const shift = 8 * ( SLOT_INDEX_SIZE - 1 - i );
+        token.begin()[ i ] = std::uint8_t( index >> shift );
+    }
+
+    assert( get_slot_index( token ) == index && "slot index not written" );
+
+    auto & s = slots_[ index ];
+    s.token_ = token;
+    s.callback_ = on_message_received;
+
+    return token;
 }
 
 bool
 response_callbacks::remove_callback
     ( id const& message_id )
-{ return callbacks_.erase( message_id ) > 0; }
+{
+    auto s = find_slot( message_id );
+    if ( ! s )
+        return false;
+
+    s->callback_ = nullptr;
+    free_slots_.push_back( get_slot_index( message_id ) );
+
+    return true;
+}
 
 std::error_code
 response_callbacks::dispatch_response
@@ -54,16 +194,46 @@ response_callbacks::dispatch_response
     , buffer::const_iterator i
     , buffer::const_iterator e )
 {
-    auto callback = callbacks_.find( h.random_token_ );
-    if ( callback == callbacks_.end() )
+    auto s = find_slot( h.random_token_ );
+    if ( ! s )
         return make_error_code( UNASSOCIATED_MESSAGE_ID );
 
-    callback->second( sender, h, i, e );
-    callbacks_.erase( callback );
+    // The slot is released before the call as the
+    // callback may push new callbacks.
+    auto const on_message_received = std::move( s->callback_ );
+    s->callback_ = nullptr;
+    free_slots_.push_back( get_slot_index( h.random_token_ ) );
+
+    on_message_received( sender, h, i, e );
 
     return std::error_code{};
 }
 
+response_callbacks::slot_index_type
+response_callbacks::get_slot_index
+    ( id const& message_id )
+{
+    slot_index_type index = 0;
+    for ( std::size_t i = 0; i != SLOT_INDEX_SIZE; ++ i )
+        index = index << 8 | message_id.begin()[ i ];
+
+    return index;
+}
+
+response_callbacks::slot *
+response_callbacks::find_slot
+    ( id const& message_id )
+{
+    auto const index = get_slot_index( message_id );
+    if ( index >= slots_.size() )
+        return nullptr;
+
+    auto & s = slots_[ index ];
+    if ( ! s.callback_ || s.token_ != message_id )
+        return nullptr;
+
+    return &s;
+}
+
 } // namespace detail
 } // namespace kademlia
-
@@ -30,8 +30,10 @@
 #   pragma once
 #endif
 
-#include <map>
+#include <array>
+#include <cstdint>
 #include <functional>
+#include <vector>
 
 #include "kademlia/id.hpp"
 #include "kademlia/ip_endpoint.hpp"
@@ -40,7 +42,14 @@
 namespace kademlia {
 namespace detail {
 
-///
+/**
+ *  Callbacks are stored into slots, the index of the slot
+ *  being written in the first bytes of the response token.
+ *  Hence a response is matched by an array lookup followed
+ *  by a comparison with the remaining random bytes.
+ *  These bytes are a keyed hash of a counter, so that
+ *  a peer can't guess the tokens of pending requests.
+ */
 class response_callbacks final
 {
 public:
@@ -54,14 +63,41 @@ public:
             , buffer::const_iterator i
             , buffer::const_iterator e ) >;
 
+    ///
+    using slot_index_type = std::uint32_t;
+
+    /// The secret key of the tokens hash.
+    using key_type = std::array< std::uint64_t, 2 >;
+
 public:
+    /**
+     *  @brief Use a key drawn from std::random_device.
+     */
+    response_callbacks
+        ( void );
+
     /**
      *
      */
-    void
+    explicit
+    response_callbacks
+        ( key_type const& key );
+
+    /**
+     *  @brief Generate a random token, not associated
+     *         to any callback.
+     */
+    id
+    generate_token
+        ( void );
+
+    /**
+     *  @brief Store a callback until a response carrying
+     *         the returned token is dispatched.
+     */
+    id
     push_callback
-        ( id const& message_id
-        , callback const& on_message_received );
+        ( callback const& on_message_received );
 
     /**
      *
@@ -80,17 +116,53 @@ public:
         , buffer::const_iterator i
         , buffer::const_iterator e );
 
+    /**
+     *  @brief Return the slot a token has been associated with.
+     */
+    static slot_index_type
+    get_slot_index
+        ( id const& message_id );
+
 private:
     ///
-    using callbacks = std::map< id, callback >;
+    struct slot
+    {
+        ///
+        id token_;
+        ///
+        callback callback_;
+    };
+
+    ///
+    using slots = std::vector< slot >;
+
+private:
+    /**
+     *
+     */
+    static key_type
+    generate_key
+        ( void );
+
+    /**
+     *
+     */
+    slot *
+    find_slot
+        ( id const& message_id );
 
 private:
     ///
-    callbacks callbacks_;
+    key_type key_;
+    ///
+    std::uint64_t counter_;
+    ///
+    slots slots_;
+    ///
+    std::vector< slot_index_type > free_slots_;
 };
 
 } // namespace detail
 } // namespace kademlia
 
 #endif
-
@@ -26,6 +26,7 @@
 #ifndef KADEMLIA_RESPONSE_ROUTER_HPP
 #define KADEMLIA_RESPONSE_ROUTER_HPP
 
+#include "kademlia/error_impl.hpp"
 #include "kademlia/ip_endpoint.hpp"
 #include "kademlia/response_callbacks.hpp"
 #include "kademlia/timer.hpp"
@@ -93,16 +94,32 @@ public:
     }
 
     /**
-     *
+     *  @brief Generate a token for a message
+     *         whose response is not expected.
+     */
+    id
+    generate_token
+        ( void )
+    { return response_callbacks_.generate_token(); }
+
+    /**
+     *  @brief Register callbacks for the response carrying
+     *         the returned token.
+     *  @note on_error is called if no response has been
+     *        received within callback_ttl.
      */
     template< typename OnResponseReceived, typename OnError >
-    void
+    id
     register_temporary_callback
-        ( id const& response_id
-        , timer::duration const& callback_ttl
+        ( timer::duration const& callback_ttl
         , OnResponseReceived const& on_response_received
         , OnError const& on_error )
     {
+        // Associate the response id with the
+        // on_response_received callback.
+        auto const response_id = response_callbacks_.push_callback
+                ( on_response_received );
+
         auto on_timeout = [ this, on_error, response_id ]
             ( void )
         {
@@ -113,14 +130,20 @@ public:
                 on_error( make_error_code( std::errc::timed_out ) );
         };
 
-        // Associate the response id with the
-        // on_response_received callback.
-        response_callbacks_.push_callback( response_id
-                                         , on_response_received );
-
         timer_.expires_from_now( callback_ttl, on_timeout );
+
+        return response_id;
     }
 
+    /**
+     *  @brief Forget the callbacks associated with response_id.
+     *  @return false if they have already been called.
+     */
+    bool
+    unregister_callback
+        ( id const& response_id )
+    { return response_callbacks_.remove_callback( response_id ); }
+
 private:
     ///
     response_callbacks response_callbacks_;
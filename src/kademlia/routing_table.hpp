@@ -34,7 +34,7 @@
 #include <cassert>
 #include <cstdint>
 #include <iostream>
-#include <list>
+#include <iterator>
 #include <utility>
 #include <vector>
 #include <boost/iterator/iterator_facade.hpp>
@@ -42,11 +42,60 @@
 #include <kademlia/detail/cxx11_macros.hpp>
 
 #include "kademlia/id.hpp"
+#include "kademlia/k_bucket.hpp"
 #include "kademlia/log.hpp"
+#include "kademlia/peer_statistics.hpp"
+#include "kademlia/timer.hpp"
 
 namespace kademlia {
 namespace detail {
 
+/**
+ *  Append peers of k_buckets [first, last) to closest_peers,
+ *  sorted by their distance to id_to_find.
+ *  @return true if closest_peers contains count peers.
+ */
+template< typename KBuckets, typename ValueType >
+bool
+append_closest_peers
+    ( KBuckets const& k_buckets
+    , id const& id_to_find
+    , std::size_t count
+    , std::size_t first
+    , std::size_t last
+    , std::vector< ValueType > & closest_peers )
+{
+    auto const previous_size = closest_peers.size();
+
+    for ( ; first != last; ++ first )
+    {
+        auto const& bucket = k_buckets[ first ];
+        for ( std::size_t i = 0, e = bucket.size(); i != e; ++ i )
+            closest_peers.emplace_back( bucket.get_id( i )
+                                      , bucket.get_peer( i ) );
+    }
+
+    auto const is_closer_peer = [ &id_to_find ]
+        ( ValueType const& a, ValueType const& b )
+        { return is_closer( a.first, b.first, id_to_find ); };
+
+    auto const begin = std::next( closest_peers.begin(), previous_size );
+
+    // If there are more candidates than needed, select
+    // the required ones, drop the others and sort the remaining.
+    bool const is_complete = closest_peers.size() >= count;
+    if ( is_complete )
+    {
+        auto const middle = std::next( closest_peers.begin(), count );
+        std::nth_element( begin, middle, closest_peers.end(), is_closer_peer );
+        closest_peers.erase( middle, closest_peers.end() );
+    }
+
+    std::sort( begin, closest_peers.end(), is_closer_peer );
+
+    return is_complete;
+}
+
 /**
  *  This class keeps track of peers and find the known peer closed to an id.
  *  @note Current implementation use a discret symbol approach.
@@ -73,11 +122,17 @@ public:
     routing_table
         ( id const& my_id
         , std::size_t k_bucket_size = DEFAULT_K_BUCKET_SIZE )
-        : k_buckets_( id::BIT_SIZE ), my_id_( my_id )
+        : k_buckets_(), my_id_( my_id )
         , peer_count_( 0 ), k_bucket_size_( k_bucket_size )
+        , lowest_k_bucket_index_( id::BIT_SIZE - 1 )
+        , lower_k_buckets_peer_count_( 0 )
     {
         assert( k_bucket_size_ > 0 && "k_bucket size must be > 0" );
 
+        k_buckets_.reserve( id::BIT_SIZE );
+        for ( std::size_t i = 0; i != id::BIT_SIZE; ++ i )
+            k_buckets_.emplace_back( get_k_bucket_size( i ) );
+
         LOG_DEBUG( routing_table, this ) << "created with id '"
                 << my_id_ << "'." << std::endl;
     }
@@ -107,48 +162,74 @@ public:
         const
     { return peer_count_; }
 
+    /**
+     *  Return the index of the lowest k_bucket used by find(),
+     *  i.e. the first k_bucket whose lower k_buckets contain
+     *  more than k peers.
+     *  @note Complexity: O(1).
+     */
+    std::size_t
+    lowest_k_bucket_index
+        ( void )
+        const
+    { return lowest_k_bucket_index_; }
+
     /**
      *  Register a peer into the routing table.
      *  @return true if the peer has been inserted.
      *  @note This method takes ownership of the peer.
-     *  @note The peer may not be pushed if the target bucket is full.
-     *  @note Complexity: O(log n)
+     *  @note An already known peer is flagged as the most recently seen.
+     *  @note If the target bucket is full, the peer is saved
+     *        into the bucket replacement cache.
+     *  @note Complexity: O(k)
      */
     bool
     push
         ( id const& peer_id
         , peer_type const& new_peer )
-    {
-        LOG_DEBUG( routing_table, this ) << "pushing peer '"
-                << new_peer << "' as '"
-                << peer_id << "'." << std::endl;
-
-        auto k_bucket_index = find_k_bucket_index( peer_id );
-        auto & bucket = k_buckets_[ k_bucket_index ];
-
-        // If there is room in the bucket.
-        if ( bucket.size() == get_k_bucket_size( k_bucket_index ) )
-            return false;
+    { return push_peer( peer_id, new_peer ) == PEER_INSERTED; }
 
-        auto const end = bucket.end();
-
-        // Check if the peer is not already known.
-        auto is_peer_known = [ &peer_id ] ( value_type const& entry )
-        { return entry.first == peer_id; };
+    /**
+     *  Register a peer into the routing table.
+     *  @param on_k_bucket_full Called with the least recently seen
+     *         peer of the target bucket when the new peer is saved
+     *         into the replacement cache. The caller is expected
+     *         to check this peer then either push() it again if
+     *         it is alive or remove() it. Only one check per bucket
+     *         is requested at a time.
+     *  @return true if the peer has been inserted.
+     *  @note Complexity: O(k)
+     */
+    template< typename OnKBucketFull >
+    bool
+    push
+        ( id const& peer_id
+        , peer_type const& new_peer
+        , OnKBucketFull const& on_k_bucket_full )
+    {
+        auto const result = push_peer( peer_id, new_peer );
+        if ( result != PEER_CACHED )
+            return result == PEER_INSERTED;
 
-        if ( std::find_if( bucket.begin(), end, is_peer_known ) != end )
-            return false;
+        auto & bucket = k_buckets_[ find_k_bucket_index( peer_id ) ];
+        if ( ! bucket.has_pending_check() )
+        {
+            bucket.set_pending_check( true );
 
-        bucket.insert( end, value_type{ peer_id, new_peer } );
-        ++ peer_count_;
+            auto const i = bucket.least_recently_seen();
+            on_k_bucket_full( value_type{ bucket.get_id( i )
+                                        , bucket.get_peer( i ) } );
+        }
 
-        return true;
+        return false;
     }
 
     /**
      *  Remove a peer from the routing table.
      *  @return true if the peer has been removed.
-     *  @note Complexity: O(log n)
+     *  @note The most recently seen peer of the bucket
+     *        replacement cache takes its place.
+     *  @note Complexity: O(k)
      */
     bool
     remove
@@ -158,25 +239,98 @@ public:
                 << peer_id << "'." << std::endl;
 
         // Find the closer bucket.
-        auto & bucket = k_buckets_[ find_k_bucket_index( peer_id ) ];
+        auto const index = find_k_bucket_index( peer_id );
+        auto & bucket = k_buckets_[ index ];
 
         // Check if the peer is inside.
-        auto is_peer_known = [&peer_id] ( value_type const& entry )
-        { return entry.first == peer_id; };
+        auto const i = bucket.find( peer_id );
 
-        auto i = std::find_if( bucket.begin(), bucket.end(), is_peer_known );
-
-        // If the peer wasn't inside.
-        if ( i == bucket.end() )
+        // If the peer wasn't inside, it may be a replacement.
+        if ( i == bucket.size() )
+        {
+            bucket.remove_replacement( peer_id );
             return false;
+        }
 
         // Remove it.
         bucket.erase( i );
+        bucket.set_pending_check( false );
+
+        // Replace it if possible.
+        if ( bucket.replacement_count() > 0 )
+        {
+            bucket.promote_replacement();
+            return true;
+        }
+
         -- peer_count_;
 
+        if ( index < lowest_k_bucket_index_ )
+        {
+            -- lower_k_buckets_peer_count_;
+            update_lowest_k_bucket_index();
+        }
+
+        return true;
+    }
+
+    /**
+     *  Record a response of a peer to one of our requests.
+     *  @param rtt The delay between the request and the response.
+     *  @return true if the peer is known.
+     *  @note Complexity: O(k)
+     */
+    bool
+    record_response
+        ( id const& peer_id
+        , timer::duration const& rtt )
+    {
+        auto const statistics = find_statistics( peer_id );
+        if ( ! statistics )
+            return false;
+
+        detail::record_response( *statistics, rtt, timer::clock::now() );
+
+        return true;
+    }
+
+    /**
+     *  Record a failure of a request sent to a peer.
+     *  @return true if the peer is known.
+     *  @note Complexity: O(k)
+     */
+    bool
+    record_failure
+        ( id const& peer_id )
+    {
+        auto const statistics = find_statistics( peer_id );
+        if ( ! statistics )
+            return false;
+
+        detail::record_failure( *statistics );
+
         return true;
     }
 
+    /**
+     *  @return The statistics of a peer or nullptr if the peer is unknown.
+     *  @note The returned pointer is invalidated by push() and remove().
+     *  @note Complexity: O(k)
+     */
+    peer_statistics const*
+    get_statistics
+        ( id const& peer_id )
+        const
+    {
+        auto const& bucket = k_buckets_[ find_k_bucket_index( peer_id ) ];
+
+        auto const i = bucket.find( peer_id );
+        if ( i == bucket.size() )
+            return nullptr;
+
+        return &bucket.get_statistics( i );
+    }
+
     /**
      *  Find closest peers to an id.
      *  @return An iterator to the closest peer from the id to the far.
@@ -189,7 +343,7 @@ public:
         LOG_DEBUG( routing_table, this ) << "finding peer near '"
                 << id_to_find << "'." << std::endl;
 
-        auto index = std::max( get_lowest_k_bucket_index()
+        auto index = std::max( lowest_k_bucket_index_
                              , find_k_bucket_index( id_to_find ) );
 
         auto i = std::next( k_buckets_.begin(), index );
@@ -198,7 +352,63 @@ public:
         while ( i->empty() && i != k_buckets_.begin() )
             -- i;
 
-        return iterator( &k_buckets_, i, i->begin() );
+        return iterator( &k_buckets_, i, 0 );
+    }
+
+    /**
+     *  Find the peers closest to an id.
+     *  @param id_to_find The id to search peers around.
+     *  @param count The maximum count of peers to return.
+     *  @param closest_peers Receives up to count peers sorted
+     *         by their xor distance to id_to_find. Its storage
+     *         is reused from call to call.
+     *  @note Complexity: O(k log k), only the k_buckets
+     *        that can contain the closest peers are visited.
+     */
+    void
+    find_closest
+        ( id const& id_to_find
+        , std::size_t count
+        , std::vector< value_type > & closest_peers )
+        const
+    {
+        LOG_DEBUG( routing_table, this ) << "finding " << count
+                << " peers closest to '" << id_to_find << "'." << std::endl;
+
+        closest_peers.clear();
+        if ( count == 0 )
+            return;
+
+        // Peers of the k_bucket sharing the searched id prefix
+        // are the closest, then come peers of deeper k_buckets
+        // (which all share the same distance high bit) and
+        // finally peers of each lower k_bucket, from the
+        // deepest to the first.
+        auto const index = find_k_bucket_index( id_to_find );
+
+        if ( append_closest_peers( k_buckets_, id_to_find, count
+                                 , index, index + 1, closest_peers ) )
+            return;
+
+        if ( append_closest_peers( k_buckets_, id_to_find, count
+                                 , index + 1, id::BIT_SIZE, closest_peers ) )
+            return;
+
+        for ( auto i = index; i > 0; -- i )
+            if ( append_closest_peers( k_buckets_, id_to_find, count
+                                     , i - 1, i, closest_peers ) )
+                return;
+    }
+
+    /**
+     *  @return An iterator to the first peer of the routing table.
+     */
+    iterator
+    begin
+        ( void )
+    {
+        // Every k_bucket comes before the one of my_id_.
+        return find( my_id_ );
     }
 
     /**
@@ -212,7 +422,7 @@ public:
               && "routing_table must always contains k_buckets" );
         auto const first_k_bucket = k_buckets_.begin();
 
-        return iterator( &k_buckets_, first_k_bucket, first_k_bucket->end() );
+        return iterator( &k_buckets_, first_k_bucket, first_k_bucket->size() );
     }
 
     /**
@@ -245,11 +455,19 @@ public:
     }
 
 private:
+    ///
+    enum push_result
+    {
+        PEER_INSERTED,
+        PEER_REFRESHED,
+        PEER_CACHED,
+    };
+
     /// Contains peer with a common base id.
-    using k_bucket = std::list< value_type >;
+    using k_bucket_type = k_bucket< peer_type >;
     /// Contains all the k_bucket.
     /// @note Algorithms expect a vector here, do not change this.
-    using k_buckets = std::vector< k_bucket >;
+    using k_buckets = std::vector< k_bucket_type >;
 
 private:
     /**
@@ -264,10 +482,10 @@ private:
         // i.e. the index of the first different bit
         // in the id of the new peer vs our id is equal to the
         // index of the closest bucket in the buckets container.
-        std::size_t bit_index = 0;
-        while ( bit_index < id::BIT_SIZE - 1
-              && id_to_find[ bit_index ] == my_id_[ bit_index ] )
-            ++ bit_index;
+        // Our own id goes into the last bucket.
+        std::size_t const bit_index
+                = std::min( common_prefix_length( id_to_find, my_id_ )
+                          , id::BIT_SIZE - 1 );
 
         LOG_DEBUG( routing_table, this ) << "found bucket at index '"
                 << bit_index << "'." << std::endl;
@@ -278,22 +496,94 @@ private:
     /**
      *
      */
-    std::size_t
-    get_lowest_k_bucket_index
+    push_result
+    push_peer
+        ( id const& peer_id
+        , peer_type const& new_peer )
+    {
+        LOG_DEBUG( routing_table, this ) << "pushing peer '"
+                << new_peer << "' as '"
+                << peer_id << "'." << std::endl;
+
+        auto const index = find_k_bucket_index( peer_id );
+        auto & bucket = k_buckets_[ index ];
+
+        // If the peer is already known, flag it as the most
+        // recently seen. If it was the least recently seen one,
+        // any pending check is over.
+        auto const now = timer::clock::now();
+        auto const i = bucket.find( peer_id );
+        if ( i != bucket.size() )
+        {
+            if ( bucket.has_pending_check()
+               && i == bucket.least_recently_seen() )
+                bucket.set_pending_check( false );
+
+            bucket.touch( i, now );
+            return PEER_REFRESHED;
+        }
+
+        // If there is no room in the bucket,
+        // keep the peer as a replacement.
+        if ( bucket.full() )
+        {
+            bucket.push_replacement( peer_id, new_peer, now );
+            return PEER_CACHED;
+        }
+
+        bucket.push_back( peer_id, new_peer, now );
+        ++ peer_count_;
+
+        if ( index < lowest_k_bucket_index_ )
+        {
+            ++ lower_k_buckets_peer_count_;
+            update_lowest_k_bucket_index();
+        }
+
+        return PEER_INSERTED;
+    }
+
+    /**
+     *
+     */
+    peer_statistics *
+    find_statistics
+        ( id const& peer_id )
+    {
+        auto & bucket = k_buckets_[ find_k_bucket_index( peer_id ) ];
+
+        auto const i = bucket.find( peer_id );
+        if ( i == bucket.size() )
+            return nullptr;
+
+        return &bucket.get_statistics( i );
+    }
+
+    /**
+     *  Move the lowest k_bucket index after lower_k_buckets_peer_count_
+     *  has been updated by push() or remove().
+     *  @note Only the k_buckets between the previous and the new
+     *        index are visited.
+     */
+    void
+    update_lowest_k_bucket_index
         ( void )
-        const
     {
-        std::size_t i = 0ULL, e = k_buckets_.size() - 1;
+        auto & i = lowest_k_bucket_index_;
+        auto & peer_count = lower_k_buckets_peer_count_;
 
-        for ( std::size_t peer_count = 0ULL
-            ; i != e && peer_count <= k_bucket_size_
-            ; ++ i )
-            peer_count += k_buckets_[ i ].size();
+        // A peer has been removed below the index, move it up
+        // until lower k_buckets contain enough peers.
+        while ( i != id::BIT_SIZE - 1 && peer_count <= k_bucket_size_ )
+            peer_count += k_buckets_[ i ++ ].size();
+
+        // A peer has been added below the index, move it down
+        // while lower k_buckets still contain enough peers.
+        while ( i != 0 && peer_count - k_buckets_[ i - 1 ].size() > k_bucket_size_ )
+            peer_count -= k_buckets_[ -- i ].size();
 
         LOG_DEBUG( routing_table, this ) << "bottom bucket is at index '"
                 << i << "'." << std::endl;
-
-        return i;
     }
 
     /**
@@ -303,7 +593,7 @@ private:
     get_k_bucket_size
         ( std::size_t index )
         const
-    { return k_bucket_size_  + ( k_buckets_.size() - index ) / 4; }
+    { return k_bucket_size_  + ( id::BIT_SIZE - index ) / 4; }
 
 private:
     /// This contains buckets up to id bit count.
@@ -314,6 +604,10 @@ private:
     std::size_t peer_count_;
     /// This is max number of peers stored per k_bucket.
     std::size_t k_bucket_size_;
+    /// Index of the lowest k_bucket returned by find().
+    std::size_t lowest_k_bucket_index_;
+    /// Count of peers stored below lowest_k_bucket_index_.
+    std::size_t lower_k_buckets_peer_count_;
 };
 
 /**
@@ -324,7 +618,8 @@ class routing_table< PeerType >::iterator
     : public boost::iterator_facade
         < iterator
         , typename routing_table::value_type
-        , boost::single_pass_traversal_tag >
+        , boost::single_pass_traversal_tag
+        , std::pair< id const&, PeerType const& > >
 {
 public:
     /**
@@ -333,7 +628,7 @@ public:
     iterator
         ( k_buckets * buckets
         , typename k_buckets::iterator current_bucket
-        , typename k_bucket::iterator current_peer )
+        , std::size_t current_peer )
         : k_buckets_( buckets )
         , current_k_bucket_( current_bucket )
         , current_entry_( current_peer )
@@ -367,7 +662,7 @@ private:
 
         // If the current entry is not at the end of the bucket
         // then there is nothing more to do.
-        if ( current_entry_ != current_k_bucket_->end() )
+        if ( current_entry_ != current_k_bucket_->size() )
             return;
 
         // If the current bucket is already the first (far)
@@ -379,7 +674,7 @@ private:
         do
             -- current_k_bucket_;
         while ( current_k_bucket_->empty() && current_k_bucket_ != k_buckets_->begin() );
-        current_entry_ = current_k_bucket_->begin();
+        current_entry_ = 0;
     }
 
     /**
@@ -398,11 +693,14 @@ private:
     /**
      *
      */
-    typename routing_table::value_type &
+    std::pair< id const&, PeerType const& >
     dereference
         ( void )
         const
-    { return *current_entry_; }
+    {
+        return { current_k_bucket_->get_id( current_entry_ )
+               , current_k_bucket_->get_peer( current_entry_ ) };
+    }
 
 private:
     ///
@@ -410,7 +708,7 @@ private:
     ///
     typename k_buckets::iterator current_k_bucket_;
     ///
-    typename k_bucket::iterator current_entry_;
+    std::size_t current_entry_;
 
 };
 
@@ -0,0 +1,146 @@
+// Copyright (c) 2013-2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "kademlia/routing_table_snapshot.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "kademlia/error_impl.hpp"
+#include "kademlia/message.hpp"
+
+namespace kademlia {
+namespace detail {
+
+namespace {
+
+/// Leading bytes of a snapshot file.
+CXX11_CONSTEXPR std::uint8_t MAGIC[] = { 'K', 'D', 'R', 'T' };
+
+///
+CXX11_CONSTEXPR std::uint8_t VERSION = 2;
+
+} // anonymous namespace
+
+void
+serialize_routing_table_snapshot
+    ( routing_table_snapshot const& snapshot
+    , buffer & b )
+{
+    b.insert( b.end(), std::begin( MAGIC ), std::end( MAGIC ) );
+    b.push_back( VERSION );
+
+    // The id and peer list layouts are the ones
+    // used by FIND_PEER_REQUEST and FIND_PEER_RESPONSE.
+    find_peer_request_body const identity{ snapshot.my_id_ };
+    serialize( identity, b );
+
+    find_peer_response_body const body{ snapshot.peers_ };
+    serialize( body, b );
+}
+
+std::error_code
+deserialize_routing_table_snapshot
+    ( buffer::const_iterator i
+    , buffer::const_iterator e
+    , routing_table_snapshot & snapshot )
+{
+    auto const header_size = sizeof( MAGIC ) + sizeof( VERSION );
+    if ( std::size_t( std::distance( i, e ) ) < header_size
+       || ! std::equal( std::begin( MAGIC ), std::end( MAGIC ), i ) )
+        return make_error_code( INVALID_ROUTING_TABLE_SNAPSHOT );
+
+    std::advance( i, sizeof( MAGIC ) );
+    if ( *i++ != VERSION )
+        return make_error_code( UNKNOWN_PROTOCOL_VERSION );
+
+    find_peer_request_body identity;
+    find_peer_response_body body;
+    if ( deserialize( i, e, identity )
+       || deserialize( i, e, body )
+       || i != e )
+        return make_error_code( INVALID_ROUTING_TABLE_SNAPSHOT );
+
+    snapshot.my_id_ = identity.peer_to_find_id_;
+    snapshot.peers_ = std::move( body.peers_ );
+
+    return std::error_code{};
+}
+
+std::error_code
+save_routing_table_snapshot
+    ( std::string const& path
+    , routing_table_snapshot const& snapshot )
+{
+    buffer b;
+    serialize_routing_table_snapshot( snapshot, b );
+
+    // The previous snapshot is replaced once the new
+    // one has been fully written, hence an interrupted
+    // save doesn't leave a truncated file.
+    auto const temporary_path = path + ".tmp";
+
+    std::ofstream out{ temporary_path, std::ios::binary | std::ios::trunc };
+    out.write( reinterpret_cast< char const* >( b.data() ), b.size() );
+    out.close();
+
+    // Unlike std::rename(), it replaces an existing file on Windows too.
+    boost::system::error_code rename_failure;
+    if ( out )
+        boost::filesystem::rename( temporary_path, path, rename_failure );
+
+    if ( ! out || rename_failure )
+    {
+        std::remove( temporary_path.c_str() );
+        return make_error_code( std::errc::io_error );
+    }
+
+    return std::error_code{};
+}
+
+std::error_code
+load_routing_table_snapshot
+    ( std::string const& path
+    , routing_table_snapshot & snapshot )
+{
+    std::ifstream in{ path, std::ios::binary };
+    if ( ! in )
+        return make_error_code( std::errc::no_such_file_or_directory );
+
+    buffer const b{ std::istreambuf_iterator< char >{ in }
+                  , std::istreambuf_iterator< char >{} };
+    if ( in.bad() )
+        return make_error_code( std::errc::io_error );
+
+    return deserialize_routing_table_snapshot( b.begin(), b.end(), snapshot );
+}
+
+} // namespace detail
+} // namespace kademlia
+
@@ -0,0 +1,97 @@
+// Copyright (c) 2013-2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_ROUTING_TABLE_SNAPSHOT_HPP
+#define KADEMLIA_ROUTING_TABLE_SNAPSHOT_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <string>
+#include <vector>
+#include <system_error>
+
+#include "kademlia/buffer.hpp"
+#include "kademlia/id.hpp"
+#include "kademlia/peer.hpp"
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  Identity and peers of a routing table, which are
+ *  enough for a peer to restart where it stopped.
+ */
+struct routing_table_snapshot final
+{
+    ///
+    id my_id_;
+    ///
+    std::vector< peer > peers_;
+};
+
+/**
+ *  Serialize a routing table snapshot, i.e. a magic number,
+ *  a format version, the id of the peer and its peers list.
+ */
+void
+serialize_routing_table_snapshot
+    ( routing_table_snapshot const& snapshot
+    , buffer & b );
+
+/**
+ *
+ */
+std::error_code
+deserialize_routing_table_snapshot
+    ( buffer::const_iterator i
+    , buffer::const_iterator e
+    , routing_table_snapshot & snapshot );
+
+/**
+ *  Write snapshot into the file located at path,
+ *  replacing any previous content.
+ *  @note The file is written beside path then
+ *        renamed, hence it's never left truncated.
+ */
+std::error_code
+save_routing_table_snapshot
+    ( std::string const& path
+    , routing_table_snapshot const& snapshot );
+
+/**
+ *
+ */
+std::error_code
+load_routing_table_snapshot
+    ( std::string const& path
+    , routing_table_snapshot & snapshot );
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
+
@@ -27,8 +27,79 @@
 
 #include "kademlia/session_impl.hpp"
 
+#include <memory>
+
 namespace kademlia {
 
+namespace {
+
+/**
+ *  Call handler once each of the keys_count
+ *  keys has been saved, with the first failure.
+ */
+session::save_many_handler_type
+make_batch_save_handler
+    ( std::size_t keys_count
+    , session::save_handler_type handler )
+{
+    struct state
+    {
+        std::size_t pending_count_;
+        std::error_code failure_;
+        session::save_handler_type handler_;
+    };
+
+    auto s = std::make_shared< state >
+            ( state{ keys_count, std::error_code{}, std::move( handler ) } );
+
+    return [ s ] ( std::size_t, std::error_code const& failure )
+    {
+        if ( failure && ! s->failure_ )
+            s->failure_ = failure;
+
+        if ( -- s->pending_count_ == 0 )
+            s->handler_( s->failure_ );
+    };
+}
+
+/**
+ *  Call handler once each of the keys_count
+ *  keys has been loaded, with the first failure.
+ */
+session::load_many_handler_type
+make_batch_load_handler
+    ( std::size_t keys_count
+    , session::batch_load_handler_type handler )
+{
+    struct state
+    {
+        std::size_t pending_count_;
+        std::error_code failure_;
+        std::vector< session::data_type > datas_;
+        session::batch_load_handler_type handler_;
+    };
+
+    auto s = std::make_shared< state >
+            ( state{ keys_count, std::error_code{}
+                   , std::vector< session::data_type >( keys_count )
+                   , std::move( handler ) } );
+
+    return [ s ] ( std::size_t key_index
+                 , std::error_code const& failure
+                 , session::data_type const& data )
+    {
+        if ( failure && ! s->failure_ )
+            s->failure_ = failure;
+
+        s->datas_[ key_index ] = data;
+
+        if ( -- s->pending_count_ == 0 )
+            s->handler_( s->failure_, s->datas_ );
+    };
+}
+
+} // anonymous namespace
+
 /**
  *
  */
@@ -46,6 +117,20 @@ struct session::impl final
                           , listen_on_ipv4
                           , listen_on_ipv6 }
     { }
+
+    /**
+     *
+     */
+    impl
+        ( endpoint const& initial_peer
+        , std::string const& routing_table_path
+        , endpoint const& listen_on_ipv4
+        , endpoint const& listen_on_ipv6 )
+            : session_impl{ initial_peer
+                          , routing_table_path
+                          , listen_on_ipv4
+                          , listen_on_ipv6 }
+    { }
 };
 
 session::session
@@ -55,6 +140,15 @@ session::session
         : impl_{ new impl{ initial_peer, listen_on_ipv4, listen_on_ipv6 } }
 { }
 
+session::session
+    ( endpoint const& initial_peer
+    , std::string const& routing_table_path
+    , endpoint const& listen_on_ipv4
+    , endpoint const& listen_on_ipv6 )
+        : impl_{ new impl{ initial_peer, routing_table_path
+                         , listen_on_ipv4, listen_on_ipv6 } }
+{ }
+
 session::~session
     ( void )
 { }
@@ -72,6 +166,76 @@ session::async_load
     , load_handler_type handler )
 { impl_->async_load( key, std::move( handler ) ); }
 
+void
+session::async_load
+    ( key_type const& key
+    , load_handler_type handler
+    , load_policy policy )
+{ impl_->async_load( key, std::move( handler ), policy ); }
+
+void
+session::async_save_many
+    ( std::vector< key_type > const& keys
+    , std::vector< data_type > const& datas
+    , save_many_handler_type handler )
+{ impl_->async_save_many( keys, datas, std::move( handler ) ); }
+
+void
+session::async_save_many
+    ( std::vector< key_type > const& keys
+    , std::vector< data_type > const& datas
+    , save_handler_type handler )
+{
+    // The handler is never called from this call.
+    if ( keys.empty() && datas.empty() )
+    {
+        auto on_empty_batch = [ handler ]( void )
+        { handler( std::error_code{} ); };
+        impl_->post( on_empty_batch );
+    }
+    else
+        impl_->async_save_many( keys, datas
+                              , make_batch_save_handler( keys.size()
+                                                       , std::move( handler ) ) );
+}
+
+void
+session::async_load_many
+    ( std::vector< key_type > const& keys
+    , load_many_handler_type handler
+    , load_policy policy )
+{ impl_->async_load_many( keys, std::move( handler ), policy ); }
+
+void
+session::async_load_many
+    ( std::vector< key_type > const& keys
+    , batch_load_handler_type handler
+    , load_policy policy )
+{
+    // The handler is never called from this call.
+    if ( keys.empty() )
+    {
+        auto on_empty_batch = [ handler ]( void )
+        { handler( std::error_code{}, std::vector< data_type >{} ); };
+        impl_->post( on_empty_batch );
+    }
+    else
+        impl_->async_load_many( keys
+                              , make_batch_load_handler( keys.size()
+                                                       , std::move( handler ) )
+                              , policy );
+}
+
+std::error_code
+session::save_routing_table
+    ( std::string const& path )
+{ return impl_->save_routing_table( path ); }
+
+std::error_code
+session::load_routing_table
+    ( std::string const& path )
+{ return impl_->load_routing_table( path ); }
+
 std::error_code
 session::run
     ( void )
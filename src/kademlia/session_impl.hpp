@@ -33,12 +33,15 @@
 
 #include <kademlia/session_impl.hpp>
 
+#include <random>
+#include <string>
 #include <utility>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/ip/udp.hpp>
 
 #include "kademlia/message_socket.hpp"
 #include "kademlia/engine.hpp"
+#include "kademlia/routing_table_snapshot.hpp"
 #include "kademlia/concurrent_guard.hpp"
 
 namespace kademlia {
@@ -94,6 +97,24 @@ public:
             , concurrent_guard_{}
     { }
 
+    /**
+     *
+     */
+    session_impl
+        ( endpoint const& initial_peer
+        , std::string const& routing_table_path
+        , endpoint const& listen_on_ipv4
+        , endpoint const& listen_on_ipv6 )
+            : io_service_{}
+            , engine_{ io_service_
+                     , initial_peer
+                     , listen_on_ipv4
+                     , listen_on_ipv6
+                     , read_routing_table_snapshot( routing_table_path ) }
+            , is_abort_requested_{}
+            , concurrent_guard_{}
+    { }
+
     /**
      *
      */
@@ -116,12 +137,69 @@ public:
     void
     async_load
         ( key_type const& key
-        , HandlerType && handler )
+        , HandlerType && handler
+        , session_base::load_policy policy = session_base::LOAD_LOCAL_FIRST )
     {
         engine_.async_load( key
-                          , std::forward< HandlerType >( handler ) );
+                          , std::forward< HandlerType >( handler )
+                          , policy );
+    }
+
+    /**
+     *
+     */
+    template< typename HandlerType >
+    void
+    async_save_many
+        ( std::vector< key_type > const& keys
+        , std::vector< data_type > const& datas
+        , HandlerType && handler )
+    {
+        engine_.async_save_many( keys
+                               , datas
+                               , std::forward< HandlerType >( handler ) );
+    }
+
+    /**
+     *
+     */
+    template< typename HandlerType >
+    void
+    async_load_many
+        ( std::vector< key_type > const& keys
+        , HandlerType && handler
+        , session_base::load_policy policy = session_base::LOAD_LOCAL_FIRST )
+    {
+        engine_.async_load_many( keys
+                               , std::forward< HandlerType >( handler )
+                               , policy );
     }
 
+    /**
+     *  Call handler from run().
+     */
+    template< typename HandlerType >
+    void
+    post
+        ( HandlerType && handler )
+    { io_service_.post( std::forward< HandlerType >( handler ) ); }
+
+    /**
+     *
+     */
+    std::error_code
+    save_routing_table
+        ( std::string const& path )
+    { return engine_.save_routing_table( path ); }
+
+    /**
+     *
+     */
+    std::error_code
+    load_routing_table
+        ( std::string const& path )
+    { return engine_.load_routing_table( path ); }
+
     /**
      *
      */
@@ -158,6 +236,25 @@ public:
         io_service_.post( service_stopper );
     }
 
+private:
+    /**
+     *  Read a routing table snapshot, or draw
+     *  a new id if it can't be read.
+     */
+    static routing_table_snapshot
+    read_routing_table_snapshot
+        ( std::string const& path )
+    {
+        routing_table_snapshot snapshot;
+        if ( load_routing_table_snapshot( path, snapshot ) )
+        {
+            std::default_random_engine random_engine{ std::random_device{}() };
+            snapshot = routing_table_snapshot{ id{ random_engine }, {} };
+        }
+
+        return snapshot;
+    }
+
 private:
     ///
     boost::asio::io_service io_service_;
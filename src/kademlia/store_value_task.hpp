@@ -30,11 +30,12 @@
 #   pragma once
 #endif
 
-#include <memory>
+#include <algorithm>
 #include <type_traits>
 #include <system_error>
+#include <vector>
 
-#include "kademlia/lookup_task.hpp"
+#include "kademlia/find_peers_task.hpp"
 #include "kademlia/log.hpp"
 #include "kademlia/message.hpp"
 #include "kademlia/constants.hpp"
@@ -42,10 +43,15 @@
 namespace kademlia {
 namespace detail {
 
-///
+/**
+ *  @brief Store a value on the closest peers of its key.
+ *  @details
+ *  This task is the handler of the find_peers_task
+ *  looking for these peers, hence it only sends the
+ *  store requests once the lookup is over.
+ */
 template< typename SaveHandlerType, typename TrackerType, typename DataType >
 class store_value_task final
-    : public lookup_task
 {
 public:
     ///
@@ -61,41 +67,15 @@ public:
     /**
      *
      */
-    template< typename RoutingTableType >
-    static void
-    start
-        ( detail::id const & key
-        , data_type const& data
-        , tracker_type & tracker
-        , RoutingTableType & routing_table
-        , save_handler_type handler )
-    {
-        std::shared_ptr< store_value_task > c;
-        c.reset( new store_value_task( key
-                                     , data
-                                     , tracker
-                                     , routing_table
-                                     , std::move( handler ) ) );
-
-        try_to_store_value( c );
-    }
-
-private:
-    /**
-     *
-     */
-    template< typename RoutingTableType, typename HandlerType >
+    template< typename HandlerType >
     store_value_task
         ( detail::id const & key
         , data_type const& data
         , tracker_type & tracker
-        , RoutingTableType & routing_table
         , HandlerType && save_handler )
-            : lookup_task( key
-                         , routing_table.find( key )
-                         , routing_table.end() )
-            , tracker_( tracker )
+            : key_( key )
             , data_( data )
+            , tracker_( tracker )
             , save_handler_( std::forward< HandlerType >( save_handler ) )
     {
         LOG_DEBUG( store_value_task, this )
@@ -105,178 +85,50 @@ private:
     }
 
     /**
-     *
+     *  @brief Ask the closest peers to store the value.
+     *  @param peers The closest peers found, sorted by
+     *         distance to the key.
      */
     void
-    notify_caller
-        ( std::error_code const& failure )
-    { save_handler_( failure ); }
-
-    /**
-     *
-     */
-    data_type const&
-    get_data
-        ( void )
-        const
-    { return data_; }
-
-    /**
-     *
-     */
-    static void
-    try_to_store_value
-        ( std::shared_ptr< store_value_task > task
-        , std::size_t concurrent_requests_count = CONCURRENT_FIND_PEER_REQUESTS_COUNT )
+    operator()
+        ( std::error_code const& failure
+        , std::vector< peer > const& peers )
     {
-        LOG_DEBUG( store_value_task, task.get() )
-                << "trying to find closer peer to store '"
-                << task->get_key() << "' value." << std::endl;
-
-        find_peer_request_body const request{ task->get_key() };
-
-        auto const closest_candidates = task->select_new_closest_candidates
-                ( concurrent_requests_count );
-
-        for ( auto const& c : closest_candidates )
-            send_find_peer_to_store_request( request, c, task );
-
-        // If no more requests are in flight
-        // we know the closest peers hence ask
-        // them to store the value.
-        if ( task->have_all_requests_completed() )
-            send_store_requests( task ); 
-    }
-
-    /**
-     *
-     */
-    static void
-    send_find_peer_to_store_request
-        ( find_peer_request_body const& request
-        , peer const& current_candidate
-        , std::shared_ptr< store_value_task > task )
-    {
-        LOG_DEBUG( store_value_task, task.get() )
-                << "sending find peer request to store '"
-                << task->get_key() << "' to '"
-                << current_candidate << "'." << std::endl;
-
-        // On message received, process it.
-        auto on_message_received = [ task ]
-            ( ip_endpoint const& s
-            , header const& h
-            , buffer::const_iterator i
-            , buffer::const_iterator e )
-        {
-            handle_find_peer_to_store_response( s, h, i, e, task );
-        };
-
-        // On error, retry with another endpoint.
-        auto on_error = [ task, current_candidate ]
-            ( std::error_code const& )
-        {
-            // XXX: Can also flag candidate as invalid is
-            // present in routing table.
-            task->flag_candidate_as_invalid( current_candidate.id_ );
-
-            try_to_store_value( task );
-        };
-
-        task->tracker_.send_request( request
-                                   , current_candidate.endpoint_
-                                   , PEER_LOOKUP_TIMEOUT
-                                   , on_message_received
-                                   , on_error );
-    }
-
-    /**
-     *
-     */
-    static void
-    handle_find_peer_to_store_response
-        ( ip_endpoint const& s
-        , header const& h
-        , buffer::const_iterator i
-        , buffer::const_iterator e
-        , std::shared_ptr< store_value_task > task )
-    {
-        LOG_DEBUG( store_value_task, task.get() )
-                << "handle find peer to store response from '"
-                << s << "'." << std::endl;
-
-        if ( h.type_ != header::FIND_PEER_RESPONSE )
-        {
-            LOG_DEBUG( store_value_task, task.get() )
-                    << "unexpected find peer response (type="
-                    << int( h.type_ ) << ")" << std::endl;
-
-            task->flag_candidate_as_invalid( h.source_id_ );
-            try_to_store_value( task );
-            return;
-
-        };
-
-        find_peer_response_body response;
-        if ( auto failure = deserialize( i, e, response ) )
+        if ( ! failure )
         {
-            LOG_DEBUG( store_value_task, task.get() )
-                    << "failed to deserialize find peer response ("
-                    << failure.message() << ")" << std::endl;
-            task->flag_candidate_as_invalid( h.source_id_ );
-        }
-        else
-        {
-            task->flag_candidate_as_valid( h.source_id_ );
-            task->add_candidates( response.peers_ );
+            auto const count = std::min( peers.size(), REDUNDANT_SAVE_COUNT );
+            for ( std::size_t i = 0; i != count; ++ i )
+                send_store_request( peers[ i ] );
         }
 
-        try_to_store_value( task );
-    }
-
-    /**
-     *
-     */
-    static void
-    send_store_requests
-        ( std::shared_ptr< store_value_task > task )
-    {
-        auto const & candidates
-                = task->select_closest_valid_candidates( REDUNDANT_SAVE_COUNT );
-
-        for ( auto c : candidates )
-            send_store_request( c, task );
-
-        if ( candidates.empty() )
-            task->notify_caller( make_error_code( INITIAL_PEER_FAILED_TO_RESPOND ) );
-        else
-            task->notify_caller( std::error_code{} );
+        save_handler_( failure );
     }
 
+private:
     /**
      *
      */
-    static void
+    void
     send_store_request
-        ( peer const& current_candidate
-        , std::shared_ptr< store_value_task > task )
+        ( peer const& current_candidate )
     {
-        LOG_DEBUG( store_value_task, task.get() )
+        LOG_DEBUG( store_value_task, this )
                 << "send store request of '"
-                << task->get_key() << "' to '"
+                << key_ << "' to '"
                 << current_candidate << "'." << std::endl;
 
-        store_value_request_body const request{ task->get_key()
-                                              , task->get_data() };
-        task->tracker_.send_request( request, current_candidate.endpoint_ );
+        store_value_request_body const request{ key_, data_ };
+        tracker_.send_request( request, current_candidate.endpoint_ );
     }
 
 private:
     ///
-    tracker_type & tracker_;
+    id key_;
     ///
     data_type data_;
     ///
+    tracker_type & tracker_;
+    ///
     save_handler_type save_handler_;
 };
 
@@ -293,17 +145,20 @@ start_store_value_task
     , DataType const& data
     , TrackerType & tracker
     , RoutingTableType & routing_table
-    , HandlerType && save_handler )
+    , HandlerType && save_handler
+    , lookup_statistics * statistics = nullptr
+    , lookup_cache * cache = nullptr )
 {
     using handler_type = typename std::decay< HandlerType >::type;
     using task = store_value_task< handler_type, TrackerType, DataType >;
 
-    task::start( key, data, tracker, routing_table
-               , std::forward< HandlerType >( save_handler ) );
+    start_find_peers_task( key, tracker, routing_table
+                         , task{ key, data, tracker
+                               , std::forward< HandlerType >( save_handler ) }
+                         , statistics, cache );
 }
 
 } // namespace detail
 } // namespace kademlia
 
 #endif
-
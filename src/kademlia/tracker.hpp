@@ -30,7 +30,12 @@
 #   pragma once
 #endif
 
+#include <unordered_set>
+
+#include "kademlia/id.hpp"
 #include "kademlia/log.hpp"
+#include "kademlia/peer.hpp"
+#include "kademlia/timer.hpp"
 #include "kademlia/message_serializer.hpp"
 #include "kademlia/response_router.hpp"
 #include "kademlia/network.hpp"
@@ -43,9 +48,11 @@ namespace kademlia {
 namespace detail {
 
 /**
- *
+ *  @note Responses and failures of requests sent to known
+ *        peers are recorded into the routing table statistics.
  */
-template< typename RandomEngineType, typename NetworkType >
+template< typename NetworkType
+        , typename RoutingTableType >
 class tracker final
 {
 public:
@@ -56,7 +63,7 @@ public:
     using endpoint_type = typename network_type::endpoint_type;
 
     ///
-    using random_engine_type = RandomEngineType;
+    using routing_table_type = RoutingTableType;
 
 public:
     /**
@@ -66,11 +73,13 @@ public:
         ( boost::asio::io_service & io_service
         , id const& my_id
         , network_type & network
-        , random_engine_type & random_engine )
+        , routing_table_type & routing_table )
             : response_router_( io_service )
+            , timer_( io_service )
             , message_serializer_( my_id )
             , network_( network )
-            , random_engine_( random_engine )
+            , routing_table_( routing_table )
+            , restored_peers_()
     { }
 
     /**
@@ -100,28 +109,88 @@ public:
         , OnResponseReceived const& on_response_received
         , OnError const& on_error )
     {
-        id const response_id( random_engine_ );
+        // The callbacks are registered first as the
+        // response token designates their slot.
+        auto const response_id = response_router_.register_temporary_callback
+                ( timeout, on_response_received, on_error );
+
         // Generate the request buffer.
         auto message = message_serializer_.serialize( request, response_id );
 
-        // This lamba will keep the request message alive.
-        auto on_request_sent = [ this, response_id
-                               , on_response_received, on_error
-                               , timeout ]
+        auto on_request_sent = [ this, response_id, on_error ]
             ( std::error_code const& failure )
         {
-            if ( failure )
+            if ( ! failure )
+                return;
+
+            // Unless the response has been received meanwhile.
+            if ( response_router_.unregister_callback( response_id ) )
                 on_error( failure );
-            else
-                response_router_.register_temporary_callback( response_id, timeout
-                                                            , on_response_received
-                                                            , on_error );
         };
 
         // Serialize the request and send it.
         network_.send( message, e, on_request_sent );
     }
 
+    /**
+     *  Flag a peer restored from a snapshot, it's
+     *  evicted unless it answers its first request.
+     */
+    void
+    add_restored_peer
+        ( id const& peer_id )
+    { restored_peers_.insert( peer_id ); }
+
+    /**
+     *  Send a request to a known peer, the round trip
+     *  time or the failure is recorded into its statistics.
+     *  A restored peer which never answered is evicted
+     *  on its first failure.
+     */
+    template< typename Request, typename OnResponseReceived, typename OnError >
+    void
+    send_request
+        ( Request const& request
+        , peer const& p
+        , timer::duration const& timeout
+        , OnResponseReceived const& on_response_received
+        , OnError const& on_error )
+    {
+        id const peer_id = p.id_;
+        auto const sent_time = timer::clock::now();
+        auto on_response = [ this, peer_id, sent_time, on_response_received ]
+            ( endpoint_type const& s
+            , header const& h
+            , buffer::const_iterator i
+            , buffer::const_iterator e )
+        {
+            // The endpoint may now belong to another peer.
+            if ( h.source_id_ == peer_id )
+            {
+                routing_table_.record_response
+                        ( peer_id, timer::clock::now() - sent_time );
+                restored_peers_.erase( peer_id );
+            }
+
+            on_response_received( s, h, i, e );
+        };
+
+        auto on_request_failed = [ this, peer_id, on_error ]
+            ( std::error_code const& failure )
+        {
+            routing_table_.record_failure( peer_id );
+
+            // The snapshot may be outdated.
+            if ( restored_peers_.erase( peer_id ) )
+                routing_table_.remove( peer_id );
+
+            on_error( failure );
+        };
+
+        send_request( request, p.endpoint_, timeout
+                    , on_response, on_request_failed );
+    }
+
     /**
      *
      */
@@ -131,8 +200,7 @@ public:
         ( Request const& request
         , endpoint_type const& e )
     {
-        id const response_id( random_engine_ );
-        send_response( response_id, request, e );
+        send_response( response_router_.generate_token(), request, e );
     }
 
     /**
@@ -165,15 +233,29 @@ public:
         , buffer::const_iterator e )
     { response_router_.handle_new_response( s, h, i, e ); }
 
+    /**
+     *  Call on_expired once timeout has elapsed.
+     */
+    template< typename Callback >
+    void
+    schedule
+        ( timer::duration const& timeout
+        , Callback const& on_expired )
+    { timer_.expires_from_now( timeout, on_expired ); }
+
 private:
     ///
     response_router response_router_;
     ///
+    timer timer_;
+    ///
     message_serializer message_serializer_;
     ///
     network_type & network_;
     ///
-    random_engine_type & random_engine_;
+    routing_table_type & routing_table_;
+    ///
+    std::unordered_set< id, id_hasher > restored_peers_;
 };
 
 } // namespace detail
@@ -0,0 +1,221 @@
+// Copyright (c) 2013-2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_VALUE_CACHE_HPP
+#define KADEMLIA_VALUE_CACHE_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <map>
+#include <unordered_map>
+
+#include "kademlia/id.hpp"
+#include "kademlia/timer.hpp"
+
+namespace kademlia {
+namespace detail {
+
+/**
+ *  @brief Keep the values cached on behalf of other peers.
+ *  @details
+ *  Values expire at the time chosen by the requester.
+ *  They're indexed by expiration time too, hence expired
+ *  values are dropped first when full, then the one
+ *  expiring first, each in logarithmic time.
+ */
+template< typename DataType >
+class value_cache final
+{
+public:
+    ///
+    using data_type = DataType;
+
+public:
+    /**
+     *
+     */
+    explicit
+    value_cache
+        ( std::size_t max_size )
+            : max_size_( max_size )
+            , values_()
+            , expirations_()
+    { }
+
+    /**
+     *
+     */
+    value_cache
+        ( value_cache const& )
+        = delete;
+
+    /**
+     *
+     */
+    value_cache &
+    operator=
+        ( value_cache const& )
+        = delete;
+
+    /**
+     *  @brief Return the value of key if it
+     *         hasn't expired at now, or nullptr.
+     */
+    data_type const*
+    find
+        ( id const& key
+        , timer::clock::time_point const& now )
+    {
+        auto const i = values_.find( key );
+        if ( i == values_.end() )
+            return nullptr;
+
+        // Expired values are dropped lazily.
+        if ( i->second.expiration_->first <= now )
+        {
+            erase( i );
+            return nullptr;
+        }
+
+        return &i->second.data_;
+    }
+
+    /**
+     *  @brief Cache the value of key until expiration_time.
+     *  @note A value already cached never expires sooner.
+     */
+    void
+    insert
+        ( id const& key
+        , data_type data
+        , timer::clock::time_point const& expiration_time
+        , timer::clock::time_point const& now )
+    {
+        if ( max_size_ == 0 )
+            return;
+
+        auto i = values_.find( key );
+        if ( i == values_.end() )
+        {
+            make_room( now );
+            i = values_.emplace( key, entry{ std::move( data )
+                                           , expirations_.end() } ).first;
+        }
+        else
+        {
+            i->second.data_ = std::move( data );
+
+            if ( i->second.expiration_->first >= expiration_time )
+                return;
+
+            expirations_.erase( i->second.expiration_ );
+        }
+
+        i->second.expiration_ = expirations_.emplace( expiration_time, key );
+    }
+
+    /**
+     *
+     */
+    void
+    erase
+        ( id const& key )
+    {
+        auto const i = values_.find( key );
+        if ( i != values_.end() )
+            erase( i );
+    }
+
+    /**
+     *
+     */
+    std::size_t
+    size
+        ( void )
+        const
+    { return values_.size(); }
+
+private:
+    /// Ids of the values sorted by expiration time.
+    using expirations_type = std::multimap< timer::clock::time_point, id >;
+
+    ///
+    struct entry final
+    {
+        data_type data_;
+        typename expirations_type::iterator expiration_;
+    };
+
+    ///
+    using values_type = std::unordered_map< id, entry, id_hasher >;
+
+private:
+    /**
+     *
+     */
+    void
+    erase
+        ( typename values_type::iterator i )
+    {
+        expirations_.erase( i->second.expiration_ );
+        values_.erase( i );
+    }
+
+    /**
+     *  @brief Ensure a value can be added without exceeding max_size_.
+     */
+    void
+    make_room
+        ( timer::clock::time_point const& now )
+    {
+        if ( values_.size() < max_size_ )
+            return;
+
+        // Expired values first.
+        while ( ! expirations_.empty()
+              && expirations_.begin()->first <= now )
+            erase( values_.find( expirations_.begin()->second ) );
+
+        if ( values_.size() < max_size_ )
+            return;
+
+        erase( values_.find( expirations_.begin()->second ) );
+    }
+
+private:
+    ///
+    std::size_t max_size_;
+    ///
+    values_type values_;
+    ///
+    expirations_type expirations_;
+};
+
+} // namespace detail
+} // namespace kademlia
+
+#endif
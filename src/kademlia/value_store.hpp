@@ -36,6 +36,8 @@
 #include <vector>
 #include <boost/functional/hash.hpp>
 
+#include "kademlia/id.hpp"
+
 namespace kademlia {
 namespace detail {
 
@@ -52,6 +54,22 @@ struct value_store_key_hasher
     { return boost::hash_range( key.begin(), key.end() ); }
 };
 
+/**
+ *  Ids don't need to be hashed again.
+ */
+template< std::size_t BitSize, typename Hasher >
+struct value_store_key_hasher< basic_id< BitSize, Hasher > >
+{
+    using argument_type = basic_id< BitSize, Hasher >;
+    using result_type = std::size_t;
+
+    result_type
+    operator()
+        ( argument_type const& key )
+        const
+    { return id_hasher{}( key ); }
+};
+
 ///
 template< typename Key, typename Value >
 using value_store = std::unordered_map
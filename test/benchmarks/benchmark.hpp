@@ -0,0 +1,117 @@
+// Copyright (c) 2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef KADEMLIA_BENCHMARK_HPP
+#define KADEMLIA_BENCHMARK_HPP
+
+#ifdef _MSC_VER
+#   pragma once
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace kademlia {
+namespace benchmarks {
+
+/**
+ *  Prevent the compiler from optimizing away a computed value.
+ */
+template< typename ValueType >
+inline void
+do_not_optimize
+    ( ValueType const& value )
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+    // The value must be stored in memory
+    // as the empty assembly may read it.
+    asm volatile( "" : : "r"( &value ) : "memory" );
+#else
+    static volatile std::uintptr_t sink;
+    sink = sink + reinterpret_cast< std::uintptr_t >( &value );
+#endif
+}
+
+/**
+ *  Execute operations_count times the provided
+ *  function and print the resulting throughput.
+ *  @note The best of several runs is kept to
+ *        reduce noise from other processes.
+ */
+template< typename Function >
+void
+measure
+    ( std::string const& name
+    , std::size_t operations_count
+    , Function && f
+    , std::size_t runs_count = 5 )
+{
+    using clock = std::chrono::steady_clock;
+
+    auto best = clock::duration::max();
+    for ( std::size_t run = 0; run != runs_count; ++ run )
+    {
+        auto const start = clock::now();
+        for ( std::size_t i = 0; i != operations_count; ++ i )
+            f( i );
+        best = std::min( best, clock::duration( clock::now() - start ) );
+    }
+
+    auto const nanoseconds = std::chrono::duration_cast
+            < std::chrono::nanoseconds >( best ).count();
+
+    std::cout << std::left << std::setw( 40 ) << name
+              << std::right << std::setw( 12 ) << std::fixed
+              << std::setprecision( 1 )
+              << double( nanoseconds ) / operations_count << " ns/op"
+              << std::setw( 14 ) << std::setprecision( 0 )
+              << 1e9 * operations_count / ( nanoseconds + 1 ) << " op/s"
+              << std::endl;
+}
+
+/**
+ *  Read the optional iterations count from the command line.
+ */
+inline std::size_t
+get_iterations_count
+    ( int argc
+    , char * argv[]
+    , std::size_t default_count )
+{
+    if ( argc < 2 )
+        return default_count;
+
+    return std::strtoull( argv[ 1 ], nullptr, 10 );
+}
+
+} // namespace benchmarks
+} // namespace kademlia
+
+#endif
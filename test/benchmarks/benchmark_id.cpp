@@ -0,0 +1,205 @@
+// Copyright (c) 2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchmarks/benchmark.hpp"
+
+#include "kademlia/id.hpp"
+#include "kademlia/value_store.hpp"
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace kb = k::benchmarks;
+
+namespace {
+
+/**
+ *
+ */
+std::vector< kd::id >
+generate_ids
+    ( std::default_random_engine & random_engine
+    , std::size_t count )
+{
+    std::vector< kd::id > ids;
+    ids.reserve( count );
+
+    for ( std::size_t i = 0; i != count; ++ i )
+        ids.emplace_back( random_engine );
+
+    return ids;
+}
+
+} // anonymous namespace
+
+int
+main
+    ( int argc
+    , char * argv[] )
+{
+    auto const iterations_count = kb::get_iterations_count( argc, argv
+                                                          , 10000000 );
+
+    std::default_random_engine random_engine;
+
+    auto const ids = generate_ids( random_engine, 4096 );
+    auto const mask = ids.size() - 1;
+
+    // Ids sharing most of their bits, as met when
+    // sorting peers close to a target.
+    std::vector< kd::id > close_ids{ ids };
+    for ( auto & i : close_ids )
+        for ( std::size_t j = 0; j != kd::id::BIT_SIZE - 8; ++ j )
+            i[ j ] = static_cast< bool >( ids.front()[ j ] );
+
+    kb::measure( "distance", iterations_count
+               , [ & ]( std::size_t i )
+    {
+        auto const d = kd::distance( ids[ i & mask ], ids[ ( i + 1 ) & mask ] );
+        kb::do_not_optimize( d );
+    } );
+
+    std::vector< kd::id > const same_ids{ ids };
+    kb::measure( "operator== (equal ids)", iterations_count
+               , [ & ]( std::size_t i )
+    {
+        bool const equal = ids[ i & mask ] == same_ids[ i & mask ];
+        kb::do_not_optimize( equal );
+    } );
+
+    kb::measure( "operator< (random ids)", iterations_count
+               , [ & ]( std::size_t i )
+    {
+        bool const less = ids[ i & mask ] < ids[ ( i + 1 ) & mask ];
+        kb::do_not_optimize( less );
+    } );
+
+    kb::measure( "operator< (close ids)", iterations_count
+               , [ & ]( std::size_t i )
+    {
+        bool const less = close_ids[ i & mask ]
+                        < close_ids[ ( i + 1 ) & mask ];
+        kb::do_not_optimize( less );
+    } );
+
+    kb::measure( "is_closer (close ids)", iterations_count
+               , [ & ]( std::size_t i )
+    {
+        bool const closer = kd::is_closer( close_ids[ i & mask ]
+                                         , close_ids[ ( i + 1 ) & mask ]
+                                         , close_ids[ ( i + 2 ) & mask ] );
+        kb::do_not_optimize( closer );
+    } );
+
+    kb::measure( "common_prefix_length (close ids)", iterations_count
+               , [ & ]( std::size_t i )
+    {
+        auto const length = kd::common_prefix_length
+                ( close_ids[ i & mask ], close_ids[ ( i + 1 ) & mask ] );
+        kb::do_not_optimize( length );
+    } );
+
+    kd::value_store_key_hasher< kd::id > const hasher{};
+    kb::measure( "value_store_key_hasher", iterations_count
+               , [ & ]( std::size_t i )
+    {
+        auto const hash = hasher( ids[ i & mask ] );
+        kb::do_not_optimize( hash );
+    } );
+
+    std::vector< std::string > id_strings;
+    for ( auto const& i : ids )
+    {
+        std::ostringstream out;
+        out << i;
+        id_strings.push_back( out.str() );
+    }
+
+    kb::measure( "id( std::string )", iterations_count / 10
+               , [ & ]( std::size_t i )
+    {
+        kd::id const parsed_id{ id_strings[ i & mask ] };
+        kb::do_not_optimize( parsed_id );
+    } );
+
+    kd::id parsed_id;
+    kb::measure( "from_hex", iterations_count / 10
+               , [ & ]( std::size_t i )
+    {
+        auto const& s = id_strings[ i & mask ];
+        kd::from_hex( s.data(), s.data() + s.size(), parsed_id );
+        kb::do_not_optimize( parsed_id );
+    } );
+
+    std::ostringstream out;
+    kb::measure( "operator<<", iterations_count / 10
+               , [ & ]( std::size_t i )
+    {
+        out.seekp( 0 );
+        out << ids[ i & mask ];
+        kb::do_not_optimize( out );
+    } );
+
+    char digits[ 2 * kd::id::BLOCKS_COUNT ];
+    kb::measure( "to_hex", iterations_count / 10
+               , [ & ]( std::size_t i )
+    {
+        kd::to_hex( ids[ i & mask ], digits );
+        kb::do_not_optimize( digits );
+    } );
+
+    std::vector< kd::value_to_hash_type > keys;
+    for ( std::size_t i = 0; i != ids.size(); ++ i )
+    {
+        auto const key = "key_" + std::to_string( i );
+        keys.emplace_back( key.begin(), key.end() );
+    }
+
+    kb::measure( "id( value )", iterations_count / 10
+               , [ & ]( std::size_t i )
+    {
+        kd::id const hashed_id{ keys[ i & mask ] };
+        kb::do_not_optimize( hashed_id );
+    } );
+
+    std::vector< kd::id > hashed_ids( keys.size() );
+    kb::measure( "hash_values (per value)", iterations_count / 10
+               , [ & ]( std::size_t i )
+    {
+        if ( ( i & mask ) == 0 )
+        {
+            kd::hash_values( keys.data(), keys.size(), hashed_ids.data() );
+            kb::do_not_optimize( hashed_ids );
+        }
+    } );
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+// Copyright (c) 2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmarks/benchmark.hpp"
+
+#include "kademlia/buffer.hpp"
+#include "kademlia/id.hpp"
+#include "kademlia/message.hpp"
+#include "kademlia/value_store.hpp"
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace kb = k::benchmarks;
+
+namespace {
+
+///
+using data_type = std::vector< std::uint8_t >;
+
+/**
+ *  The value deserialization used before
+ *  payloads were copied at once.
+ */
+void
+read_value_per_byte
+    ( kd::buffer::const_iterator i
+    , data_type & data )
+{
+    std::uint64_t size = 0;
+    for ( auto j = 0u; j < sizeof( size ); ++ j )
+        size |= std::uint64_t{ *i++ } << 8 * j;
+
+    for ( ; size > 0; -- size )
+        data.push_back( *i++ );
+}
+
+/**
+ *  Receive STORE requests of the same few keys,
+ *  as when values are republished.
+ */
+void
+measure_store
+    ( std::string const& name
+    , std::size_t operations_count
+    , std::vector< kd::id > const& keys
+    , data_type const& value )
+{
+    std::vector< kd::buffer > messages;
+    for ( auto const& key : keys )
+    {
+        messages.emplace_back();
+        kd::serialize( kd::store_value_request_body{ key, value }
+                     , messages.back() );
+    }
+
+    kd::value_store< kd::id, data_type > store;
+
+    kb::measure( "STORE " + name + " per byte", operations_count
+               , [ & ]( std::size_t i )
+    {
+        auto const& m = messages[ i % messages.size() ];
+        kd::store_value_request_body request;
+        std::copy_n( m.begin(), kd::id::BLOCKS_COUNT
+                   , request.data_key_hash_.begin() );
+        read_value_per_byte( m.begin() + kd::id::BLOCKS_COUNT
+                           , request.data_value_ );
+        store[ request.data_key_hash_ ] = std::move( request.data_value_ );
+    }
+    , 1 );
+
+    kb::measure( "STORE " + name + " body", operations_count
+               , [ & ]( std::size_t i )
+    {
+        auto const& m = messages[ i % messages.size() ];
+        auto b = m.begin();
+        kd::store_value_request_body request;
+        kd::deserialize( b, m.end(), request );
+        store[ request.data_key_hash_ ] = std::move( request.data_value_ );
+    }
+    , 1 );
+
+    kb::measure( "STORE " + name + " view", operations_count
+               , [ & ]( std::size_t i )
+    {
+        auto const& m = messages[ i % messages.size() ];
+        auto b = m.begin();
+        kd::store_value_request_view request;
+        kd::deserialize( b, m.end(), request );
+        store[ request.data_key_hash_ ].assign( request.data_value_.begin()
+                                              , request.data_value_.end() );
+    }
+    , 1 );
+
+    kb::do_not_optimize( store );
+}
+
+/**
+ *  Receive FIND_VALUE responses whose value is
+ *  handed to the caller then sent to be cached.
+ */
+void
+measure_find_value_response
+    ( std::string const& name
+    , std::size_t operations_count
+    , data_type const& value )
+{
+    kd::buffer message;
+    kd::serialize( kd::find_value_response_body{ value }, message );
+
+    kb::measure( "FIND_VALUE_RESPONSE " + name + " per byte", operations_count
+               , [ & ]( std::size_t )
+    {
+        kd::find_value_response_body response;
+        read_value_per_byte( message.begin(), response.data_ );
+        kd::cache_value_request_body const request
+                { kd::id{}, 0, response.data_ };
+        kb::do_not_optimize( request );
+    }
+    , 1 );
+
+    kb::measure( "FIND_VALUE_RESPONSE " + name + " body", operations_count
+               , [ & ]( std::size_t )
+    {
+        auto b = message.cbegin();
+        kd::find_value_response_body response;
+        kd::deserialize( b, message.cend(), response );
+        kd::cache_value_request_body const request
+                { kd::id{}, 0, response.data_ };
+        kb::do_not_optimize( request );
+    }
+    , 1 );
+
+    kb::measure( "FIND_VALUE_RESPONSE " + name + " view", operations_count
+               , [ & ]( std::size_t )
+    {
+        auto b = message.cbegin();
+        kd::find_value_response_view response;
+        kd::deserialize( b, message.cend(), response );
+        data_type data( response.data_.begin(), response.data_.end() );
+        kd::cache_value_request_body const request
+                { kd::id{}, 0, std::move( data ) };
+        kb::do_not_optimize( request );
+    }
+    , 1 );
+}
+
+} // anonymous namespace
+
+int
+main
+    ( int argc
+    , char * argv[] )
+{
+    auto const operations_count = kb::get_iterations_count( argc, argv
+                                                          , 20000 );
+
+    std::default_random_engine random_engine;
+
+    std::vector< kd::id > keys;
+    for ( std::size_t i = 0; i != 64; ++ i )
+        keys.emplace_back( random_engine );
+
+    for ( std::size_t const kilobytes : { 1, 4, 16, 60 } )
+    {
+        data_type value( kilobytes * 1024 );
+        std::generate( value.begin(), value.end(), std::ref( random_engine ) );
+
+        auto const name = std::to_string( kilobytes ) + "KB";
+        measure_store( name, operations_count, keys, value );
+        measure_find_value_response( name, operations_count, value );
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+// Copyright (c) 2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmarks/benchmark.hpp"
+
+#include "kademlia/id.hpp"
+#include "kademlia/ip_endpoint.hpp"
+#include "kademlia/routing_table.hpp"
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace kb = k::benchmarks;
+
+namespace {
+
+using routing_table = kd::routing_table< kd::ip_endpoint >;
+
+/**
+ *
+ */
+std::vector< kd::id >
+generate_ids
+    ( std::default_random_engine & random_engine
+    , std::size_t count )
+{
+    std::vector< kd::id > ids;
+    ids.reserve( count );
+
+    for ( std::size_t i = 0; i != count; ++ i )
+        ids.emplace_back( random_engine );
+
+    return ids;
+}
+
+/**
+ *  Generate ids sharing a prefix of every possible length
+ *  with reference_id, i.e. ids spread over all k-buckets.
+ */
+std::vector< kd::id >
+generate_close_ids
+    ( std::default_random_engine & random_engine
+    , kd::id const& reference_id
+    , std::size_t count )
+{
+    std::vector< kd::id > ids;
+    ids.reserve( count );
+
+    for ( std::size_t i = 0; i != count; ++ i )
+    {
+        kd::id new_id{ random_engine };
+
+        auto const prefix_length = i % kd::id::BIT_SIZE;
+        for ( std::size_t j = 0; j != prefix_length; ++ j )
+            new_id[ j ] = static_cast< bool >( reference_id[ j ] );
+        new_id[ prefix_length ] = ! reference_id[ prefix_length ];
+
+        ids.push_back( new_id );
+    }
+
+    return ids;
+}
+
+/**
+ *
+ */
+kd::ip_endpoint
+generate_endpoint
+    ( std::size_t index )
+{
+    auto const ip = "10.0." + std::to_string( index / 256 % 256 )
+                  + "." + std::to_string( index % 256 );
+
+    return kd::to_ip_endpoint( ip, 27980 );
+}
+
+} // anonymous namespace
+
+int
+main
+    ( int argc
+    , char * argv[] )
+{
+    auto const iterations_count = kb::get_iterations_count( argc, argv
+                                                          , 1000000 );
+
+    std::default_random_engine random_engine;
+
+    kd::id const my_id{ random_engine };
+    routing_table table{ my_id };
+
+    auto const ids = generate_ids( random_engine, 4096 );
+    std::vector< kd::ip_endpoint > endpoints;
+    for ( std::size_t i = 0, e = ids.size(); i != e; ++ i )
+        endpoints.push_back( generate_endpoint( i ) );
+
+    auto const targets = generate_ids( random_engine, 4096 );
+
+    std::vector< std::size_t > known_peers;
+    kb::measure( "routing_table::push (new peers)", ids.size()
+               , [ & ]( std::size_t i )
+    {
+        if ( table.push( ids[ i ], endpoints[ i ] ) )
+            known_peers.push_back( i );
+    }
+    , 1 );
+
+    std::cout << "routing table contains " << table.peer_count()
+              << " peers" << std::endl;
+
+    auto const mask = ids.size() - 1;
+    kb::measure( "routing_table::push (any peer)", iterations_count
+               , [ & ]( std::size_t i )
+               { table.push( ids[ i & mask ], endpoints[ i & mask ] ); } );
+
+    kb::measure( "routing_table::push (known peers)", iterations_count
+               , [ & ]( std::size_t i )
+    {
+        auto const j = known_peers[ i % known_peers.size() ];
+        table.push( ids[ j ], endpoints[ j ] );
+    } );
+
+    auto const close_ids = generate_close_ids( random_engine, my_id
+                                             , ids.size() );
+    kb::measure( "routing_table::push (close peers)", iterations_count
+               , [ & ]( std::size_t i )
+               { table.push( close_ids[ i & mask ], endpoints[ i & mask ] ); } );
+
+    std::cout << "routing table contains " << table.peer_count()
+              << " peers" << std::endl;
+
+    kb::measure( "routing_table::find (20 closest)", iterations_count
+               , [ & ]( std::size_t i )
+    {
+        std::size_t remaining_peer = 20;
+        for ( auto p = table.find( targets[ i & mask ] ), e = table.end()
+            ; p != e && remaining_peer > 0
+            ; ++ p, -- remaining_peer )
+            kb::do_not_optimize( p->second );
+    } );
+
+    std::vector< routing_table::value_type > closest_peers;
+    kb::measure( "routing_table::find_closest (20 closest)", iterations_count
+               , [ & ]( std::size_t i )
+    {
+        table.find_closest( targets[ i & mask ], 20, closest_peers );
+        kb::do_not_optimize( closest_peers.front() );
+    } );
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+// Copyright (c) 2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include "benchmarks/benchmark.hpp"
+
+#include "kademlia/id.hpp"
+#include "kademlia/value_store.hpp"
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace kb = k::benchmarks;
+
+namespace {
+
+/**
+ *  The value_store hasher used before ids
+ *  got their own.
+ */
+struct byte_hasher
+{
+    std::size_t
+    operator()
+        ( kd::id const& key )
+        const
+    { return boost::hash_range( key.begin(), key.end() ); }
+};
+
+/**
+ *
+ */
+template< typename StoreType >
+void
+measure_store
+    ( std::string const& name
+    , std::vector< kd::id > const& keys )
+{
+    StoreType store;
+
+    kb::measure( name + " insert", keys.size()
+               , [ & ]( std::size_t i )
+               { store[ keys[ i ] ] = std::uint32_t( i ); }
+               , 1 );
+
+    kb::measure( name + " lookup", keys.size()
+               , [ & ]( std::size_t i )
+    {
+        auto const found = store.find( keys[ i ] );
+        kb::do_not_optimize( found->second );
+    }
+    , 1 );
+}
+
+} // anonymous namespace
+
+int
+main
+    ( int argc
+    , char * argv[] )
+{
+    auto const entries_count = kb::get_iterations_count( argc, argv
+                                                       , 10000000 );
+
+    std::default_random_engine random_engine;
+
+    // Stored keys are hashes of the application keys.
+    std::vector< kd::id > keys( entries_count );
+    std::vector< kd::value_to_hash_type > values( 1024 );
+    for ( std::size_t i = 0; i < entries_count; i += values.size() )
+    {
+        auto const count = std::min( values.size(), entries_count - i );
+        for ( std::size_t j = 0; j != count; ++ j )
+        {
+            auto const key = "key_" + std::to_string( i + j );
+            values[ j ].assign( key.begin(), key.end() );
+        }
+
+        kd::hash_values( values.data(), count, &keys[ i ] );
+    }
+
+    std::shuffle( keys.begin(), keys.end(), random_engine );
+
+    measure_store< std::unordered_map< kd::id, std::uint32_t, byte_hasher > >
+            ( "boost::hash_range", keys );
+
+    measure_store< kd::value_store< kd::id, std::uint32_t > >
+            ( "value_store (id_hasher)", keys );
+
+    return EXIT_SUCCESS;
+}
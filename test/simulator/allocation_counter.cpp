@@ -0,0 +1,108 @@
+// Copyright (c) 2013-2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "simulator/allocation_counter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace kademlia {
+
+namespace {
+
+/// Each block is prefixed by its size, keeping the alignment.
+union block_header
+{
+    std::size_t size_;
+    std::max_align_t alignment_;
+};
+
+std::size_t allocated_bytes_count_;
+
+} // anonymous namespace
+
+std::size_t
+get_allocated_bytes_count
+    ( void )
+{ return allocated_bytes_count_; }
+
+} // namespace kademlia
+
+void *
+operator new
+    ( std::size_t size )
+{
+    using kademlia::block_header;
+
+    auto header = static_cast< block_header * >
+            ( std::malloc( sizeof( block_header ) + size ) );
+    if ( ! header )
+        throw std::bad_alloc{};
+
+    header->size_ = size;
+    kademlia::allocated_bytes_count_ += size;
+
+    return header + 1;
+}
+
+void
+operator delete
+    ( void * p )
+    noexcept
+{
+    using kademlia::block_header;
+
+    if ( ! p )
+        return;
+
+    auto header = static_cast< block_header * >( p ) - 1;
+    kademlia::allocated_bytes_count_ -= header->size_;
+
+    std::free( header );
+}
+
+void *
+operator new
+    ( std::size_t size
+    , std::nothrow_t const& )
+    noexcept
+{
+    try
+    {
+        return operator new( size );
+    }
+    catch ( std::bad_alloc const& )
+    {
+        return nullptr;
+    }
+}
+
+void
+operator delete
+    ( void * p
+    , std::nothrow_t const& )
+    noexcept
+{ operator delete( p ); }
+
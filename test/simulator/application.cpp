@@ -25,26 +25,33 @@
 
 #include "simulator/application.hpp"
 
+#include <iostream>
 #include <memory>
 
 #include <boost/asio/io_service.hpp>
 
+#include "simulator/allocation_counter.hpp"
 #include "simulator/fake_socket.hpp"
 
 #include "kademlia/log.hpp"
 #include "kademlia/buffer.hpp"
 #include "kademlia/engine.hpp"
+#include "kademlia/routing_table.hpp"
+#include "kademlia/split_routing_table.hpp"
 
 namespace kademlia {
 namespace application {
 
 namespace {
 
+template< typename RoutingTableType >
 using test_engine = detail::engine< detail::buffer
                                   , detail::buffer
-                                  , fake_socket >;
+                                  , fake_socket
+                                  , RoutingTableType >;
 
-using engine_ptr = std::shared_ptr< test_engine >;
+template< typename RoutingTableType >
+using engine_ptr = std::shared_ptr< test_engine< RoutingTableType > >;
 
 /**
  *
@@ -58,19 +65,22 @@ to_buffer
 /**
  *
  */
-std::vector< engine_ptr >
+template< typename RoutingTableType >
+std::vector< engine_ptr< RoutingTableType > >
 create_engines
     ( boost::asio::io_service & io_service
     , configuration const& c )
 {
-    std::vector< engine_ptr > engines;
+    using engine_type = test_engine< RoutingTableType >;
+
+    std::vector< engine_ptr< RoutingTableType > > engines;
 
     endpoint const ipv4_listen( "0.0.0.0", fake_socket::FIXED_PORT );
     endpoint const ipv6_listen( "::", fake_socket::FIXED_PORT );
 
     // Create bootstrap node.
     {
-        auto e = std::make_shared< test_engine >( io_service
+        auto e = std::make_shared< engine_type >( io_service
                                                 , ipv4_listen
                                                 , ipv6_listen );
         engines.push_back( e );
@@ -85,7 +95,7 @@ create_engines
     // Create nodes.
     for ( std::size_t i = 0ULL; i != c.clients_count; ++i )
     {
-        auto e = std::make_shared< test_engine >( io_service
+        auto e = std::make_shared< engine_type >( io_service
                                                 , first_peer
                                                 , ipv4_listen
                                                 , ipv6_listen );
@@ -100,9 +110,10 @@ create_engines
 /**
  *
  */
+template< typename EnginePtr >
 void
 schedule_load
-    ( engine_ptr const& e
+    ( EnginePtr const& e
     , std::size_t value
     , std::size_t & received_messages_count )
 {
@@ -152,12 +163,41 @@ schedule_loads
         io_service.run_one();
 }
 
+/**
+ *  Load the same value from each engine in turn, so that
+ *  each load can benefit from the copies cached by the
+ *  previous ones.
+ */
+template< typename Engines >
+void
+schedule_hot_loads
+    ( Engines const& engines
+    , boost::asio::io_service & io_service
+    , std::size_t total_messages_count )
+{
+    LOG_DEBUG( simulator, nullptr ) << "loading '"
+            << total_messages_count
+            << "' times the same message." << std::endl;
+
+    std::size_t received_messages_count = 0ULL;
+    for ( auto i = 0ULL; i != total_messages_count; ++i )
+    {
+        schedule_load( engines[ i % engines.size() ]
+                     , 0
+                     , received_messages_count );
+
+        while ( received_messages_count != i + 1 )
+            io_service.run_one();
+    }
+}
+
 /**
  *
  */
+template< typename EnginePtr >
 void
 schedule_save
-    ( engine_ptr const& e
+    ( EnginePtr const& e
     , std::size_t value
     , std::size_t & sent_messages_count )
 {
@@ -203,27 +243,113 @@ schedule_saves
         io_service.run_one();
 }
 
-} // anonymous namespace
+/**
+ *  Sum the lookup statistics of all engines.
+ */
+template< typename Engines >
+detail::lookup_statistics
+sum_lookup_statistics
+    ( Engines const& engines )
+{
+    detail::lookup_statistics sum{};
+
+    for ( auto const& e : engines )
+    {
+        auto const& s = e->get_lookup_statistics();
+        sum.lookups_count_ += s.lookups_count_;
+        sum.hops_count_ += s.hops_count_;
+        sum.requests_count_ += s.requests_count_;
+    }
+
+    return sum;
+}
 
+/**
+ *
+ */
 void
-run
-    ( configuration const& c )
+print_lookup_statistics
+    ( char const* name
+    , detail::lookup_statistics const& before
+    , detail::lookup_statistics const& after )
 {
-#if KADEMLIA_ENABLE_DEBUG
-    for ( auto const& module : c.log_modules )
-        detail::enable_log_for( module );
-#endif
+    auto const lookups_count = double( after.lookups_count_
+                                     - before.lookups_count_ );
+
+    std::cout << "Hops per " << name << ": "
+              << ( after.hops_count_ - before.hops_count_ ) / lookups_count
+              << "\nRequests per " << name << " lookup: "
+              << ( after.requests_count_ - before.requests_count_ )
+                 / lookups_count
+              << std::endl;
+}
 
+/**
+ *
+ */
+template< typename RoutingTableType >
+void
+simulate
+    ( configuration const& c )
+{
     boost::asio::io_service io_service;
+    auto const initial_allocated_bytes_count = get_allocated_bytes_count();
 
     std::cout << "Creating peers" << std::endl;
-    auto engines = create_engines( io_service, c );
+    auto engines = create_engines< RoutingTableType >( io_service, c );
+
+    auto & sent_packets_count = fake_socket::get_sent_packets_count();
+
+    auto const initial_statistics = sum_lookup_statistics( engines );
 
     std::cout << "Performing saves" << std::endl;
+    sent_packets_count = 0;
     schedule_saves( engines, io_service, c.total_messages_count );
+    auto const save_packets_count = sent_packets_count;
+    auto const save_statistics = sum_lookup_statistics( engines );
 
     std::cout << "Perfoming loads" << std::endl;
+    sent_packets_count = 0;
     schedule_loads( engines, io_service, c.total_messages_count );
+    auto const load_packets_count = sent_packets_count;
+    auto const load_statistics = sum_lookup_statistics( engines );
+
+    std::cout << "Perfoming hot key loads" << std::endl;
+    schedule_hot_loads( engines, io_service, c.total_messages_count );
+    auto const hot_load_statistics = sum_lookup_statistics( engines );
+
+    // Requests and responses are counted.
+    std::cout << "Packets per save: "
+              << double( save_packets_count ) / c.total_messages_count
+              << "\nPackets per load: "
+              << double( load_packets_count ) / c.total_messages_count
+              << "\nAllocated bytes per peer: "
+              << ( get_allocated_bytes_count() - initial_allocated_bytes_count )
+                 / engines.size()
+              << std::endl;
+
+    // Store requests aren't part of the save lookup.
+    print_lookup_statistics( "save", initial_statistics, save_statistics );
+    print_lookup_statistics( "load", save_statistics, load_statistics );
+    print_lookup_statistics( "hot key load"
+                           , load_statistics, hot_load_statistics );
+}
+
+} // anonymous namespace
+
+void
+run
+    ( configuration const& c )
+{
+#if KADEMLIA_ENABLE_DEBUG
+    for ( auto const& module : c.log_modules )
+        detail::enable_log_for( module );
+#endif
+
+    if ( c.use_split_routing_table )
+        simulate< detail::split_routing_table< detail::ip_endpoint > >( c );
+    else
+        simulate< detail::routing_table< detail::ip_endpoint > >( c );
 }
 
 } // namespace application
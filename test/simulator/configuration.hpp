@@ -45,6 +45,7 @@ struct configuration
 #endif
     std::size_t clients_count;
     std::size_t total_messages_count;
+    bool use_split_routing_table;
 };
 
 } // namespace kademlia
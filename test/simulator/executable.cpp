@@ -68,6 +68,11 @@ parse_configuration
         , po::value< std::vector< std::string > >( &c.log_modules )
         , "Enable the specified module log\n" )
 #endif
+        ( "split-routing-table,s"
+        , po::bool_switch( &c.use_split_routing_table )
+        , "Use the k_bucket splitting routing table, which uses\n"
+          "less memory but sends more packets per lookup\n" )
+
         ( "help,h", "Print accepted arguments\n" )
 
         ( "version,v", "Print version\n" );
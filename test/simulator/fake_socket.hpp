@@ -205,6 +205,8 @@ public:
         , endpoint_type const& to
         , Callback && callback )
     {
+        ++ get_sent_packets_count();
+
         // Ensure the destination socket is listening.
         auto target = get_socket( to );
         if ( ! target )
@@ -224,6 +226,17 @@ public:
                                , std::forward< Callback >( callback ) );
     }
 
+    /**
+     *  @return The count of packets sent by all fake sockets.
+     */
+    static std::size_t &
+    get_sent_packets_count
+        ( void )
+    {
+        static std::size_t count_;
+        return count_;
+    }
+
     /**
      *
      */
@@ -37,10 +37,7 @@ create_endpoint
     ( std::string const& ip = std::string{ "127.0.0.1" }
     , std::uint16_t const& service = 12345 )
 {
-    using endpoint_type = kademlia::detail::ip_endpoint;
-
-    return endpoint_type{ boost::asio::ip::address::from_string( ip )
-                        , service };
+    return kademlia::detail::to_ip_endpoint( ip, service );
 }
 
 inline kademlia::detail::peer
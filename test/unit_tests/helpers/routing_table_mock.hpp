@@ -41,6 +41,7 @@ namespace tests {
 struct routing_table_mock
 {
     using peer_type = std::pair< detail::id, detail::ip_endpoint >;
+    using value_type = peer_type;
     using peers_type = std::vector< peer_type >;
     using expected_ids_type = std::deque< detail::id >;
 
@@ -67,6 +68,19 @@ struct routing_table_mock
         return peers_.begin();
     }
 
+    void
+    find_closest
+        ( detail::id const& id
+        , std::size_t count
+        , peers_type & closest_peers )
+    {
+        auto i = find( id );
+
+        closest_peers.clear();
+        for ( auto e = end(); i != e && closest_peers.size() < count; ++ i )
+            closest_peers.push_back( *i );
+    }
+
     void
     push
         ( detail::id const& id
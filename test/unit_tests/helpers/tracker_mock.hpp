@@ -145,6 +145,25 @@ public:
         }
     }
 
+    /**
+     *
+     */
+    template< typename RequestType
+            , typename TimeoutType
+            , typename OnMessageReceiveCallback
+            , typename OnErrorCallback >
+    void
+    send_request
+        ( RequestType const& request
+        , detail::peer const& p
+        , TimeoutType const& timeout
+        , OnMessageReceiveCallback const& on_message_received
+        , OnErrorCallback const& on_error )
+    {
+        send_request( request, p.endpoint_, timeout
+                    , on_message_received, on_error );
+    }
+
     /**
      *
      */
@@ -168,6 +187,17 @@ public:
         , EndpointType const& e )
     { save_sent_message( r, e ); }
 
+    /**
+     *  Responses are received at once,
+     *  hence the timers never expire.
+     */
+    template< typename DurationType, typename Callback >
+    void
+    schedule
+        ( DurationType const&
+        , Callback const& )
+    { }
+
 private:
     struct sent_message final
     {
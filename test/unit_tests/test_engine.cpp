@@ -0,0 +1,387 @@
+// Copyright (c) 2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "helpers/common.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include <boost/asio/io_service.hpp>
+
+#include "kademlia/buffer.hpp"
+#include "kademlia/engine.hpp"
+#include "kademlia/message.hpp"
+#include "kademlia/routing_table.hpp"
+#include "kademlia/routing_table_snapshot.hpp"
+#include "simulator/fake_socket.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+namespace a = boost::asio;
+
+using engine_type = kd::engine< kd::buffer
+                              , kd::buffer
+                              , k::fake_socket
+                              , kd::routing_table< kd::ip_endpoint > >;
+
+/**
+ *  A peer handcrafted from a fake socket,
+ *  it keeps each message it receives.
+ */
+struct fake_peer
+{
+    fake_peer
+        ( a::io_service & io_service
+        , kd::id const& id )
+        : id_( id )
+        , socket_( io_service, a::ip::udp::v4() )
+        , reception_buffer_( 1500 )
+        , sender_()
+        , received_messages_()
+    {
+        socket_.bind( a::ip::udp::endpoint{ a::ip::address_v4::any()
+                                          , k::fake_socket::FIXED_PORT } );
+    }
+
+    void
+    listen
+        ( void )
+    {
+        auto on_receive = [ this ]
+            ( boost::system::error_code const& failure
+            , std::size_t size )
+        {
+            if ( failure )
+                return;
+
+            received_messages_.emplace_back( reception_buffer_.begin()
+                                           , reception_buffer_.begin() + size );
+            listen();
+        };
+
+        socket_.async_receive_from( a::buffer( reception_buffer_ )
+                                  , sender_
+                                  , on_receive );
+    }
+
+    kd::ip_endpoint
+    endpoint
+        ( void )
+        const
+    {
+        auto const e = socket_.local_endpoint();
+        return kd::to_ip_endpoint( e.address(), e.port() );
+    }
+
+    kd::id id_;
+    k::fake_socket socket_;
+    kd::buffer reception_buffer_;
+    a::ip::udp::endpoint sender_;
+    std::vector< kd::buffer > received_messages_;
+};
+
+/**
+ *
+ */
+kd::header
+get_header
+    ( kd::buffer const& message )
+{
+    kd::header h;
+    auto i = message.cbegin();
+    BOOST_REQUIRE( ! kd::deserialize( i, message.cend(), h ) );
+    return h;
+}
+
+/**
+ *  Return the id of a peer sharing
+ *  prefix_size bits with reference.
+ */
+kd::id
+create_id_at_distance
+    ( kd::id const& reference
+    , std::size_t prefix_size
+    , std::size_t index = 0 )
+{
+    kd::id id{ reference };
+    id[ prefix_size ] = ! static_cast< bool >( reference[ prefix_size ] );
+    if ( prefix_size < kd::id::BIT_SIZE - 16 )
+    {
+        id.end()[ -1 ] = static_cast< std::uint8_t >( index );
+        id.end()[ -2 ] = static_cast< std::uint8_t >( index >> 8 );
+    }
+    return id;
+}
+
+/**
+ *
+ */
+struct fixture
+{
+    fixture
+        ( void )
+        : io_service_()
+        , engine_()
+        , engine_endpoint_()
+        , peers_()
+        , messages_()
+    { }
+
+    void
+    create_engine
+        ( void )
+    {
+        engine_.reset( new engine_type
+                ( io_service_
+                , k::endpoint{ "0.0.0.0", k::fake_socket::FIXED_PORT }
+                , k::endpoint{ "::", k::fake_socket::FIXED_PORT } ) );
+        engine_endpoint_ = a::ip::udp::endpoint
+                ( k::fake_socket::get_last_allocated_ipv4()
+                , k::fake_socket::FIXED_PORT );
+    }
+
+    void
+    create_engine_with_snapshot
+        ( fake_peer const& initial_peer
+        , kd::routing_table_snapshot const& snapshot )
+    {
+        k::endpoint const initial_endpoint
+                { initial_peer.socket_.local_endpoint().address().to_string()
+                , k::fake_socket::FIXED_PORT };
+
+        engine_.reset( new engine_type
+                ( io_service_
+                , initial_endpoint
+                , k::endpoint{ "0.0.0.0", k::fake_socket::FIXED_PORT }
+                , k::endpoint{ "::", k::fake_socket::FIXED_PORT }
+                , snapshot ) );
+        engine_endpoint_ = a::ip::udp::endpoint
+                ( k::fake_socket::get_last_allocated_ipv4()
+                , k::fake_socket::FIXED_PORT );
+    }
+
+    fake_peer &
+    create_peer
+        ( kd::id const& id )
+    {
+        peers_.emplace_back( new fake_peer( io_service_, id ) );
+        return *peers_.back();
+    }
+
+    template< typename Body >
+    void
+    send
+        ( fake_peer & p
+        , kd::header::type const& type
+        , kd::id const& token
+        , Body const& body )
+    {
+        kd::buffer message;
+        kd::serialize( kd::header{ kd::header::V1, type, p.id_, token }
+                     , message );
+        kd::serialize( body, message );
+        send( p, std::move( message ) );
+    }
+
+    void
+    send
+        ( fake_peer & p
+        , kd::header::type const& type
+        , kd::id const& token = kd::id{} )
+    {
+        kd::buffer message;
+        kd::serialize( kd::header{ kd::header::V1, type, p.id_, token }
+                     , message );
+        send( p, std::move( message ) );
+    }
+
+    void
+    send
+        ( fake_peer & p
+        , kd::buffer && message )
+    {
+        // The fake socket only keeps a view of the buffer,
+        // which is read once the io_service is polled.
+        messages_.push_back( std::move( message ) );
+
+        p.socket_.async_send_to( a::buffer( messages_.back() )
+                               , engine_endpoint_
+                               , []( boost::system::error_code const&
+                                   , std::size_t ) { } );
+    }
+
+    kd::routing_table_snapshot
+    get_routing_table
+        ( void )
+    {
+        auto const path = "test_engine_routing_table.bin";
+        BOOST_REQUIRE( ! engine_->save_routing_table( path ) );
+
+        kd::routing_table_snapshot snapshot;
+        BOOST_REQUIRE( ! kd::load_routing_table_snapshot( path, snapshot ) );
+        std::remove( path );
+
+        return snapshot;
+    }
+
+    bool
+    is_in_routing_table
+        ( kd::id const& id )
+    {
+        auto const peers = get_routing_table().peers_;
+        return std::any_of( peers.begin(), peers.end()
+                          , [ &id ]( kd::peer const& p )
+                            { return p.id_ == id; } );
+    }
+
+    a::io_service io_service_;
+    std::unique_ptr< engine_type > engine_;
+    a::ip::udp::endpoint engine_endpoint_;
+    std::vector< std::unique_ptr< fake_peer > > peers_;
+    std::deque< kd::buffer > messages_;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE( test_least_recently_seen_peer )
+
+BOOST_FIXTURE_TEST_CASE( slow_but_live_peer_is_not_evicted, fixture )
+{
+    create_engine();
+
+    // Learn the engine id from its answer to a ping.
+    kd::id const probe_id{ "1" };
+    auto & probe = create_peer( probe_id );
+    probe.listen();
+    send( probe, kd::header::PING_REQUEST );
+    io_service_.poll();
+    BOOST_REQUIRE_EQUAL( 1, probe.received_messages_.size() );
+    auto const pong = get_header( probe.received_messages_.front() );
+    BOOST_REQUIRE_EQUAL( kd::header::PING_RESPONSE, pong.type_ );
+    auto const engine_id = pong.source_id_;
+
+    // All crafted peers share a k_bucket the probe isn't in.
+    std::size_t const prefix_size
+            = ( probe_id[ 0 ] == engine_id[ 0 ] ) ? 0 : 1;
+
+    // The least recently seen peer announces itself with a
+    // message that requires no answer.
+    auto & oldest = create_peer( create_id_at_distance( engine_id
+                                                      , prefix_size ) );
+    oldest.listen();
+    send( oldest, kd::header::PING_RESPONSE );
+    io_service_.poll();
+
+    // Add newcomers until the k_bucket is full
+    // and the oldest peer gets checked.
+    kd::id newcomer_id;
+    for ( std::size_t i = 1; oldest.received_messages_.empty(); ++ i )
+    {
+        BOOST_REQUIRE_LT( i, 256 );
+        auto & newcomer = create_peer( create_id_at_distance( engine_id
+                                                            , prefix_size
+                                                            , i ) );
+        newcomer_id = newcomer.id_;
+        send( newcomer, kd::header::PING_RESPONSE );
+        io_service_.poll();
+    }
+    auto const ping = get_header( oldest.received_messages_.front() );
+    BOOST_REQUIRE_EQUAL( kd::header::PING_REQUEST, ping.type_ );
+
+    // Answer well after a lookup delay, yet within the liveness delay.
+    std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+    io_service_.poll();
+    send( oldest, kd::header::PING_RESPONSE, ping.random_token_ );
+    io_service_.poll();
+
+    BOOST_REQUIRE( is_in_routing_table( oldest.id_ ) );
+    BOOST_REQUIRE( ! is_in_routing_table( newcomer_id ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( test_restart )
+
+BOOST_FIXTURE_TEST_CASE( only_empty_k_buckets_are_refreshed, fixture )
+{
+    std::default_random_engine random_engine;
+    kd::routing_table_snapshot snapshot{ kd::id{ random_engine }, {} };
+
+    // Restored peers fill every k_bucket but the farthest.
+    for ( std::size_t i = 1; i != kd::id::BIT_SIZE; ++ i )
+    {
+        auto & p = create_peer( create_id_at_distance( snapshot.my_id_, i ) );
+        p.listen();
+        snapshot.peers_.push_back( { p.id_, p.endpoint() } );
+    }
+
+    auto & initial_peer = create_peer( kd::id{ random_engine } );
+    initial_peer.listen();
+
+    create_engine_with_snapshot( initial_peer, snapshot );
+    io_service_.poll();
+
+    // The initial peer is asked for the neighbors of the restored id.
+    BOOST_REQUIRE_EQUAL( 1, initial_peer.received_messages_.size() );
+    auto const& request = initial_peer.received_messages_.front();
+    auto const request_header = get_header( request );
+    BOOST_REQUIRE_EQUAL( kd::header::FIND_PEER_REQUEST
+                       , request_header.type_ );
+    BOOST_REQUIRE_EQUAL( snapshot.my_id_, request_header.source_id_ );
+
+    send( initial_peer, kd::header::FIND_PEER_RESPONSE
+        , request_header.random_token_, kd::find_peer_response_body{} );
+    io_service_.poll();
+
+    // Only the farthest k_bucket is refreshed.
+    std::size_t requests_count = 0;
+    for ( auto const& p : peers_ )
+        if ( p->id_ != initial_peer.id_ )
+            for ( auto const& message : p->received_messages_ )
+            {
+                auto i = message.cbegin();
+                kd::header h;
+                kd::find_peer_request_body body;
+                BOOST_REQUIRE( ! kd::deserialize( i, message.cend(), h ) );
+                BOOST_REQUIRE_EQUAL( kd::header::FIND_PEER_REQUEST, h.type_ );
+                BOOST_REQUIRE( ! kd::deserialize( i, message.cend(), body ) );
+                BOOST_REQUIRE_EQUAL( 0, kd::common_prefix_length
+                        ( body.peer_to_find_id_, snapshot.my_id_ ) );
+                ++ requests_count;
+            }
+
+    BOOST_REQUIRE_GT( requests_count, 0 );
+    BOOST_REQUIRE( is_in_routing_table( snapshot.peers_.front().id_ ) );
+    BOOST_REQUIRE_EQUAL( snapshot.my_id_, get_routing_table().my_id_ );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
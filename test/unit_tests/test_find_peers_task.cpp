@@ -0,0 +1,183 @@
+// Copyright (c) 2013-2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "helpers/common.hpp"
+#include "helpers/task_fixture.hpp"
+
+#include <chrono>
+#include <sstream>
+#include <vector>
+#include <utility>
+
+#include "kademlia/id.hpp"
+#include "kademlia/peer.hpp"
+#include "kademlia/constants.hpp"
+#include "kademlia/find_peers_task.hpp"
+#include "kademlia/lookup_cache.hpp"
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+namespace {
+
+struct fixture : k::tests::task_fixture
+{
+    fixture
+        ( void )
+        : task_fixture()
+        , peers_()
+    { }
+
+    void
+    operator()
+        ( std::error_code const& f
+        , std::vector< kd::peer > const& peers )
+    {
+        ++ callback_call_count_;
+        failure_ = f;
+        peers_ = peers;
+    }
+
+    std::vector< kd::peer > peers_;
+};
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE( test_usage, fixture )
+
+BOOST_AUTO_TEST_CASE( can_notify_error_when_no_peer_responds )
+{
+    kd::id const key{ "a" };
+    routing_table_.expected_ids_.emplace_back( key );
+
+    auto p1 = create_and_add_peer( "192.168.1.1", kd::id{ "b" } );
+
+    kd::start_find_peers_task( key, tracker_, routing_table_
+                             , std::ref( *this ) );
+    io_service_.poll();
+
+    kd::find_peer_request_body const fp{ key };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, fp ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    BOOST_REQUIRE_EQUAL( 1, callback_call_count_ );
+    BOOST_REQUIRE( failure_ == k::INITIAL_PEER_FAILED_TO_RESPOND );
+    BOOST_REQUIRE( peers_.empty() );
+}
+
+BOOST_AUTO_TEST_CASE( can_return_discovered_peers )
+{
+    kd::id const key{ "a" };
+    routing_table_.expected_ids_.emplace_back( key );
+
+    // p1 is the only known peer atm.
+    auto p1 = create_and_add_peer( "192.168.1.1", kd::id{ "b" } );
+
+    // p2 is unknown atm.
+    auto p2 = create_peer( "192.168.1.2", key );
+
+    // p1 knows p2.
+    kd::find_peer_response_body const fp1{ { p2 } };
+    tracker_.add_message_to_receive( p1.endpoint_, p1.id_, fp1 );
+
+    // p2 doesn't know closer peer.
+    tracker_.add_message_to_receive( p2.endpoint_
+                                   , p2.id_
+                                   , kd::find_peer_response_body{} );
+
+    kd::start_find_peers_task( key, tracker_, routing_table_
+                             , std::ref( *this ) );
+    io_service_.poll();
+
+    kd::find_peer_request_body const fp{ key };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, fp ) );
+    BOOST_REQUIRE( tracker_.has_sent_message( p2.endpoint_, fp ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    // The closest peers come first.
+    BOOST_REQUIRE_EQUAL( 1, callback_call_count_ );
+    BOOST_REQUIRE( ! failure_ );
+    BOOST_REQUIRE_EQUAL( 2, peers_.size() );
+    BOOST_REQUIRE_EQUAL( p2, peers_[ 0 ] );
+    BOOST_REQUIRE_EQUAL( p1, peers_[ 1 ] );
+}
+
+BOOST_AUTO_TEST_CASE( can_verify_cached_peers_within_one_round_trip )
+{
+    kd::id const key{};
+    routing_table_.expected_ids_.emplace_back( key );
+
+    // A previous lookup found the k closest peers.
+    std::vector< kd::peer > cached_peers;
+    for ( std::size_t i = 1; i <= kd::ROUTING_TABLE_BUCKET_SIZE; ++ i )
+    {
+        std::ostringstream id;
+        id << std::hex << i;
+
+        std::ostringstream ip;
+        ip << "192.168.1." << i;
+
+        cached_peers.push_back( create_peer( ip.str(), kd::id{ id.str() } ) );
+    }
+
+    kd::lookup_cache cache{ 1, std::chrono::seconds{ 60 }
+                          , kd::id::BIT_PER_WORD };
+    cache.save( key, cached_peers );
+
+    // None of them knows a closer peer.
+    for ( auto const& p : cached_peers )
+        tracker_.add_message_to_receive( p.endpoint_
+                                       , p.id_
+                                       , kd::find_peer_response_body{} );
+
+    // p is known from the routing table but farther.
+    auto p = create_and_add_peer( "192.168.2.1", kd::id{ "ff" } );
+
+    kd::lookup_statistics statistics{};
+    kd::start_find_peers_task( key, tracker_, routing_table_
+                             , std::ref( *this ), &statistics, &cache );
+
+    // All cached peers are queried before any response.
+    kd::find_peer_request_body const fp{ key };
+    for ( auto const& p : cached_peers )
+        BOOST_REQUIRE( tracker_.has_sent_message( p.endpoint_, fp ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    // p is queried once fewer than alpha requests are in
+    // flight, but its response isn't waited for.
+    io_service_.poll();
+    BOOST_REQUIRE( tracker_.has_sent_message( p.endpoint_, fp ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    BOOST_REQUIRE_EQUAL( 1, callback_call_count_ );
+    BOOST_REQUIRE( ! failure_ );
+    BOOST_REQUIRE( cached_peers == peers_ );
+
+    BOOST_REQUIRE_EQUAL( 1, statistics.hops_count_ );
+    BOOST_REQUIRE_EQUAL( kd::ROUTING_TABLE_BUCKET_SIZE + 1
+                       , statistics.requests_count_ );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
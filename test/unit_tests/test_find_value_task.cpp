@@ -292,6 +292,14 @@ BOOST_AUTO_TEST_CASE( can_return_value_when_discovered_peer_has_the_value )
     BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, fv ) );
     BOOST_REQUIRE( tracker_.has_sent_message( p2.endpoint_, fv ) );
 
+    // Task cached the value on p1 which didn't have it,
+    // p2 being closer to the key.
+    kd::cache_value_request_body const cv
+            { searched_key
+            , std::uint32_t( kd::CACHED_VALUE_TTL.count() / 2 )
+            , fv2.data_ };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, cv ) );
+
     // Task didn't send any more message.
     BOOST_REQUIRE( ! tracker_.has_sent_message() );
 
@@ -302,5 +310,40 @@ BOOST_AUTO_TEST_CASE( can_return_value_when_discovered_peer_has_the_value )
                                    , data_.begin(), data_.end() );
 }
 
+BOOST_AUTO_TEST_CASE( can_ask_cached_peers_first )
+{
+    kd::id const searched_key{ "a" };
+    data_type const data{ 1, 2, 3, 4 };
+    routing_table_.expected_ids_.emplace_back( searched_key );
+
+    // p1 is unknown to the routing table but
+    // a previous lookup found it close to the key.
+    auto p1 = create_peer( "192.168.1.1", kd::id{ "b" } );
+    kd::lookup_cache cache{ 1, std::chrono::seconds{ 60 }, kd::id::BIT_PER_WORD };
+    cache.save( searched_key, { p1 } );
+
+    auto p2 = create_and_add_peer( "192.168.1.2", kd::id{ "f" } );
+
+    kd::find_value_response_body const fv1{ data };
+    tracker_.add_message_to_receive( p1.endpoint_, p1.id_, fv1 );
+
+    kd::start_find_value_task< data_type >( searched_key
+                                          , tracker_
+                                          , routing_table_
+                                          , std::ref( *this )
+                                          , nullptr
+                                          , &cache );
+    io_service_.poll();
+
+    kd::find_value_request_body const fv{ searched_key };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, fv ) );
+    BOOST_REQUIRE( tracker_.has_sent_message( p2.endpoint_, fv ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    BOOST_REQUIRE_EQUAL( 1, callback_call_count_ );
+    BOOST_REQUIRE( ! failure_ );
+    BOOST_REQUIRE( data == data_ );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,136 @@
+// Copyright (c) 2013-2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "helpers/common.hpp"
+#include "helpers/task_fixture.hpp"
+
+#include <vector>
+#include <utility>
+
+#include "kademlia/id.hpp"
+#include "kademlia/peer.hpp"
+#include "kademlia/find_values_task.hpp"
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+namespace {
+
+using data_type = std::vector< std::uint8_t >;
+
+struct fixture : k::tests::task_fixture
+{
+    fixture
+        ( void )
+        : task_fixture()
+        , failures_( 2 )
+        , datas_( 2 )
+    { }
+
+    void
+    operator()
+        ( std::size_t i
+        , std::error_code const& f
+        , data_type const& d )
+    {
+        ++ callback_call_count_;
+        failures_.at( i ) = f;
+        datas_.at( i ) = d;
+    }
+
+    std::vector< std::error_code > failures_;
+    std::vector< data_type > datas_;
+};
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE( test_usage, fixture )
+
+BOOST_AUTO_TEST_CASE( can_find_values_with_a_single_request )
+{
+    std::vector< kd::id > const ids{ kd::id{ "a" }, kd::id{ "b" } };
+    auto p1 = create_peer( "192.168.1.1", kd::id{ "c" } );
+
+    kd::find_values_response_body const fv1
+            { { { ids[ 0 ], { 1, 2 } }, { ids[ 1 ], { 3, 4 } } } };
+    tracker_.add_message_to_receive( p1.endpoint_, p1.id_, fv1 );
+
+    kd::start_find_values_task< data_type >( ids, { 0, 1 }, { p1 }
+                                           , tracker_, std::ref( *this ) );
+    io_service_.poll();
+
+    // Task asked p1 for both values.
+    kd::find_values_request_body const fv{ ids };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, fv ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    BOOST_REQUIRE_EQUAL( 2, callback_call_count_ );
+    BOOST_REQUIRE( ! failures_[ 0 ] );
+    BOOST_REQUIRE( datas_[ 0 ] == ( data_type{ 1, 2 } ) );
+    BOOST_REQUIRE( ! failures_[ 1 ] );
+    BOOST_REQUIRE( datas_[ 1 ] == ( data_type{ 3, 4 } ) );
+}
+
+BOOST_AUTO_TEST_CASE( can_ask_each_key_to_its_closest_peer )
+{
+    std::vector< kd::id > const ids{ kd::id{ "1" }, kd::id{ "6" } };
+    auto p1 = create_peer( "192.168.1.1", kd::id{ "0" } );
+    auto p2 = create_peer( "192.168.1.2", kd::id{ "7" } );
+
+    kd::start_find_values_task< data_type >( ids, { 0, 1 }, { p1, p2 }
+                                           , tracker_, std::ref( *this ) );
+    io_service_.poll();
+
+    BOOST_REQUIRE( tracker_.has_sent_message
+            ( p1.endpoint_, kd::find_values_request_body{ { ids[ 0 ] } } ) );
+    BOOST_REQUIRE( tracker_.has_sent_message
+            ( p2.endpoint_, kd::find_values_request_body{ { ids[ 1 ] } } ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    // Neither peer responded.
+    BOOST_REQUIRE_EQUAL( 2, callback_call_count_ );
+    BOOST_REQUIRE( failures_[ 0 ] == k::VALUE_NOT_FOUND );
+    BOOST_REQUIRE( failures_[ 1 ] == k::VALUE_NOT_FOUND );
+}
+
+BOOST_AUTO_TEST_CASE( can_notify_the_values_not_returned )
+{
+    std::vector< kd::id > const ids{ kd::id{ "a" }, kd::id{ "b" } };
+    auto p1 = create_peer( "192.168.1.1", kd::id{ "c" } );
+
+    kd::find_values_response_body const fv1{ { { ids[ 1 ], { 3, 4 } } } };
+    tracker_.add_message_to_receive( p1.endpoint_, p1.id_, fv1 );
+
+    kd::start_find_values_task< data_type >( ids, { 0, 1 }, { p1 }
+                                           , tracker_, std::ref( *this ) );
+    io_service_.poll();
+
+    BOOST_REQUIRE_EQUAL( 2, callback_call_count_ );
+    BOOST_REQUIRE( failures_[ 0 ] == k::VALUE_NOT_FOUND );
+    BOOST_REQUIRE( ! failures_[ 1 ] );
+    BOOST_REQUIRE( datas_[ 1 ] == ( data_type{ 3, 4 } ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
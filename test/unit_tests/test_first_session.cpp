@@ -24,6 +24,7 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <cstdint>
+#include <cstdio>
 #include <future>
 
 #include <boost/asio/ip/udp.hpp>
@@ -105,4 +106,17 @@ BOOST_AUTO_TEST_CASE( first_session_run_can_be_aborted )
     BOOST_REQUIRE( result.get() == k::RUN_ABORTED );
 }
 
+BOOST_AUTO_TEST_CASE( first_session_routing_table_can_be_saved_and_loaded )
+{
+    char const* path = "test_first_session_routing_table.bin";
+    k::first_session s;
+
+    BOOST_REQUIRE( ! s.save_routing_table( path ) );
+    BOOST_REQUIRE( ! s.load_routing_table( path ) );
+
+    std::remove( path );
+
+    BOOST_REQUIRE( s.load_routing_table( path ) );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -25,6 +25,7 @@
 
 #include "helpers/common.hpp"
 
+#include <sstream>
 #include <system_error>
 
 #include "kademlia/id.hpp"
@@ -192,6 +193,36 @@ BOOST_AUTO_TEST_CASE( hash_generated_id_are_valid )
 }
 
 
+BOOST_AUTO_TEST_CASE( hash_generated_ids_can_be_built_in_batch )
+{
+    std::vector< kd::value_to_hash_type > values( 150 );
+    for ( std::size_t i = 0; i != values.size(); ++ i )
+        values[ i ].assign( i, std::uint8_t( i ) );
+
+    std::vector< kd::id > ids( values.size() );
+    kd::hash_values( values.data(), values.size(), ids.data() );
+
+    std::vector< kd::basic_id< 256, kd::sha256_hasher > > long_ids
+            ( values.size() );
+    kd::hash_values( values.data(), values.size(), long_ids.data() );
+
+    for ( std::size_t i = 0; i != values.size(); ++ i )
+    {
+        BOOST_REQUIRE_EQUAL( kd::id{ values[ i ] }, ids[ i ] );
+        BOOST_REQUIRE_EQUAL( long_ids[ i ]
+                           , ( kd::basic_id< 256, kd::sha256_hasher >
+                                    { values[ i ] } ) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( sha1_generated_id_is_valid )
+{
+    kd::value_to_hash_type const value{ 'a', 'b', 'c' };
+
+    BOOST_REQUIRE_EQUAL( kd::id{ "a9993e364706816aba3e25717850c26c9cd0d89d" }
+                       , kd::id{ value } );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE( test_operation )
@@ -238,6 +269,63 @@ BOOST_AUTO_TEST_CASE( id_distance_can_be_evaluated )
     }
 }
 
+BOOST_AUTO_TEST_CASE( id_distances_can_be_compared )
+{
+    std::default_random_engine random_engine;
+
+    for ( std::size_t i = 0; i != 1000; ++ i )
+    {
+        kd::id const target{ random_engine };
+        kd::id const id1{ random_engine };
+        kd::id id2{ id1 };
+        id2[ random_engine() % kd::id::BIT_SIZE ] = random_engine() % 2 == 0;
+
+        BOOST_REQUIRE_EQUAL( kd::distance( id1, target ) < kd::distance( id2, target )
+                           , kd::is_closer( id1, id2, target ) );
+        BOOST_REQUIRE_EQUAL( kd::distance( id2, target ) < kd::distance( id1, target )
+                           , kd::is_closer( id2, id1, target ) );
+    }
+
+    BOOST_REQUIRE( ! kd::is_closer( kd::id{ "1" }, kd::id{ "1" }, kd::id{} ) );
+}
+
+BOOST_AUTO_TEST_CASE( id_common_prefix_length_can_be_evaluated )
+{
+    kd::id const null_id;
+    BOOST_REQUIRE_EQUAL( std::size_t{ kd::id::BIT_SIZE }
+                       , kd::common_prefix_length( null_id, null_id ) );
+
+    // Check each bit, including the ones around word boundaries.
+    for ( std::size_t i = 0; i != kd::id::BIT_SIZE; ++ i )
+    {
+        kd::id other_id;
+        other_id[ i ] = true;
+        other_id[ kd::id::BIT_SIZE - 1 ] = true;
+
+        BOOST_REQUIRE_EQUAL( i, kd::common_prefix_length( null_id, other_id ) );
+        BOOST_REQUIRE_EQUAL( i, kd::common_prefix_length( other_id, null_id ) );
+    }
+
+    // Compare against a bit by bit evaluation.
+    std::default_random_engine random_engine;
+    for ( std::size_t i = 0; i != 1000; ++ i )
+    {
+        kd::id const id1{ random_engine };
+        kd::id id2{ id1 };
+        for ( std::size_t j = random_engine() % kd::id::BIT_SIZE
+            ; j != kd::id::BIT_SIZE
+            ; ++ j )
+            id2[ j ] = random_engine() % 2 == 0;
+
+        std::size_t expected = 0;
+        while ( expected != kd::id::BIT_SIZE
+              && id1[ expected ] == id2[ expected ] )
+            ++ expected;
+
+        BOOST_REQUIRE_EQUAL( expected, kd::common_prefix_length( id1, id2 ) );
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 /**
@@ -254,5 +342,101 @@ BOOST_AUTO_TEST_CASE( id_is_printable )
     BOOST_REQUIRE( out.match_pattern() );
 }
 
+BOOST_AUTO_TEST_CASE( id_leading_zeros_are_not_printed )
+{
+    std::ostringstream out;
+    out << kd::id{ "0000102" } << ' ' << kd::id{};
+
+    BOOST_REQUIRE_EQUAL( "0102 0", out.str() );
+}
+
+BOOST_AUTO_TEST_CASE( id_can_be_written_as_hex )
+{
+    kd::id const id{ "0123456789abcdef" };
+
+    char digits[ 2 * kd::id::BLOCKS_COUNT ];
+    auto const e = kd::to_hex( id, digits );
+
+    BOOST_REQUIRE_EQUAL( std::string( 2 * kd::id::BLOCKS_COUNT - 16, '0' )
+                         + "0123456789abcdef"
+                       , std::string( digits, e ) );
+}
+
+BOOST_AUTO_TEST_CASE( id_can_be_parsed_from_hex )
+{
+    std::string const digits{ "a0B1c2D3e4F5" };
+
+    kd::id id;
+    BOOST_REQUIRE( ! kd::from_hex( digits.data()
+                                 , digits.data() + digits.size()
+                                 , id ) );
+    BOOST_REQUIRE_EQUAL( kd::id{ "a0b1c2d3e4f5" }, id );
+
+    std::string const odd_digits{ "fff" };
+    BOOST_REQUIRE( ! kd::from_hex( odd_digits.data()
+                                 , odd_digits.data() + odd_digits.size()
+                                 , id ) );
+    BOOST_REQUIRE_EQUAL( kd::id{ "0fff" }, id );
+
+    std::string const invalid_digits{ "12g4" };
+    BOOST_REQUIRE( kd::from_hex( invalid_digits.data()
+                               , invalid_digits.data()
+                                 + invalid_digits.size()
+                               , id ) );
+    BOOST_REQUIRE_EQUAL( kd::id{ "fff" }, id );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
+/**
+ *  Test basic_id sizes
+ */
+BOOST_AUTO_TEST_SUITE( test_size )
+
+using id_64 = kd::basic_id< 64, kd::sha1_hasher >;
+using id_256 = kd::basic_id< 256, kd::sha256_hasher >;
+
+BOOST_AUTO_TEST_CASE( id_size_is_computed_at_compile_time )
+{
+    static_assert( id_64::BLOCKS_COUNT == 8, "" );
+    static_assert( id_64::WORDS_COUNT == 1, "" );
+    static_assert( kd::id::BLOCKS_COUNT == kd::id::BIT_SIZE / 8, "" );
+    static_assert( id_256::BLOCKS_COUNT == 32, "" );
+    static_assert( id_256::WORDS_COUNT == 4, "" );
+
+    id_256 const id;
+    BOOST_REQUIRE_EQUAL( 32, std::distance( id.begin(), id.end() ) );
+}
+
+BOOST_AUTO_TEST_CASE( hash_is_truncated_to_id_size )
+{
+    kd::value_to_hash_type const value_to_hash{ 1, 2, 3, 4 };
+
+    id_64 const short_id{ value_to_hash };
+    kd::basic_id< 160, kd::sha1_hasher > const long_id{ value_to_hash };
+
+    BOOST_REQUIRE( std::equal( short_id.begin(), short_id.end()
+                             , long_id.begin() ) );
+}
+
+BOOST_AUTO_TEST_CASE( large_id_operations_use_every_bit )
+{
+    id_256 const id1{ "1" };
+    id_256 id2{ "3" };
+
+    BOOST_REQUIRE( id1 < id2 );
+    BOOST_REQUIRE_EQUAL( 254, kd::common_prefix_length( id1, id2 ) );
+    BOOST_REQUIRE_EQUAL( id_256{ "2" }, kd::distance( id1, id2 ) );
+    BOOST_REQUIRE( kd::is_closer( id1, id2, id_256{} ) );
+
+    id2 = id1;
+    BOOST_REQUIRE_EQUAL( 256, kd::common_prefix_length( id1, id2 ) );
+}
+
+BOOST_AUTO_TEST_CASE( small_id_can_be_parsed )
+{
+    BOOST_REQUIRE_NO_THROW( id_64{ "0123456789abcdef" } );
+    BOOST_REQUIRE_THROW( id_64{ "0123456789abcdef0" }, std::system_error );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -70,6 +70,42 @@ BOOST_AUTO_TEST_CASE( can_be_compared)
 
         BOOST_REQUIRE_NE( a, b );
     }
+
+    {
+        auto a = kd::to_ip_endpoint( "::", 1234 );
+        auto b = kd::to_ip_endpoint( "0.0.0.0", 1234 );
+
+        BOOST_REQUIRE_NE( a, b );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( can_be_converted_to_address )
+{
+    for ( auto const ip : { "192.168.0.1", "::1", "fc00::1:2" } )
+    {
+        auto const a = ba::ip::address::from_string( ip );
+        auto const e = kd::to_ip_endpoint( a, 1234 );
+
+        BOOST_REQUIRE_EQUAL( a.is_v4(), kd::is_ipv4( e ) );
+        BOOST_REQUIRE_EQUAL( a.is_v6(), kd::is_ipv6( e ) );
+        BOOST_REQUIRE_EQUAL( a, kd::to_address( e ) );
+        BOOST_REQUIRE_EQUAL( 1234, e.port_ );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( link_local_address_keeps_its_scope )
+{
+    ba::ip::address_v6 a = ba::ip::address_v6::from_string( "fe80::1" );
+    a.scope_id( 3 );
+
+    auto const e = kd::to_ip_endpoint( a, 1234 );
+    BOOST_REQUIRE_EQUAL( 3, e.scope_id_ );
+    BOOST_REQUIRE_EQUAL( ba::ip::address{ a }, kd::to_address( e ) );
+    BOOST_REQUIRE_EQUAL( 3, kd::to_address( e ).to_v6().scope_id() );
+
+    // The same address on another interface is another endpoint.
+    a.scope_id( 4 );
+    BOOST_REQUIRE_NE( e, kd::to_ip_endpoint( a, 1234 ) );
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,222 @@
+// Copyright (c) 2013-2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "helpers/common.hpp"
+#include "helpers/peer_factory.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kademlia/key_batch.hpp"
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+BOOST_AUTO_TEST_SUITE( test_usage )
+
+BOOST_AUTO_TEST_CASE( ids_sharing_a_prefix_are_grouped )
+{
+    std::vector< kd::id > const ids
+            { kd::id{ "f1" }
+            , kd::id{ "01" }
+            , kd::id{ "f0" }
+            , kd::id{ "10" }
+            , kd::id{ "00" } };
+
+    // Ids sharing all their bits but the last 4.
+    auto const groups = kd::group_by_prefix( ids, { 0, 1, 2, 3, 4 }
+                                           , kd::id::BIT_SIZE - 4 );
+
+    BOOST_REQUIRE_EQUAL( 3, groups.size() );
+    BOOST_REQUIRE( groups[ 0 ] == ( kd::key_indexes_type{ 4, 1 } ) );
+    BOOST_REQUIRE( groups[ 1 ] == ( kd::key_indexes_type{ 3 } ) );
+    BOOST_REQUIRE( groups[ 2 ] == ( kd::key_indexes_type{ 2, 0 } ) );
+
+    // Only the given indexes are grouped.
+    auto const subset = kd::group_by_prefix( ids, { 0, 3 }, 0 );
+    BOOST_REQUIRE_EQUAL( 1, subset.size() );
+    BOOST_REQUIRE( subset[ 0 ] == ( kd::key_indexes_type{ 3, 0 } ) );
+}
+
+BOOST_AUTO_TEST_CASE( group_peers_are_checked_against_each_key )
+{
+    // The k closest peers of the group key share
+    // its first 152 bits, its 8 last ones being 0.
+    kd::id const group_key{ "100" };
+    std::vector< kd::peer > peers;
+    for ( std::size_t i = 0; i != kd::ROUTING_TABLE_BUCKET_SIZE; ++ i )
+        peers.push_back( create_peer( kd::id{ std::to_string( 101 + i ) } ) );
+
+    // A key within the group peers range.
+    BOOST_REQUIRE( kd::are_closest_peers_of( kd::id{ "10f" }, group_key
+                                           , peers, 3 ) );
+    // A key sharing the prefix of the group whose
+    // closest peers may not have been found.
+    BOOST_REQUIRE( ! kd::are_closest_peers_of( kd::id{ "1f0" }, group_key
+                                             , peers, 3 ) );
+    // A key farther from the group key than the group peers.
+    BOOST_REQUIRE( ! kd::are_closest_peers_of( kd::id{ "200" }, group_key
+                                             , peers, 3 ) );
+
+    // Fewer than k peers are all the reachable peers.
+    peers.pop_back();
+    BOOST_REQUIRE( kd::are_closest_peers_of( kd::id{ "200" }, group_key
+                                           , peers, 3 ) );
+}
+
+BOOST_AUTO_TEST_CASE( group_prefix_follows_the_network_depth )
+{
+    using known_peer = std::pair< kd::id, kd::ip_endpoint >;
+    std::vector< known_peer > known_peers;
+    kd::id const my_id{};
+
+    // Small networks use the least prefix.
+    BOOST_REQUIRE_EQUAL( kd::BATCH_KEY_PREFIX_BIT_SIZE
+                       , kd::get_group_prefix_bit_size( my_id
+                                                      , known_peers.begin()
+                                                      , known_peers.end() ) );
+
+    // The k closest peers share 30 bits with our id.
+    for ( std::size_t i = 0; i != kd::ROUTING_TABLE_BUCKET_SIZE; ++ i )
+    {
+        kd::id peer_id{ std::to_string( 1 + i ) };
+        peer_id[ 30 ] = true;
+        known_peers.emplace_back( peer_id, create_endpoint() );
+    }
+    // Farther peers don't matter.
+    known_peers.emplace_back( kd::id{ "8" + std::string( 39, '0' ) }
+                            , create_endpoint() );
+
+    BOOST_REQUIRE_EQUAL( 30 + 2
+                       , kd::get_group_prefix_bit_size( my_id
+                                                      , known_peers.begin()
+                                                      , known_peers.end() ) );
+}
+
+BOOST_AUTO_TEST_CASE( group_prefix_keeps_group_peers_in_large_networks )
+{
+    // A network larger than k * 2^BATCH_KEY_PREFIX_BIT_SIZE.
+    using known_peer = std::pair< kd::id, kd::ip_endpoint >;
+    std::default_random_engine random_engine;
+    std::vector< known_peer > network;
+    for ( std::size_t i = 0; i != 1 << 15; ++ i )
+        network.emplace_back( kd::id{ random_engine }, create_endpoint() );
+
+    kd::id const my_id{ random_engine };
+    auto const prefix_bit_size = kd::get_group_prefix_bit_size
+            ( my_id, network.begin(), network.end() );
+
+    // Return a key sharing prefix_size bits with group_key.
+    auto create_key = [ &random_engine ]
+        ( kd::id const& group_key, std::size_t prefix_size )
+    {
+        kd::id key{ random_engine };
+        for ( std::size_t i = 0; i != prefix_size; ++ i )
+            key[ i ] = static_cast< bool >( group_key[ i ] );
+        return key;
+    };
+
+    std::size_t const groups_count = 100;
+    std::size_t served_count = 0;
+    std::size_t least_prefix_served_count = 0;
+    for ( std::size_t i = 0; i != groups_count; ++ i )
+    {
+        // The k closest peers found by the group lookup.
+        kd::id const group_key{ random_engine };
+        auto const middle = std::next( network.begin()
+                                     , kd::ROUTING_TABLE_BUCKET_SIZE );
+        std::nth_element( network.begin(), middle, network.end()
+                        , [ &group_key ]( known_peer const& a
+                                        , known_peer const& b )
+                          { return kd::is_closer( a.first, b.first
+                                                , group_key ); } );
+        std::vector< kd::peer > peers;
+        for ( auto p = network.begin(); p != middle; ++ p )
+            peers.push_back( create_peer( p->first, p->second ) );
+
+        if ( kd::are_closest_peers_of( create_key( group_key, prefix_bit_size )
+                                     , group_key, peers, 3 ) )
+            ++ served_count;
+
+        if ( kd::are_closest_peers_of( create_key( group_key
+                                                 , kd::BATCH_KEY_PREFIX_BIT_SIZE )
+                                     , group_key, peers, 3 ) )
+            ++ least_prefix_served_count;
+    }
+
+    // The least prefix would cost a per key lookup
+    // after the group one for most keys.
+    BOOST_REQUIRE_GT( prefix_bit_size, kd::BATCH_KEY_PREFIX_BIT_SIZE );
+    BOOST_REQUIRE_GE( served_count, groups_count * 9 / 10 );
+    BOOST_REQUIRE_LE( least_prefix_served_count, groups_count / 4 );
+}
+
+BOOST_AUTO_TEST_CASE( keys_are_assigned_to_their_closest_peers )
+{
+    std::vector< kd::id > const ids{ kd::id{ "1" }, kd::id{ "6" } };
+    std::vector< kd::peer > const peers
+            { create_peer( kd::id{ "0" } )
+            , create_peer( kd::id{ "4" } )
+            , create_peer( kd::id{ "7" } ) };
+
+    auto const closest = kd::assign_to_closest_peers( ids, { 0, 1 }
+                                                    , peers, 1 );
+    BOOST_REQUIRE_EQUAL( 3, closest.size() );
+    BOOST_REQUIRE( closest[ 0 ] == ( kd::key_indexes_type{ 0 } ) );
+    BOOST_REQUIRE( closest[ 1 ].empty() );
+    BOOST_REQUIRE( closest[ 2 ] == ( kd::key_indexes_type{ 1 } ) );
+
+    // Asking for more peers than known selects them all.
+    auto const all = kd::assign_to_closest_peers( ids, { 0, 1 }
+                                                , peers, 5 );
+    for ( auto const& a : all )
+        BOOST_REQUIRE( a == ( kd::key_indexes_type{ 0, 1 } ) );
+}
+
+BOOST_AUTO_TEST_CASE( messages_are_split_by_size )
+{
+    std::vector< kd::id > const keys( 10 );
+
+    auto const max_size = kd::get_batch_message_overhead()
+                        + 4 * kd::get_serialized_size( kd::id{} );
+
+    auto const messages = kd::split_into_messages( keys, max_size );
+    BOOST_REQUIRE_EQUAL( 3, messages.size() );
+    BOOST_REQUIRE_EQUAL( 4, messages[ 0 ].size() );
+    BOOST_REQUIRE_EQUAL( 4, messages[ 1 ].size() );
+    BOOST_REQUIRE_EQUAL( 2, messages[ 2 ].size() );
+
+    // Too large entries are sent alone.
+    auto const alone = kd::split_into_messages( keys, 0 );
+    BOOST_REQUIRE_EQUAL( 10, alone.size() );
+
+    BOOST_REQUIRE( kd::split_into_messages( std::vector< kd::id >{}
+                                          , max_size ).empty() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
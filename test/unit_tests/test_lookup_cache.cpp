@@ -0,0 +1,128 @@
+// Copyright (c) 2013-2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "helpers/common.hpp"
+#include "helpers/peer_factory.hpp"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "kademlia/lookup_cache.hpp"
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+namespace {
+
+// Keys sharing their first 4 hexadecimal digits.
+std::size_t const PREFIX_BIT_SIZE = 16;
+
+kd::id
+create_key
+    ( std::string const& leading_digits )
+{
+    auto const digits_count = kd::id::BIT_SIZE / 4;
+    return kd::id{ leading_digits
+                 + std::string( digits_count - leading_digits.size()
+                              , '0' ) };
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE( test_usage )
+
+BOOST_AUTO_TEST_CASE( can_find_peers_saved_for_a_key_sharing_the_prefix )
+{
+    kd::lookup_cache cache{ 2, std::chrono::seconds{ 60 }, PREFIX_BIT_SIZE };
+
+    std::vector< kd::peer > peers;
+    BOOST_REQUIRE( ! cache.find( create_key( "1a2b01" ), peers ) );
+
+    auto const p1 = create_peer( kd::id{ "1a1" } );
+    cache.save( create_key( "1a2b01" ), { p1 } );
+    BOOST_REQUIRE_EQUAL( 1, cache.size() );
+
+    BOOST_REQUIRE( cache.find( create_key( "1a2bff" ), peers ) );
+    BOOST_REQUIRE_EQUAL( 1, peers.size() );
+    BOOST_REQUIRE_EQUAL( p1, peers[ 0 ] );
+
+    BOOST_REQUIRE( ! cache.find( create_key( "1a3b01" ), peers ) );
+}
+
+BOOST_AUTO_TEST_CASE( can_replace_the_peers_of_a_prefix )
+{
+    kd::lookup_cache cache{ 2, std::chrono::seconds{ 60 }, PREFIX_BIT_SIZE };
+
+    auto const p1 = create_peer( kd::id{ "1a1" } );
+    auto const p2 = create_peer( kd::id{ "1a2" } );
+    cache.save( create_key( "1a2b00" ), { p1 } );
+    cache.save( create_key( "1a2b03" ), { p2 } );
+    BOOST_REQUIRE_EQUAL( 1, cache.size() );
+
+    std::vector< kd::peer > peers;
+    BOOST_REQUIRE( cache.find( create_key( "1a2b00" ), peers ) );
+    BOOST_REQUIRE_EQUAL( 1, peers.size() );
+    BOOST_REQUIRE_EQUAL( p2, peers[ 0 ] );
+
+    // Lookups which found no peer are ignored.
+    cache.save( create_key( "1a2b03" ), {} );
+    BOOST_REQUIRE( cache.find( create_key( "1a2b00" ), peers ) );
+    BOOST_REQUIRE_EQUAL( p2, peers[ 0 ] );
+}
+
+BOOST_AUTO_TEST_CASE( can_drop_the_least_recently_used_prefix )
+{
+    kd::lookup_cache cache{ 2, std::chrono::seconds{ 60 }, PREFIX_BIT_SIZE };
+
+    auto const p = create_peer( kd::id{ "1" } );
+    cache.save( create_key( "1000" ), { p } );
+    cache.save( create_key( "2000" ), { p } );
+
+    // 1000 is now more recently used than 2000.
+    std::vector< kd::peer > peers;
+    BOOST_REQUIRE( cache.find( create_key( "1000" ), peers ) );
+
+    cache.save( create_key( "3000" ), { p } );
+    BOOST_REQUIRE_EQUAL( 2, cache.size() );
+
+    BOOST_REQUIRE( cache.find( create_key( "1000" ), peers ) );
+    BOOST_REQUIRE( ! cache.find( create_key( "2000" ), peers ) );
+    BOOST_REQUIRE( cache.find( create_key( "3000" ), peers ) );
+}
+
+BOOST_AUTO_TEST_CASE( can_expire_old_peers )
+{
+    kd::lookup_cache cache{ 2, std::chrono::seconds{ 0 }, PREFIX_BIT_SIZE };
+
+    cache.save( create_key( "1000" ), { create_peer( kd::id{ "1" } ) } );
+    BOOST_REQUIRE_EQUAL( 1, cache.size() );
+
+    std::vector< kd::peer > peers;
+    BOOST_REQUIRE( ! cache.find( create_key( "1000" ), peers ) );
+    BOOST_REQUIRE_EQUAL( 0, cache.size() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
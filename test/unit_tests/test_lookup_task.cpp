@@ -0,0 +1,291 @@
+// Copyright (c) 2013-2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "helpers/common.hpp"
+#include "helpers/peer_factory.hpp"
+
+#include <vector>
+
+#include "kademlia/constants.hpp"
+#include "kademlia/lookup_task.hpp"
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+namespace {
+
+struct task : kd::lookup_task
+{
+    explicit
+    task
+        ( kd::id const& key )
+        : lookup_task( key, no_peers_.end(), no_peers_.end() )
+    { }
+
+    static std::vector< std::pair< kd::id, kd::ip_endpoint > > const
+            no_peers_;
+};
+
+std::vector< std::pair< kd::id, kd::ip_endpoint > > const task::no_peers_{};
+
+std::vector< kd::peer >
+create_peers
+    ( std::size_t first
+    , std::size_t last )
+{
+    std::vector< kd::peer > peers;
+    for ( ; first != last; ++ first )
+        peers.push_back( create_peer( kd::id{ std::to_string( first ) } ) );
+
+    return peers;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE( test_usage )
+
+BOOST_AUTO_TEST_CASE( closest_candidates_are_selected_first )
+{
+    task t{ kd::id{} };
+    t.add_candidates( create_peers( 1, 10 ) );
+
+    auto const candidates = t.select_new_closest_candidates( 3 );
+    BOOST_REQUIRE_EQUAL( 3, candidates.size() );
+    BOOST_REQUIRE_EQUAL( kd::id{ "1" }, candidates[ 0 ].id_ );
+    BOOST_REQUIRE_EQUAL( kd::id{ "2" }, candidates[ 1 ].id_ );
+    BOOST_REQUIRE_EQUAL( kd::id{ "3" }, candidates[ 2 ].id_ );
+
+    // No more requests can be in flight.
+    BOOST_REQUIRE( t.select_new_closest_candidates( 3 ).empty() );
+    BOOST_REQUIRE( ! t.have_all_requests_completed() );
+
+    t.flag_candidate_as_valid( kd::id{ "2" } );
+    t.flag_candidate_as_invalid( kd::id{ "1" } );
+
+    // A closer candidate is selected before the following ones.
+    t.add_candidates( std::vector< kd::peer >{ create_peer( kd::id{ "0" } )
+                                             , create_peer( kd::id{ "2" } ) } );
+    auto const next_candidates = t.select_new_closest_candidates( 3 );
+    BOOST_REQUIRE_EQUAL( 2, next_candidates.size() );
+    BOOST_REQUIRE_EQUAL( kd::id{ "0" }, next_candidates[ 0 ].id_ );
+    BOOST_REQUIRE_EQUAL( kd::id{ "4" }, next_candidates[ 1 ].id_ );
+
+    auto const valid_candidates = t.select_closest_valid_candidates( 3 );
+    BOOST_REQUIRE_EQUAL( 1, valid_candidates.size() );
+    BOOST_REQUIRE_EQUAL( kd::id{ "2" }, valid_candidates[ 0 ].id_ );
+}
+
+BOOST_AUTO_TEST_CASE( requests_complete_when_flagged )
+{
+    task t{ kd::id{} };
+    t.add_candidates( create_peers( 1, 3 ) );
+
+    BOOST_REQUIRE_EQUAL( 2, t.select_new_closest_candidates( 3 ).size() );
+
+    t.flag_candidate_as_valid( kd::id{ "1" } );
+    // Unknown and already flagged candidates are ignored.
+    t.flag_candidate_as_valid( kd::id{ "1" } );
+    t.flag_candidate_as_valid( kd::id{ "5" } );
+    BOOST_REQUIRE( ! t.have_all_requests_completed() );
+
+    t.flag_candidate_as_invalid( kd::id{ "2" } );
+    BOOST_REQUIRE( t.have_all_requests_completed() );
+}
+
+BOOST_AUTO_TEST_CASE( far_candidates_are_dropped )
+{
+    auto const max_count = kd::ROUTING_TABLE_BUCKET_SIZE
+                         * ( 1 + kd::CONCURRENT_FIND_PEER_REQUESTS_COUNT );
+
+    task t{ kd::id{} };
+    t.add_candidates( create_peers( 1, max_count + 1 ) );
+
+    // Contact the farthest candidates.
+    t.add_candidates( create_peers( max_count + 1, 2 * max_count + 1 ) );
+    auto contacted = t.select_new_closest_candidates( max_count );
+    BOOST_REQUIRE_EQUAL( max_count, contacted.size() );
+    BOOST_REQUIRE_EQUAL( kd::id{ std::to_string( max_count ) }
+                       , contacted.back().id_ );
+
+    // Closer candidates evict the contacted ones,
+    // whose responses are no longer waited for.
+    t.add_candidates( create_peers( 0, 1 ) );
+    contacted = t.select_new_closest_candidates( max_count );
+    BOOST_REQUIRE_EQUAL( 1, contacted.size() );
+    t.flag_candidate_as_valid( kd::id{ std::to_string( max_count ) } );
+
+    for ( std::size_t i = 1; i != max_count; ++ i )
+        t.flag_candidate_as_valid( kd::id{ std::to_string( i ) } );
+    t.flag_candidate_as_valid( kd::id{ "0" } );
+
+    BOOST_REQUIRE( t.have_all_requests_completed() );
+    BOOST_REQUIRE_EQUAL( 3, t.select_closest_valid_candidates( 3 ).size() );
+}
+
+BOOST_AUTO_TEST_CASE( closest_candidates_response_ends_lookup )
+{
+    task t{ kd::id{} };
+    t.add_candidates( create_peers( 1, 10 ) );
+
+    BOOST_REQUIRE_EQUAL( 4, t.select_new_closest_candidates( 4 ).size() );
+    t.flag_candidate_as_valid( kd::id{ "1" } );
+    t.flag_candidate_as_invalid( kd::id{ "2" } );
+    t.flag_candidate_as_valid( kd::id{ "4" } );
+
+    // "3" is still pending.
+    BOOST_REQUIRE( ! t.have_closest_candidates_responded( 2 ) );
+    BOOST_REQUIRE( t.have_closest_candidates_responded( 1 ) );
+
+    t.flag_candidate_as_valid( kd::id{ "3" } );
+    BOOST_REQUIRE( t.have_closest_candidates_responded( 3 ) );
+    BOOST_REQUIRE( ! t.have_closest_candidates_responded( 4 ) );
+
+    // A closer unknown candidate must be contacted first.
+    t.add_candidates( create_peers( 0, 1 ) );
+    BOOST_REQUIRE( ! t.have_closest_candidates_responded( 1 ) );
+
+    BOOST_REQUIRE_EQUAL( 1, t.select_new_closest_candidates( 1 ).size() );
+    t.flag_candidate_as_valid( kd::id{ "0" } );
+    BOOST_REQUIRE( t.have_closest_candidates_responded( 4 ) );
+    BOOST_REQUIRE( ! t.have_closest_candidates_responded( 5 ) );
+}
+
+BOOST_AUTO_TEST_CASE( hops_and_requests_are_counted )
+{
+    task t{ kd::id{} };
+    t.add_candidates( create_peers( 10, 12 ) );
+    BOOST_REQUIRE_EQUAL( 0, t.get_hops_count() );
+
+    BOOST_REQUIRE_EQUAL( 2, t.select_new_closest_candidates( 3 ).size() );
+    t.flag_candidate_as_valid( kd::id{ "10" } );
+    t.flag_candidate_as_valid( kd::id{ "11" } );
+    BOOST_REQUIRE_EQUAL( 1, t.get_hops_count() );
+
+    // Peers returned by "11" are one hop farther.
+    t.add_candidates( create_peers( 5, 7 ), kd::id{ "11" } );
+    BOOST_REQUIRE_EQUAL( 2, t.select_new_closest_candidates( 3 ).size() );
+    t.flag_candidate_as_valid( kd::id{ "5" } );
+
+    // Peers returned by "5" are one hop farther.
+    t.add_candidates( create_peers( 1, 2 ), kd::id{ "5" } );
+    BOOST_REQUIRE_EQUAL( 1, t.select_new_closest_candidates( 3 ).size() );
+    t.flag_candidate_as_valid( kd::id{ "1" } );
+    t.flag_candidate_as_invalid( kd::id{ "6" } );
+    BOOST_REQUIRE_EQUAL( 3, t.get_hops_count() );
+    BOOST_REQUIRE_EQUAL( 5, t.get_requests_count() );
+}
+
+BOOST_AUTO_TEST_CASE( closest_valid_candidate_can_be_selected )
+{
+    task t{ kd::id{} };
+    t.add_candidates( create_peers( 1, 10 ) );
+    t.select_new_closest_candidates( 3 );
+
+    kd::peer selected;
+    std::size_t closer_count;
+    BOOST_REQUIRE( ! t.select_closest_valid_candidate( kd::id{ "1" }
+                                                     , selected
+                                                     , closer_count ) );
+
+    t.flag_candidate_as_valid( kd::id{ "1" } );
+    t.flag_candidate_as_invalid( kd::id{ "2" } );
+    t.flag_candidate_as_valid( kd::id{ "3" } );
+
+    BOOST_REQUIRE( t.select_closest_valid_candidate( kd::id{ "1" }
+                                                   , selected
+                                                   , closer_count ) );
+    BOOST_REQUIRE_EQUAL( kd::id{ "3" }, selected.id_ );
+    BOOST_REQUIRE_EQUAL( 2, closer_count );
+}
+
+BOOST_AUTO_TEST_CASE( stalled_requests_free_their_slot )
+{
+    task t{ kd::id{} };
+    t.add_candidates( create_peers( 1, 10 ) );
+
+    BOOST_REQUIRE_EQUAL( 1, t.select_new_closest_candidates( 1 ).size() );
+    BOOST_REQUIRE( t.select_new_closest_candidates( 1 ).empty() );
+
+    // Only contacted candidates can stall.
+    BOOST_REQUIRE( ! t.flag_candidate_as_stalled( kd::id{ "2" } ) );
+    BOOST_REQUIRE( t.flag_candidate_as_stalled( kd::id{ "1" } ) );
+    BOOST_REQUIRE( ! t.flag_candidate_as_stalled( kd::id{ "1" } ) );
+
+    auto const hedged = t.select_new_closest_candidates( 1 );
+    BOOST_REQUIRE_EQUAL( 1, hedged.size() );
+    BOOST_REQUIRE_EQUAL( kd::id{ "2" }, hedged[ 0 ].id_ );
+
+    // The stalled candidate is still waited for.
+    t.flag_candidate_as_valid( kd::id{ "2" } );
+    BOOST_REQUIRE( ! t.have_all_requests_completed() );
+    BOOST_REQUIRE( ! t.have_closest_candidates_responded( 1 ) );
+
+    // And its late response is accepted.
+    t.flag_candidate_as_valid( kd::id{ "1" } );
+    BOOST_REQUIRE( t.have_all_requests_completed() );
+    BOOST_REQUIRE( t.have_closest_candidates_responded( 2 ) );
+}
+
+BOOST_AUTO_TEST_CASE( stalled_requests_count_is_bounded )
+{
+    auto const max_count = kd::CONCURRENT_FIND_PEER_REQUESTS_COUNT;
+
+    task t{ kd::id{} };
+    t.add_candidates( create_peers( 1, 3 * max_count + 1 ) );
+
+    for ( std::size_t i = 1; i <= max_count; ++ i )
+    {
+        BOOST_REQUIRE_EQUAL( 1, t.select_new_closest_candidates( 1 ).size() );
+        BOOST_REQUIRE( t.flag_candidate_as_stalled
+                ( kd::id{ std::to_string( i ) } ) );
+    }
+
+    BOOST_REQUIRE_EQUAL( 1, t.select_new_closest_candidates( 1 ).size() );
+    BOOST_REQUIRE( ! t.flag_candidate_as_stalled
+            ( kd::id{ std::to_string( max_count + 1 ) } ) );
+
+    // Timeouts of stalled requests make room.
+    t.flag_candidate_as_invalid( kd::id{ "1" } );
+    BOOST_REQUIRE( t.flag_candidate_as_stalled
+            ( kd::id{ std::to_string( max_count + 1 ) } ) );
+}
+
+BOOST_AUTO_TEST_CASE( soft_timeout_follows_response_times )
+{
+    task t{ kd::id{} };
+    BOOST_REQUIRE( t.get_soft_timeout() == kd::PEER_LOOKUP_TIMEOUT / 2 );
+
+    // Fast responses.
+    for ( auto i = 0; i != 8; ++ i )
+        t.record_response_time( std::chrono::microseconds{ 1 } );
+    BOOST_REQUIRE( t.get_soft_timeout() == kd::PEER_LOOKUP_TIMEOUT / 8 );
+
+    // Slow ones.
+    for ( auto i = 0; i != 8; ++ i )
+        t.record_response_time( kd::PEER_LOOKUP_TIMEOUT );
+    BOOST_REQUIRE( t.get_soft_timeout() == kd::PEER_LOOKUP_TIMEOUT / 2 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
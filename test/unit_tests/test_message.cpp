@@ -165,8 +165,8 @@ BOOST_AUTO_TEST_CASE( can_serialize_find_peer_response_body )
 
         kd::peer new_peer =
             { kd::id{ random_engine }
-            , { boost::asio::ip::address::from_string( IPS[ i % 2 ] )
-              , std::uint16_t( 1024 + i ) } };
+            , kd::to_ip_endpoint( IPS[ i % 2 ]
+                                , std::uint16_t( 1024 + i ) ) };
 
         body_out.peers_.push_back( std::move( new_peer ) );
     }
@@ -201,8 +201,8 @@ BOOST_AUTO_TEST_CASE( can_detect_corrupted_find_peer_response_body )
 
         kd::peer new_peer =
             { kd::id{ random_engine }
-            , { boost::asio::ip::address::from_string( IPS[ i % 2 ] )
-              , std::uint16_t( 1024 + i ) } };
+            , kd::to_ip_endpoint( IPS[ i % 2 ]
+                                , std::uint16_t( 1024 + i ) ) };
 
         body_out.peers_.push_back( std::move( new_peer ) );
     }
@@ -354,5 +354,200 @@ BOOST_AUTO_TEST_CASE( can_detect_corrupted_store_value_request_body )
     }
 }
 
+BOOST_AUTO_TEST_CASE( can_read_store_value_request_body_in_place )
+{
+    std::default_random_engine random_engine;
+
+    kd::store_value_request_body body_out
+            { kd::id{ random_engine }
+            , std::vector< std::uint8_t >( 4096 ) };
+
+    std::generate( body_out.data_value_.begin()
+                 , body_out.data_value_.end()
+                 , std::rand );
+
+    kd::buffer buffer;
+    kd::serialize( body_out, buffer );
+
+    kd::store_value_request_view body_in;
+    auto i = buffer.cbegin(), e = buffer.cend();
+    BOOST_REQUIRE( ! kd::deserialize( i, e, body_in ) );
+    BOOST_REQUIRE( i == e );
+
+    BOOST_REQUIRE( body_out.data_key_hash_ == body_in.data_key_hash_ );
+
+    // The value refers to the end of the buffer.
+    BOOST_REQUIRE_EQUAL( 4096, body_in.data_value_.size() );
+    BOOST_REQUIRE( body_in.data_value_.end() == buffer.cend() );
+    BOOST_REQUIRE_EQUAL_COLLECTIONS( body_out.data_value_.begin()
+                                   , body_out.data_value_.end()
+                                   , body_in.data_value_.begin()
+                                   , body_in.data_value_.end() );
+
+    auto b = buffer.cbegin();
+    while ( b != e )
+    {
+        auto i = b;
+        BOOST_REQUIRE( kd::deserialize( i, --e, body_in ) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( can_read_find_value_response_body_in_place )
+{
+    kd::find_value_response_body body_out
+            { std::vector< std::uint8_t >( 4096 ) };
+
+    std::generate( body_out.data_.begin()
+                 , body_out.data_.end()
+                 , std::rand );
+
+    kd::buffer buffer;
+    kd::serialize( body_out, buffer );
+
+    kd::find_value_response_view body_in;
+    auto i = buffer.cbegin(), e = buffer.cend();
+    BOOST_REQUIRE( ! kd::deserialize( i, e, body_in ) );
+    BOOST_REQUIRE( i == e );
+
+    BOOST_REQUIRE_EQUAL_COLLECTIONS( body_out.data_.begin()
+                                   , body_out.data_.end()
+                                   , body_in.data_.begin()
+                                   , body_in.data_.end() );
+
+    auto b = buffer.cbegin();
+    while ( b != e )
+    {
+        auto i = b;
+        BOOST_REQUIRE( kd::deserialize( i, --e, body_in ) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( can_serialize_cache_value_request_body )
+{
+    std::default_random_engine random_engine;
+
+    kd::cache_value_request_body body_out
+            { kd::id{ random_engine }
+            , 3600
+            , std::vector< std::uint8_t >( 4096 ) };
+
+    std::generate( body_out.data_value_.begin()
+                 , body_out.data_value_.end()
+                 , std::rand );
+
+    kd::buffer buffer;
+    kd::serialize( body_out, buffer );
+
+    kd::cache_value_request_body body_in;
+    auto i = buffer.cbegin(), e = buffer.cend();
+    BOOST_REQUIRE( ! kd::deserialize( i, e, body_in ) );
+    BOOST_REQUIRE( i == e );
+
+    BOOST_REQUIRE_EQUAL_COLLECTIONS( body_out.data_key_hash_.begin()
+                                   , body_out.data_key_hash_.end()
+                                   , body_in.data_key_hash_.begin()
+                                   , body_in.data_key_hash_.end() );
+
+    BOOST_REQUIRE_EQUAL( body_out.ttl_, body_in.ttl_ );
+
+    BOOST_REQUIRE_EQUAL_COLLECTIONS( body_out.data_value_.begin()
+                                   , body_out.data_value_.end()
+                                   , body_in.data_value_.begin()
+                                   , body_in.data_value_.end() );
+}
+
+BOOST_AUTO_TEST_CASE( can_detect_corrupted_cache_value_request_body )
+{
+    std::default_random_engine random_engine;
+
+    kd::cache_value_request_body body_out
+            { kd::id{ random_engine }
+            , 3600
+            , std::vector< std::uint8_t >( 4096 ) };
+
+    kd::buffer buffer;
+    kd::serialize( body_out, buffer );
+
+    kd::cache_value_request_body body_in;
+    auto b = buffer.cbegin(), e = buffer.cend();
+    while ( b != e )
+    {
+        auto i = b;
+        BOOST_REQUIRE( kd::deserialize( i, --e, body_in ) );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( can_serialize_store_values_request_body )
+{
+    std::default_random_engine random_engine;
+
+    kd::store_values_request_body body_out;
+    for ( std::size_t i = 0; i < 10; ++ i )
+        body_out.values_.push_back
+                ( { kd::id{ random_engine }
+                  , std::vector< std::uint8_t >( i, std::uint8_t( i ) ) } );
+
+    kd::buffer buffer;
+    kd::serialize( body_out, buffer );
+
+    kd::store_values_request_body body_in;
+    auto i = buffer.cbegin(), e = buffer.cend();
+    BOOST_REQUIRE( ! kd::deserialize( i, e, body_in ) );
+    BOOST_REQUIRE( i == e );
+
+    BOOST_REQUIRE_EQUAL( body_out.values_.size(), body_in.values_.size() );
+    for ( std::size_t j = 0; j < body_out.values_.size(); ++ j )
+    {
+        BOOST_REQUIRE_EQUAL( body_out.values_[ j ].data_key_hash_
+                           , body_in.values_[ j ].data_key_hash_ );
+        BOOST_REQUIRE( body_out.values_[ j ].data_value_
+                     == body_in.values_[ j ].data_value_ );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( can_serialize_find_values_request_body )
+{
+    std::default_random_engine random_engine;
+
+    kd::find_values_request_body body_out;
+    for ( std::size_t i = 0; i < 10; ++ i )
+        body_out.values_to_find_.emplace_back( random_engine );
+
+    kd::buffer buffer;
+    kd::serialize( body_out, buffer );
+
+    kd::find_values_request_body body_in;
+    auto i = buffer.cbegin(), e = buffer.cend();
+    BOOST_REQUIRE( ! kd::deserialize( i, e, body_in ) );
+    BOOST_REQUIRE( i == e );
+
+    BOOST_REQUIRE_EQUAL_COLLECTIONS( body_out.values_to_find_.begin()
+                                   , body_out.values_to_find_.end()
+                                   , body_in.values_to_find_.begin()
+                                   , body_in.values_to_find_.end() );
+}
+
+BOOST_AUTO_TEST_CASE( can_detect_corrupted_find_values_response_body )
+{
+    std::default_random_engine random_engine;
+
+    kd::find_values_response_body body_out;
+    for ( std::size_t i = 0; i < 10; ++ i )
+        body_out.values_.push_back
+                ( { kd::id{ random_engine }
+                  , std::vector< std::uint8_t >( 16, std::uint8_t( i ) ) } );
+
+    kd::buffer buffer;
+    kd::serialize( body_out, buffer );
+
+    auto b = buffer.cbegin(), e = buffer.cend();
+    while ( b != e )
+    {
+        kd::find_values_response_body body_in;
+        auto i = b;
+        BOOST_REQUIRE( kd::deserialize( i, --e, body_in ) );
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
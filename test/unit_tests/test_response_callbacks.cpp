@@ -51,6 +51,17 @@ struct fixture
         , messages_received_{}
     { }
 
+    static kd::response_callbacks::callback
+    ignore_response
+        ( void )
+    {
+        return []( kd::response_callbacks::endpoint_type const&
+                 , kd::header const&
+                 , kd::buffer::const_iterator
+                 , kd::buffer::const_iterator )
+        { };
+    }
+
     kd::response_callbacks callbacks_;
     std::vector< kd::id > messages_received_;
 };
@@ -70,9 +81,6 @@ BOOST_FIXTURE_TEST_CASE( unknown_message_are_dropped , fixture )
 
 BOOST_FIXTURE_TEST_CASE( known_messages_are_forwarded, fixture )
 {
-    kd::header const h1{ kd::header::V1, kd::header::PING_REQUEST
-                       , kd::id{}, kd::id{ "1" } };
-    kd::header const h2{ kd::header::V1, kd::header::PING_REQUEST };
     kd::buffer const b;
 
     BOOST_REQUIRE_EQUAL( 0, messages_received_.size() );
@@ -84,10 +92,13 @@ BOOST_FIXTURE_TEST_CASE( known_messages_are_forwarded, fixture )
             , kd::buffer::const_iterator
             , kd::buffer::const_iterator )
     { messages_received_.push_back( h.random_token_ ); };
-    callbacks_.push_callback( h1.random_token_
-                                , on_message_received );
+    auto const token = callbacks_.push_callback( on_message_received );
     BOOST_REQUIRE_EQUAL( 0, messages_received_.size() );
 
+    kd::header const h1{ kd::header::V1, kd::header::PING_REQUEST
+                       , kd::id{}, token };
+    kd::header const h2{ kd::header::V1, kd::header::PING_REQUEST };
+
     kd::response_callbacks::endpoint_type const s{};
 
     // Send an unexpected message.
@@ -109,10 +120,6 @@ BOOST_FIXTURE_TEST_CASE( known_messages_are_forwarded, fixture )
 
 BOOST_FIXTURE_TEST_CASE( multiple_callbacks_can_be_added, fixture )
 {
-    kd::header const h1{ kd::header::V1, kd::header::PING_REQUEST
-                       , kd::id{}, kd::id{ "1" } };
-    kd::header const h2{ kd::header::V1, kd::header::PING_REQUEST
-                       , kd::id{}, kd::id{ "2" } };
     kd::buffer const b;
 
     BOOST_REQUIRE_EQUAL( 0, messages_received_.size() );
@@ -125,10 +132,14 @@ BOOST_FIXTURE_TEST_CASE( multiple_callbacks_can_be_added, fixture )
     {
         messages_received_.push_back( h.random_token_ );
     };
-    callbacks_.push_callback( h1.random_token_
-                            , on_message_received );
-    callbacks_.push_callback( h2.random_token_
-                            , on_message_received );
+    kd::header const h1{ kd::header::V1, kd::header::PING_REQUEST
+                       , kd::id{}
+                       , callbacks_.push_callback( on_message_received ) };
+    kd::header const h2{ kd::header::V1, kd::header::PING_REQUEST
+                       , kd::id{}
+                       , callbacks_.push_callback( on_message_received ) };
+
+    BOOST_REQUIRE_NE( h1.random_token_, h2.random_token_ );
 
     kd::response_callbacks::endpoint_type const s{};
     auto result = callbacks_.dispatch_response( s, h1, b.begin(), b.end() );
@@ -142,5 +153,68 @@ BOOST_FIXTURE_TEST_CASE( multiple_callbacks_can_be_added, fixture )
     BOOST_REQUIRE_EQUAL( h2.random_token_, messages_received_.back() );
 }
 
+BOOST_FIXTURE_TEST_CASE( forged_tokens_are_dropped, fixture )
+{
+    kd::buffer const b;
+
+    auto on_message_received = [ this ]
+            ( kd::response_callbacks::endpoint_type const& s
+            , kd::header const& h
+            , kd::buffer::const_iterator
+            , kd::buffer::const_iterator )
+    { messages_received_.push_back( h.random_token_ ); };
+
+    kd::header h{ kd::header::V1, kd::header::PING_REQUEST
+                , kd::id{}, callbacks_.push_callback( on_message_received ) };
+
+    // Same slot, different random bytes.
+    auto const token = h.random_token_;
+    h.random_token_[ kd::id::BIT_SIZE - 1 ]
+            = ! h.random_token_[ kd::id::BIT_SIZE - 1 ];
+
+    kd::response_callbacks::endpoint_type const s{};
+    auto result = callbacks_.dispatch_response( s, h, b.begin(), b.end() );
+    BOOST_REQUIRE( k::UNASSOCIATED_MESSAGE_ID == result );
+    BOOST_REQUIRE_EQUAL( kd::response_callbacks::get_slot_index( token )
+                       , kd::response_callbacks::get_slot_index
+                                ( h.random_token_ ) );
+
+    h.random_token_ = token;
+    result = callbacks_.dispatch_response( s, h, b.begin(), b.end() );
+    BOOST_REQUIRE( ! result );
+    BOOST_REQUIRE_EQUAL( 1, messages_received_.size() );
+}
+
+BOOST_FIXTURE_TEST_CASE( slots_are_reused, fixture )
+{
+    auto const t1 = callbacks_.push_callback( ignore_response() );
+    auto const t2 = callbacks_.push_callback( ignore_response() );
+    BOOST_REQUIRE_EQUAL( 0, kd::response_callbacks::get_slot_index( t1 ) );
+    BOOST_REQUIRE_EQUAL( 1, kd::response_callbacks::get_slot_index( t2 ) );
+
+    BOOST_REQUIRE( callbacks_.remove_callback( t1 ) );
+    BOOST_REQUIRE( ! callbacks_.remove_callback( t1 ) );
+
+    auto const t3 = callbacks_.push_callback( ignore_response() );
+    BOOST_REQUIRE_EQUAL( 0, kd::response_callbacks::get_slot_index( t3 ) );
+    BOOST_REQUIRE_NE( t1, t3 );
+
+    // The previous token of the slot is no longer valid.
+    BOOST_REQUIRE( ! callbacks_.remove_callback( t1 ) );
+    BOOST_REQUIRE( callbacks_.remove_callback( t3 ) );
+}
+
+BOOST_AUTO_TEST_CASE( tokens_depend_on_the_key )
+{
+    kd::response_callbacks a{ { { 1, 2 } } };
+    kd::response_callbacks b{ { { 1, 2 } } };
+    kd::response_callbacks c{ { { 1, 3 } } };
+
+    auto const token = a.generate_token();
+    BOOST_REQUIRE_EQUAL( token, b.generate_token() );
+    BOOST_REQUIRE_NE( token, c.generate_token() );
+    BOOST_REQUIRE_NE( token, a.generate_token() );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -119,6 +119,90 @@ BOOST_AUTO_TEST_CASE( discards_already_pushed_ids )
     BOOST_REQUIRE_EQUAL( rt.peer_count(), 1 );
 }
 
+BOOST_AUTO_TEST_CASE( known_peers_are_flagged_as_recently_seen )
+{
+    // Bucket 157 can contain 2 peers, i.e. "4" to "7".
+    routing_table rt{ kd::id{}, 2 };
+    auto const test_peer( create_endpoint() );
+
+    std::vector< kd::id > checked_ids;
+    auto on_k_bucket_full = [ &checked_ids ]
+        ( routing_table::value_type const& least_recently_seen )
+    { checked_ids.push_back( least_recently_seen.first ); };
+
+    BOOST_REQUIRE( rt.push( kd::id{ "4" }, test_peer ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "5" }, test_peer ) );
+
+    // "4" is seen again.
+    BOOST_REQUIRE( ! rt.push( kd::id{ "4" }, test_peer ) );
+    BOOST_REQUIRE_EQUAL( 2, rt.peer_count() );
+
+    // Hence "5" is the least recently seen peer.
+    BOOST_REQUIRE( ! rt.push( kd::id{ "6" }, test_peer, on_k_bucket_full ) );
+    BOOST_REQUIRE_EQUAL( 1, checked_ids.size() );
+    BOOST_REQUIRE_EQUAL( kd::id{ "5" }, checked_ids.back() );
+}
+
+BOOST_AUTO_TEST_CASE( full_bucket_requests_least_recently_seen_check )
+{
+    // Buckets 158 and 159 can contain a single peer.
+    routing_table rt{ kd::id{}, 1 };
+    auto const test_peer( create_endpoint() );
+
+    std::vector< kd::id > checked_ids;
+    auto on_k_bucket_full = [ &checked_ids ]
+        ( routing_table::value_type const& least_recently_seen )
+    { checked_ids.push_back( least_recently_seen.first ); };
+
+    BOOST_REQUIRE( rt.push( kd::id{ "2" }, test_peer, on_k_bucket_full ) );
+    BOOST_REQUIRE( checked_ids.empty() );
+
+    // The bucket is full, "3" becomes a replacement.
+    BOOST_REQUIRE( ! rt.push( kd::id{ "3" }, test_peer, on_k_bucket_full ) );
+    BOOST_REQUIRE_EQUAL( 1, checked_ids.size() );
+    BOOST_REQUIRE_EQUAL( kd::id{ "2" }, checked_ids.back() );
+    BOOST_REQUIRE_EQUAL( 1, rt.peer_count() );
+
+    // A check is already pending.
+    BOOST_REQUIRE( ! rt.push( kd::id{ "3" }, test_peer, on_k_bucket_full ) );
+    BOOST_REQUIRE_EQUAL( 1, checked_ids.size() );
+
+    // "2" answered, hence a new check can be requested.
+    BOOST_REQUIRE( ! rt.push( kd::id{ "2" }, test_peer ) );
+    BOOST_REQUIRE( ! rt.push( kd::id{ "3" }, test_peer, on_k_bucket_full ) );
+    BOOST_REQUIRE_EQUAL( 2, checked_ids.size() );
+
+    // "2" didn't answer, "3" takes its place.
+    BOOST_REQUIRE( rt.remove( kd::id{ "2" } ) );
+    BOOST_REQUIRE_EQUAL( 1, rt.peer_count() );
+    auto const i = rt.find( kd::id{ "2" } );
+    BOOST_REQUIRE( i != rt.end() );
+    BOOST_REQUIRE_EQUAL( kd::id{ "3" }, i->first );
+
+    // The replacement cache is now empty.
+    BOOST_REQUIRE( rt.remove( kd::id{ "3" } ) );
+    BOOST_REQUIRE_EQUAL( 0, rt.peer_count() );
+}
+
+BOOST_AUTO_TEST_CASE( replacement_cache_is_bounded )
+{
+    routing_table rt{ kd::id{}, 1 };
+    auto const test_peer( create_endpoint() );
+
+    // Bucket 157 can contain a single peer, i.e. "4" to "7".
+    BOOST_REQUIRE( rt.push( kd::id{ "4" }, test_peer ) );
+    BOOST_REQUIRE( ! rt.push( kd::id{ "5" }, test_peer ) );
+    BOOST_REQUIRE( ! rt.push( kd::id{ "6" }, test_peer ) );
+
+    // "6" is the most recently seen replacement,
+    // "5" has been dropped.
+    BOOST_REQUIRE( rt.remove( kd::id{ "4" } ) );
+    BOOST_REQUIRE_EQUAL( kd::id{ "6" }, rt.find( kd::id{ "4" } )->first );
+
+    BOOST_REQUIRE( rt.remove( kd::id{ "6" } ) );
+    BOOST_REQUIRE( rt.find( kd::id{ "4" } ) == rt.end() );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 /**
@@ -228,6 +312,77 @@ BOOST_AUTO_TEST_CASE( iterator_skip_empty_k_bucket )
     BOOST_REQUIRE( i == rt.end() );
 }
 
+BOOST_AUTO_TEST_CASE( find_closest_returns_sorted_closest_peers )
+{
+    std::default_random_engine random_engine;
+
+    kd::id const my_id{ random_engine };
+    routing_table rt{ my_id, 4 };
+    auto const test_peer( create_endpoint() );
+
+    // Fill many k_buckets with ids sharing a prefix with ours.
+    std::vector< kd::id > ids;
+    for ( std::size_t i = 0; i != 2000; ++ i )
+    {
+        kd::id new_id{ random_engine };
+        auto const prefix_length = random_engine() % 24;
+        for ( std::size_t j = 0; j != prefix_length; ++ j )
+            new_id[ j ] = static_cast< bool >( my_id[ j ] );
+
+        if ( rt.push( new_id, test_peer ) )
+            ids.push_back( new_id );
+    }
+
+    std::vector< routing_table::value_type > closest_peers;
+    for ( std::size_t i = 0; i != 200; ++ i )
+    {
+        // Search ids far from us, close to us and ourselves.
+        kd::id target{ random_engine };
+        auto const prefix_length = i % 32;
+        for ( std::size_t j = 0; j != prefix_length; ++ j )
+            target[ j ] = static_cast< bool >( my_id[ j ] );
+        if ( i % 50 == 0 )
+            target = my_id;
+
+        auto const count = 1 + i % 40;
+        rt.find_closest( target, count, closest_peers );
+
+        auto expected = ids;
+        std::sort( expected.begin(), expected.end()
+                 , [ &target ]( kd::id const& a, kd::id const& b )
+                   { return kd::distance( a, target )
+                          < kd::distance( b, target ); } );
+        expected.resize( std::min( count, expected.size() ) );
+
+        BOOST_REQUIRE_EQUAL( expected.size(), closest_peers.size() );
+        for ( std::size_t j = 0; j != expected.size(); ++ j )
+            BOOST_REQUIRE_EQUAL( expected[ j ], closest_peers[ j ].first );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( find_closest_handles_small_tables )
+{
+    routing_table rt{ kd::id{} };
+    std::vector< routing_table::value_type > closest_peers;
+
+    rt.find_closest( kd::id{ "1" }, 20, closest_peers );
+    BOOST_REQUIRE( closest_peers.empty() );
+
+    auto const test_peer( create_endpoint() );
+    BOOST_REQUIRE( rt.push( kd::id{ "1" }, test_peer ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "2" }, test_peer ) );
+    BOOST_REQUIRE( rt.push( kd::id{ "4" }, test_peer ) );
+
+    rt.find_closest( kd::id{ "6" }, 20, closest_peers );
+    BOOST_REQUIRE_EQUAL( 3, closest_peers.size() );
+    BOOST_REQUIRE_EQUAL( kd::id{ "4" }, closest_peers[ 0 ].first );
+    BOOST_REQUIRE_EQUAL( kd::id{ "2" }, closest_peers[ 1 ].first );
+    BOOST_REQUIRE_EQUAL( kd::id{ "1" }, closest_peers[ 2 ].first );
+
+    rt.find_closest( kd::id{ "6" }, 0, closest_peers );
+    BOOST_REQUIRE( closest_peers.empty() );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 /**
@@ -250,6 +405,187 @@ BOOST_AUTO_TEST_CASE( can_remove_a_peer )
     BOOST_REQUIRE( rt.find( test_id ) == rt.end() );
 }
 
+BOOST_AUTO_TEST_CASE( lowest_k_bucket_index_is_maintained )
+{
+    std::default_random_engine random_engine;
+
+    kd::id const my_id{ random_engine };
+    std::size_t const bucket_size = 2;
+    routing_table rt{ my_id, bucket_size };
+    auto const test_peer( create_endpoint() );
+
+    // Ids pushed into the routing table, some of
+    // them are stored as replacements.
+    std::vector< kd::id > ids;
+
+    auto const get_bucket_index = [ & ]( kd::id const& i )
+    {
+        return std::min( kd::common_prefix_length( i, my_id )
+                       , kd::id::BIT_SIZE - 1 );
+    };
+
+    // Compute the lowest k_bucket index from scratch,
+    // using the peers found into the routing table.
+    auto const get_expected_index = [ & ]( void )
+    {
+        std::vector< std::size_t > bucket_sizes( kd::id::BIT_SIZE );
+        std::size_t peer_count = 0;
+        for ( auto p = rt.find( my_id ), e = rt.end(); p != e; ++ p )
+        {
+            ++ bucket_sizes[ get_bucket_index( p->first ) ];
+            ++ peer_count;
+        }
+        BOOST_REQUIRE_EQUAL( peer_count, rt.peer_count() );
+
+        std::size_t i = 0, e = kd::id::BIT_SIZE - 1;
+
+        for ( peer_count = 0
+            ; i != e && peer_count <= bucket_size
+            ; ++ i )
+            peer_count += bucket_sizes[ i ];
+
+        return i;
+    };
+
+    BOOST_REQUIRE_EQUAL( get_expected_index(), rt.lowest_k_bucket_index() );
+
+    for ( std::size_t i = 0; i != 10000; ++ i )
+    {
+        if ( ids.empty() || random_engine() % 3 != 0 )
+        {
+            // Generate an id close to ours, sharing between
+            // 0 and 15 bits so that lower buckets get filled.
+            kd::id new_id{ random_engine };
+            auto const prefix_length = random_engine() % 16;
+            for ( std::size_t j = 0; j != prefix_length; ++ j )
+                new_id[ j ] = static_cast< bool >( my_id[ j ] );
+
+            rt.push( new_id, test_peer );
+            ids.push_back( new_id );
+        }
+        else
+        {
+            auto const j = random_engine() % ids.size();
+            rt.remove( ids[ j ] );
+
+            ids[ j ] = ids.back();
+            ids.pop_back();
+        }
+
+        BOOST_REQUIRE_EQUAL( get_expected_index(), rt.lowest_k_bucket_index() );
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/**
+ *  Test routing_table::record_response()/record_failure()
+ */
+BOOST_AUTO_TEST_SUITE( test_statistics )
+
+BOOST_AUTO_TEST_CASE( unknown_peers_have_no_statistics )
+{
+    routing_table rt{ kd::id{} };
+
+    BOOST_REQUIRE( rt.get_statistics( kd::id{ "1" } ) == nullptr );
+    BOOST_REQUIRE( ! rt.record_response( kd::id{ "1" }
+                                       , std::chrono::milliseconds( 10 ) ) );
+    BOOST_REQUIRE( ! rt.record_failure( kd::id{ "1" } ) );
+}
+
+BOOST_AUTO_TEST_CASE( statistics_are_updated )
+{
+    using std::chrono::milliseconds;
+
+    routing_table rt{ kd::id{} };
+    kd::id const test_id{ "1" };
+    BOOST_REQUIRE( rt.push( test_id, create_endpoint() ) );
+
+    auto s = rt.get_statistics( test_id );
+    BOOST_REQUIRE( s != nullptr );
+    BOOST_REQUIRE_EQUAL( 0, s->responses_count_ );
+    BOOST_REQUIRE_EQUAL( 0, s->consecutive_failures_ );
+    auto const first_seen = s->last_seen_;
+
+    BOOST_REQUIRE( rt.record_failure( test_id ) );
+    BOOST_REQUIRE( rt.record_failure( test_id ) );
+    s = rt.get_statistics( test_id );
+    BOOST_REQUIRE_EQUAL( 2, s->consecutive_failures_ );
+
+    // The first sample initializes the estimations.
+    BOOST_REQUIRE( rt.record_response( test_id, milliseconds( 80 ) ) );
+    s = rt.get_statistics( test_id );
+    BOOST_REQUIRE_EQUAL( 1, s->responses_count_ );
+    BOOST_REQUIRE_EQUAL( 0, s->consecutive_failures_ );
+    BOOST_REQUIRE( s->smoothed_rtt_ == milliseconds( 80 ) );
+    BOOST_REQUIRE( s->rtt_variance_ == milliseconds( 40 ) );
+    BOOST_REQUIRE( s->last_seen_ >= first_seen );
+
+    // Then they are smoothed.
+    BOOST_REQUIRE( rt.record_response( test_id, milliseconds( 160 ) ) );
+    s = rt.get_statistics( test_id );
+    BOOST_REQUIRE_EQUAL( 2, s->responses_count_ );
+    BOOST_REQUIRE( s->smoothed_rtt_ == milliseconds( 90 ) );
+    BOOST_REQUIRE( s->rtt_variance_ == milliseconds( 50 ) );
+}
+
+BOOST_AUTO_TEST_CASE( statistics_follow_promoted_replacements )
+{
+    using std::chrono::milliseconds;
+
+    // Bucket 158 can contain a single peer.
+    routing_table rt{ kd::id{}, 1 };
+    auto const test_peer( create_endpoint() );
+
+    BOOST_REQUIRE( rt.push( kd::id{ "2" }, test_peer ) );
+    BOOST_REQUIRE( rt.record_failure( kd::id{ "2" } ) );
+    BOOST_REQUIRE( ! rt.push( kd::id{ "3" }, test_peer ) );
+
+    // Replacements are not reachable.
+    BOOST_REQUIRE( rt.get_statistics( kd::id{ "3" } ) == nullptr );
+
+    BOOST_REQUIRE( rt.remove( kd::id{ "2" } ) );
+    auto const s = rt.get_statistics( kd::id{ "3" } );
+    BOOST_REQUIRE( s != nullptr );
+    BOOST_REQUIRE_EQUAL( 0, s->consecutive_failures_ );
+}
+
+BOOST_AUTO_TEST_CASE( retransmission_timeout_follows_statistics )
+{
+    using std::chrono::milliseconds;
+
+    routing_table rt{ kd::id{} };
+    kd::id const test_id{ "1" };
+    BOOST_REQUIRE( rt.push( test_id, create_endpoint() ) );
+    kd::timer::duration const minimum{ milliseconds( 100 ) };
+
+    // Without sample, the minimum is used.
+    BOOST_REQUIRE( kd::get_retransmission_timeout( *rt.get_statistics( test_id )
+                                                 , minimum ) == minimum );
+
+    // 80 + 4 * 40.
+    BOOST_REQUIRE( rt.record_response( test_id, milliseconds( 80 ) ) );
+    BOOST_REQUIRE( kd::get_retransmission_timeout( *rt.get_statistics( test_id )
+                                                 , minimum )
+                   == milliseconds( 240 ) );
+
+    // Doubled on each failure, up to 8 times.
+    BOOST_REQUIRE( rt.record_failure( test_id ) );
+    BOOST_REQUIRE( kd::get_retransmission_timeout( *rt.get_statistics( test_id )
+                                                 , minimum )
+                   == milliseconds( 480 ) );
+    for ( auto i = 0; i != 4; ++ i )
+        BOOST_REQUIRE( rt.record_failure( test_id ) );
+    BOOST_REQUIRE( kd::get_retransmission_timeout( *rt.get_statistics( test_id )
+                                                 , minimum )
+                   == milliseconds( 1920 ) );
+
+    // The minimum prevails on fast peers.
+    BOOST_REQUIRE( kd::get_retransmission_timeout( *rt.get_statistics( test_id )
+                                                 , milliseconds( 5000 ) )
+                   == milliseconds( 5000 ) );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 /**
@@ -0,0 +1,160 @@
+// Copyright (c) 2013-2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <kademlia/error.hpp>
+
+#include "helpers/common.hpp"
+#include "helpers/peer_factory.hpp"
+
+#include "kademlia/routing_table_snapshot.hpp"
+
+namespace k = kademlia;
+namespace kd = kademlia::detail;
+
+namespace {
+
+kd::routing_table_snapshot
+create_snapshot
+    ( void )
+{
+    return { kd::id{ "1234" }
+           , { create_peer( kd::id{ "a" } )
+             , create_peer( kd::id{ "b" }, create_endpoint( "::1", 1234 ) )
+             , create_peer( kd::id{ "c" }, create_endpoint( "10.0.0.1" ) ) } };
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE( test_serialization )
+
+BOOST_AUTO_TEST_CASE( snapshot_can_be_serialized_and_deserialized )
+{
+    auto const expected = create_snapshot();
+
+    kd::buffer b;
+    kd::serialize_routing_table_snapshot( expected, b );
+
+    kd::routing_table_snapshot actual;
+    BOOST_REQUIRE( ! kd::deserialize_routing_table_snapshot( b.begin()
+                                                           , b.end()
+                                                           , actual ) );
+    BOOST_REQUIRE_EQUAL( expected.my_id_, actual.my_id_ );
+    BOOST_REQUIRE( expected.peers_ == actual.peers_ );
+}
+
+BOOST_AUTO_TEST_CASE( corrupted_snapshot_is_rejected )
+{
+    kd::buffer b;
+    kd::serialize_routing_table_snapshot( create_snapshot(), b );
+
+    kd::routing_table_snapshot actual;
+
+    // Invalid magic.
+    auto corrupted = b;
+    corrupted[ 0 ] = 'X';
+    BOOST_REQUIRE( kd::deserialize_routing_table_snapshot( corrupted.begin()
+                                                         , corrupted.end()
+                                                         , actual )
+                 == k::INVALID_ROUTING_TABLE_SNAPSHOT );
+
+    // Unknown version.
+    corrupted = b;
+    ++ corrupted[ 4 ];
+    BOOST_REQUIRE( kd::deserialize_routing_table_snapshot( corrupted.begin()
+                                                         , corrupted.end()
+                                                         , actual )
+                 == k::UNKNOWN_PROTOCOL_VERSION );
+
+    // Truncated peer list.
+    corrupted.assign( b.begin(), b.end() - 1 );
+    BOOST_REQUIRE( kd::deserialize_routing_table_snapshot( corrupted.begin()
+                                                         , corrupted.end()
+                                                         , actual ) );
+
+    // Unknown endpoint protocol of the first peer, which follows
+    // the header, the id, the peers count, the peer id and port.
+    corrupted = b;
+    corrupted[ 5 + kd::id::BLOCKS_COUNT + 8 + kd::id::BLOCKS_COUNT + 2 ] = 0x7f;
+    BOOST_REQUIRE( kd::deserialize_routing_table_snapshot( corrupted.begin()
+                                                         , corrupted.end()
+                                                         , actual )
+                 == k::INVALID_ROUTING_TABLE_SNAPSHOT );
+
+    // Trailing garbage.
+    corrupted = b;
+    corrupted.push_back( 0 );
+    BOOST_REQUIRE( kd::deserialize_routing_table_snapshot( corrupted.begin()
+                                                         , corrupted.end()
+                                                         , actual )
+                 == k::INVALID_ROUTING_TABLE_SNAPSHOT );
+
+    BOOST_REQUIRE( actual.peers_.empty() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( test_file )
+
+BOOST_AUTO_TEST_CASE( snapshot_can_be_saved_and_loaded )
+{
+    char const* path = "test_routing_table_snapshot.bin";
+    auto const expected = create_snapshot();
+
+    BOOST_REQUIRE( ! kd::save_routing_table_snapshot( path, expected ) );
+
+    kd::routing_table_snapshot actual;
+    BOOST_REQUIRE( ! kd::load_routing_table_snapshot( path, actual ) );
+    BOOST_REQUIRE_EQUAL( expected.my_id_, actual.my_id_ );
+    BOOST_REQUIRE( expected.peers_ == actual.peers_ );
+
+    // The file written beside the snapshot has been renamed.
+    std::ifstream temporary{ std::string{ path } + ".tmp" };
+    BOOST_REQUIRE( ! temporary );
+
+    // A later save replaces the snapshot.
+    auto const smaller = kd::routing_table_snapshot{ expected.my_id_
+                                                   , { expected.peers_[ 0 ] } };
+    BOOST_REQUIRE( ! kd::save_routing_table_snapshot( path, smaller ) );
+    BOOST_REQUIRE( ! kd::load_routing_table_snapshot( path, actual ) );
+    BOOST_REQUIRE_EQUAL( 1, actual.peers_.size() );
+
+    std::remove( path );
+}
+
+BOOST_AUTO_TEST_CASE( missing_snapshot_can_not_be_loaded )
+{
+    kd::routing_table_snapshot actual;
+    BOOST_REQUIRE( kd::load_routing_table_snapshot( "missing_snapshot.bin"
+                                                  , actual ) );
+    BOOST_REQUIRE( actual.peers_.empty() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
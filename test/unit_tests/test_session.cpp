@@ -116,4 +116,52 @@ BOOST_AUTO_TEST_CASE( first_session_run_can_be_aborted )
     BOOST_REQUIRE( result.get() == k::RUN_ABORTED );
 }
 
+BOOST_AUTO_TEST_CASE( session_throw_on_keys_and_datas_size_mismatch )
+{
+    k::endpoint const initial_peer{ "127.0.0.1", 12345 };
+    k::session s{ initial_peer };
+
+    std::vector< k::session::key_type > const keys{ { 1 }, { 2 } };
+    std::vector< k::session::data_type > const datas{ { 1 } };
+
+    auto on_save = [] ( std::error_code const& ) {};
+    BOOST_REQUIRE_THROW( s.async_save_many( keys, datas, on_save )
+                       , std::system_error );
+    BOOST_REQUIRE_THROW( s.async_save_many( {}, datas, on_save )
+                       , std::system_error );
+}
+
+BOOST_AUTO_TEST_CASE( session_completes_empty_batches_from_run )
+{
+    k::endpoint const initial_peer{ "127.0.0.1", 12345 };
+    k::session s{ initial_peer };
+
+    bool is_saved = false;
+    auto on_save = [ &is_saved ] ( std::error_code const& failure )
+    {
+        BOOST_REQUIRE( ! failure );
+        is_saved = true;
+    };
+    s.async_save_many( {}, {}, on_save );
+
+    bool is_loaded = false;
+    auto on_load = [ &s, &is_loaded ]
+        ( std::error_code const& failure
+        , std::vector< k::session::data_type > const& datas )
+    {
+        BOOST_REQUIRE( ! failure );
+        BOOST_REQUIRE( datas.empty() );
+        is_loaded = true;
+        s.abort();
+    };
+    s.async_load_many( {}, on_load );
+
+    BOOST_REQUIRE( ! is_saved );
+    BOOST_REQUIRE( ! is_loaded );
+
+    BOOST_REQUIRE( s.run() == k::RUN_ABORTED );
+    BOOST_REQUIRE( is_saved );
+    BOOST_REQUIRE( is_loaded );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,227 @@
+// Copyright (c) 2013-2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "helpers/common.hpp"
+#include "helpers/peer_factory.hpp"
+
+#include "kademlia/split_routing_table.hpp"
+#include "kademlia/ip_endpoint.hpp"
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+using routing_table = kd::split_routing_table< kd::ip_endpoint >;
+
+namespace {
+
+/**
+ *  Create an id sharing exactly prefix_length
+ *  bits with the null id.
+ */
+kd::id
+create_id
+    ( std::size_t prefix_length
+    , std::size_t suffix )
+{
+    kd::id new_id;
+    new_id[ prefix_length ] = true;
+    for ( std::size_t i = 0; i != 8; ++ i )
+        new_id[ kd::id::BIT_SIZE - 1 - i ] = ( suffix >> i ) & 1;
+
+    return new_id;
+}
+
+} // anonymous namespace
+
+/**
+ *  Test split_routing_table::split_routing_table()
+ */
+BOOST_AUTO_TEST_SUITE( test_construction )
+
+BOOST_AUTO_TEST_CASE( is_empty_on_construction )
+{
+    std::default_random_engine random_engine;
+
+    routing_table rt{ kd::id( random_engine ) };
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 0 );
+    BOOST_REQUIRE_EQUAL( rt.k_bucket_count(), 1 );
+    BOOST_REQUIRE( rt.begin() == rt.end() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+
+/**
+ *  Test split_routing_table::push()
+ */
+BOOST_AUTO_TEST_SUITE( test_push )
+
+BOOST_AUTO_TEST_CASE( only_the_k_bucket_of_own_id_is_split )
+{
+    routing_table rt{ kd::id{}, 2 };
+    auto const test_peer( create_endpoint() );
+
+    // Fill the single k_bucket with far peers.
+    BOOST_REQUIRE( rt.push( create_id( 0, 1 ), test_peer ) );
+    BOOST_REQUIRE( rt.push( create_id( 0, 2 ), test_peer ) );
+    BOOST_REQUIRE_EQUAL( rt.k_bucket_count(), 1 );
+
+    // It is split, but the far half is still full.
+    BOOST_REQUIRE( ! rt.push( create_id( 0, 3 ), test_peer ) );
+    BOOST_REQUIRE_EQUAL( rt.k_bucket_count(), 2 );
+
+    // Closer peers go into the new k_bucket.
+    BOOST_REQUIRE( rt.push( create_id( 1, 1 ), test_peer ) );
+    BOOST_REQUIRE( rt.push( create_id( 5, 1 ), test_peer ) );
+    BOOST_REQUIRE_EQUAL( rt.k_bucket_count(), 2 );
+
+    // Which is split until the new peer finds room.
+    BOOST_REQUIRE( rt.push( create_id( 7, 1 ), test_peer ) );
+    BOOST_REQUIRE_EQUAL( rt.k_bucket_count(), 3 );
+    BOOST_REQUIRE( rt.push( create_id( 7, 2 ), test_peer ) );
+    BOOST_REQUIRE_EQUAL( rt.k_bucket_count(), 7 );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 6 );
+
+    // The far half is never split again.
+    BOOST_REQUIRE( ! rt.push( create_id( 0, 4 ), test_peer ) );
+    BOOST_REQUIRE_EQUAL( rt.k_bucket_count(), 7 );
+}
+
+BOOST_AUTO_TEST_CASE( discards_already_pushed_ids )
+{
+    routing_table rt{ kd::id{} };
+    auto const test_peer( create_endpoint() );
+
+    BOOST_REQUIRE( rt.push( create_id( 3, 1 ), test_peer ) );
+    BOOST_REQUIRE( ! rt.push( create_id( 3, 1 ), test_peer ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 1 );
+}
+
+BOOST_AUTO_TEST_CASE( full_bucket_requests_least_recently_seen_check )
+{
+    routing_table rt{ kd::id{}, 2 };
+    auto const test_peer( create_endpoint() );
+
+    BOOST_REQUIRE( rt.push( create_id( 0, 1 ), test_peer ) );
+    BOOST_REQUIRE( rt.push( create_id( 0, 2 ), test_peer ) );
+    BOOST_REQUIRE( rt.push( create_id( 0, 1 ), test_peer ) == false );
+
+    std::vector< kd::id > checked_ids;
+    auto on_k_bucket_full = [ &checked_ids ]
+        ( routing_table::value_type const& least_recently_seen )
+    { checked_ids.push_back( least_recently_seen.first ); };
+
+    BOOST_REQUIRE( ! rt.push( create_id( 0, 3 ), test_peer, on_k_bucket_full ) );
+    BOOST_REQUIRE( ! rt.push( create_id( 0, 4 ), test_peer, on_k_bucket_full ) );
+    BOOST_REQUIRE_EQUAL( checked_ids.size(), 1 );
+    BOOST_REQUIRE_EQUAL( checked_ids.front(), create_id( 0, 2 ) );
+
+    // The most recently seen replacement takes its place.
+    BOOST_REQUIRE( rt.remove( create_id( 0, 2 ) ) );
+    BOOST_REQUIRE( rt.get_statistics( create_id( 0, 4 ) ) );
+    BOOST_REQUIRE( ! rt.get_statistics( create_id( 0, 2 ) ) );
+    BOOST_REQUIRE_EQUAL( rt.peer_count(), 2 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+
+/**
+ *  Test split_routing_table::find()
+ */
+BOOST_AUTO_TEST_SUITE( test_find )
+
+BOOST_AUTO_TEST_CASE( iteration_visits_every_peer )
+{
+    std::default_random_engine random_engine;
+
+    routing_table rt{ kd::id{ random_engine }, 4 };
+    auto const test_peer( create_endpoint() );
+
+    for ( std::size_t i = 0; i != 500; ++ i )
+        rt.push( kd::id{ random_engine }, test_peer );
+
+    std::size_t count = 0;
+    for ( auto i = rt.begin(), e = rt.end(); i != e; ++ i )
+        ++ count;
+
+    BOOST_REQUIRE_EQUAL( count, rt.peer_count() );
+}
+
+BOOST_AUTO_TEST_CASE( find_closest_returns_sorted_closest_peers )
+{
+    std::default_random_engine random_engine;
+
+    kd::id const my_id{ random_engine };
+    routing_table rt{ my_id, 4 };
+    auto const test_peer( create_endpoint() );
+
+    std::vector< kd::id > ids;
+    for ( std::size_t i = 0; i != 2000; ++ i )
+    {
+        kd::id new_id{ random_engine };
+        auto const prefix_length = random_engine() % 24;
+        for ( std::size_t j = 0; j != prefix_length; ++ j )
+            new_id[ j ] = static_cast< bool >( my_id[ j ] );
+
+        rt.push( new_id, test_peer );
+    }
+
+    // Splitting moves peers around, read back the content.
+    for ( auto i = rt.begin(), e = rt.end(); i != e; ++ i )
+        ids.push_back( ( *i ).first );
+
+    std::vector< routing_table::value_type > closest_peers;
+    for ( std::size_t i = 0; i != 200; ++ i )
+    {
+        kd::id target{ random_engine };
+        auto const prefix_length = i % 32;
+        for ( std::size_t j = 0; j != prefix_length; ++ j )
+            target[ j ] = static_cast< bool >( my_id[ j ] );
+        if ( i % 50 == 0 )
+            target = my_id;
+
+        auto const count = 1 + i % 40;
+        rt.find_closest( target, count, closest_peers );
+
+        auto expected = ids;
+        std::sort( expected.begin(), expected.end()
+                 , [ &target ]( kd::id const& a, kd::id const& b )
+                   { return kd::distance( a, target )
+                          < kd::distance( b, target ); } );
+        expected.resize( std::min( count, expected.size() ) );
+
+        BOOST_REQUIRE_EQUAL( expected.size(), closest_peers.size() );
+        for ( std::size_t j = 0; j != expected.size(); ++ j )
+            BOOST_REQUIRE_EQUAL( expected[ j ], closest_peers[ j ].first );
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
@@ -296,5 +296,83 @@ BOOST_AUTO_TEST_CASE( can_skip_corrupted_response )
     BOOST_REQUIRE( failure_ == k::INITIAL_PEER_FAILED_TO_RESPOND );
 }
 
+BOOST_AUTO_TEST_CASE( can_store_value_on_cached_peers )
+{
+    kd::id const chosen_key{ "a" };
+    kd::buffer const data{ 1, 2, 3, 4 };
+    routing_table_.expected_ids_.emplace_back( chosen_key );
+
+    // A previous lookup found p1, p2 & p3 closest to the key.
+    auto p1 = create_peer( "192.168.1.1", kd::id{ "a" } );
+    auto p2 = create_peer( "192.168.1.2", kd::id{ "b" } );
+    auto p3 = create_peer( "192.168.1.3", kd::id{ "8" } );
+    kd::lookup_cache cache{ 1, std::chrono::seconds{ 60 }, kd::id::BIT_PER_WORD };
+    cache.save( chosen_key, { p1, p2, p3 } );
+
+    for ( auto const& p : { p1, p2, p3 } )
+        tracker_.add_message_to_receive( p.endpoint_
+                                       , p.id_
+                                       , kd::find_peer_response_body{} );
+
+    // p4 is known from the routing table but farther.
+    auto p4 = create_and_add_peer( "192.168.1.4", kd::id{ "f" } );
+
+    kd::start_store_value_task< data_type >( chosen_key
+                                           , data
+                                           , tracker_
+                                           , routing_table_
+                                           , std::ref( *this )
+                                           , nullptr
+                                           , &cache );
+    io_service_.poll();
+
+    // Cached peers are queried as they may not be the
+    // closest ones, before the farther p4.
+    kd::find_peer_request_body const fp{ chosen_key };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, fp ) );
+    BOOST_REQUIRE( tracker_.has_sent_message( p2.endpoint_, fp ) );
+    BOOST_REQUIRE( tracker_.has_sent_message( p3.endpoint_, fp ) );
+    BOOST_REQUIRE( tracker_.has_sent_message( p4.endpoint_, fp ) );
+
+    kd::store_value_request_body const sv{ chosen_key, data };
+    BOOST_REQUIRE( tracker_.has_sent_message( p1.endpoint_, sv ) );
+    BOOST_REQUIRE( tracker_.has_sent_message( p2.endpoint_, sv ) );
+    BOOST_REQUIRE( tracker_.has_sent_message( p3.endpoint_, sv ) );
+    BOOST_REQUIRE( ! tracker_.has_sent_message() );
+
+    BOOST_REQUIRE_EQUAL( 1, callback_call_count_ );
+    BOOST_REQUIRE( ! failure_ );
+}
+
+BOOST_AUTO_TEST_CASE( can_cache_the_peers_which_responded )
+{
+    kd::id const chosen_key{ "a" };
+    kd::buffer const data{ 1, 2, 3, 4 };
+    routing_table_.expected_ids_.emplace_back( chosen_key );
+
+    auto p1 = create_and_add_peer( "192.168.1.1", kd::id{ "b" } );
+    tracker_.add_message_to_receive( p1.endpoint_
+                                   , p1.id_
+                                   , kd::find_peer_response_body{} );
+
+    kd::lookup_cache cache{ 1, std::chrono::seconds{ 60 }, kd::id::BIT_PER_WORD };
+    kd::start_store_value_task< data_type >( chosen_key
+                                           , data
+                                           , tracker_
+                                           , routing_table_
+                                           , std::ref( *this )
+                                           , nullptr
+                                           , &cache );
+    io_service_.poll();
+
+    BOOST_REQUIRE_EQUAL( 1, callback_call_count_ );
+    BOOST_REQUIRE( ! failure_ );
+
+    std::vector< kd::peer > peers;
+    BOOST_REQUIRE( cache.find( chosen_key, peers ) );
+    BOOST_REQUIRE_EQUAL( 1, peers.size() );
+    BOOST_REQUIRE_EQUAL( p1, peers[ 0 ] );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
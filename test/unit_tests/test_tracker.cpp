@@ -0,0 +1,217 @@
+// Copyright (c) 2014, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "helpers/common.hpp"
+#include "helpers/peer_factory.hpp"
+
+#include <chrono>
+#include <vector>
+#include <system_error>
+
+#include <boost/asio/io_service.hpp>
+
+#include "kademlia/buffer.hpp"
+#include "kademlia/message.hpp"
+#include "kademlia/routing_table.hpp"
+#include "kademlia/tracker.hpp"
+
+namespace {
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+/**
+ *  Network whose sends complete immediately with failure_.
+ */
+struct network_mock
+{
+    using endpoint_type = kd::ip_endpoint;
+
+    template< typename OnMessageSent >
+    void
+    send
+        ( kd::buffer const& message
+        , endpoint_type const&
+        , OnMessageSent const& on_message_sent )
+    {
+        sent_messages_.push_back( message );
+        on_message_sent( failure_ );
+    }
+
+    std::vector< kd::buffer > sent_messages_;
+    std::error_code failure_;
+};
+
+using routing_table = kd::routing_table< kd::ip_endpoint >;
+using tracker = kd::tracker< network_mock, routing_table >;
+
+/**
+ *
+ */
+struct fixture
+{
+    fixture
+        ( void )
+        : io_service_()
+        , network_()
+        , routing_table_( kd::id{} )
+        , tracker_( io_service_, kd::id{}, network_, routing_table_ )
+        , responses_count_()
+        , errors_count_()
+    { }
+
+    void
+    ping
+        ( kd::peer const& p )
+    {
+        auto on_response = [ this ]
+            ( kd::ip_endpoint const&
+            , kd::header const&
+            , kd::buffer::const_iterator
+            , kd::buffer::const_iterator )
+        { ++ responses_count_; };
+
+        auto on_error = [ this ]( std::error_code const& )
+        { ++ errors_count_; };
+
+        tracker_.send_request( kd::header::PING_REQUEST, p
+                             , std::chrono::seconds( 1 )
+                             , on_response, on_error );
+    }
+
+    void
+    answer_last_request
+        ( kd::id const& source_id )
+    {
+        BOOST_REQUIRE( ! network_.sent_messages_.empty() );
+        auto const& request = network_.sent_messages_.back();
+        auto i = request.cbegin();
+        kd::header h;
+        BOOST_REQUIRE( ! kd::deserialize( i, request.cend(), h ) );
+
+        kd::header const response{ kd::header::V1
+                                 , kd::header::PING_RESPONSE
+                                 , source_id
+                                 , h.random_token_ };
+        kd::buffer const body;
+        tracker_.handle_new_response( create_endpoint(), response
+                                    , body.cbegin(), body.cend() );
+    }
+
+    boost::asio::io_service io_service_;
+    network_mock network_;
+    routing_table routing_table_;
+    tracker tracker_;
+    std::size_t responses_count_;
+    std::size_t errors_count_;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE( test_statistics )
+
+BOOST_FIXTURE_TEST_CASE( response_is_credited_to_the_requested_peer, fixture )
+{
+    auto const p = create_peer( kd::id{ "1" }, create_endpoint() );
+    BOOST_REQUIRE( routing_table_.push( p.id_, p.endpoint_ ) );
+
+    ping( p );
+    answer_last_request( p.id_ );
+
+    BOOST_REQUIRE_EQUAL( 1, responses_count_ );
+    BOOST_REQUIRE_EQUAL( 1, routing_table_.get_statistics( p.id_ )
+                                          ->responses_count_ );
+}
+
+BOOST_FIXTURE_TEST_CASE( response_of_another_peer_is_not_credited, fixture )
+{
+    auto const p = create_peer( kd::id{ "1" }, create_endpoint() );
+    kd::id const other_id{ "2" };
+    BOOST_REQUIRE( routing_table_.push( p.id_, p.endpoint_ ) );
+    BOOST_REQUIRE( routing_table_.push( other_id, create_endpoint() ) );
+
+    ping( p );
+    answer_last_request( other_id );
+
+    BOOST_REQUIRE_EQUAL( 1, responses_count_ );
+    BOOST_REQUIRE_EQUAL( 0, routing_table_.get_statistics( p.id_ )
+                                          ->responses_count_ );
+    BOOST_REQUIRE_EQUAL( 0, routing_table_.get_statistics( other_id )
+                                          ->responses_count_ );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( test_eviction )
+
+BOOST_FIXTURE_TEST_CASE( restored_peer_is_evicted_on_first_failure, fixture )
+{
+    auto const p = create_peer( kd::id{ "1" }, create_endpoint() );
+    BOOST_REQUIRE( routing_table_.push( p.id_, p.endpoint_ ) );
+    tracker_.add_restored_peer( p.id_ );
+
+    network_.failure_ = make_error_code( std::errc::host_unreachable );
+    ping( p );
+
+    BOOST_REQUIRE_EQUAL( 1, errors_count_ );
+    BOOST_REQUIRE( routing_table_.get_statistics( p.id_ ) == nullptr );
+}
+
+BOOST_FIXTURE_TEST_CASE( restored_peer_which_answered_is_kept, fixture )
+{
+    auto const p = create_peer( kd::id{ "1" }, create_endpoint() );
+    BOOST_REQUIRE( routing_table_.push( p.id_, p.endpoint_ ) );
+    tracker_.add_restored_peer( p.id_ );
+
+    ping( p );
+    answer_last_request( p.id_ );
+
+    network_.failure_ = make_error_code( std::errc::host_unreachable );
+    ping( p );
+
+    BOOST_REQUIRE_EQUAL( 1, errors_count_ );
+    auto const statistics = routing_table_.get_statistics( p.id_ );
+    BOOST_REQUIRE( statistics != nullptr );
+    BOOST_REQUIRE_EQUAL( 1, statistics->consecutive_failures_ );
+}
+
+BOOST_FIXTURE_TEST_CASE( learned_peer_is_kept_on_first_failure, fixture )
+{
+    // E.g. a peer learned from a FIND_PEER response
+    // which never answered any of our requests.
+    auto const p = create_peer( kd::id{ "1" }, create_endpoint() );
+    BOOST_REQUIRE( routing_table_.push( p.id_, p.endpoint_ ) );
+
+    network_.failure_ = make_error_code( std::errc::host_unreachable );
+    ping( p );
+
+    BOOST_REQUIRE_EQUAL( 1, errors_count_ );
+    auto const statistics = routing_table_.get_statistics( p.id_ );
+    BOOST_REQUIRE( statistics != nullptr );
+    BOOST_REQUIRE_EQUAL( 0, statistics->responses_count_ );
+    BOOST_REQUIRE_EQUAL( 1, statistics->consecutive_failures_ );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,135 @@
+// Copyright (c) 2013-2015, David Keller
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the University of California, Berkeley nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY DAVID KELLER AND CONTRIBUTORS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE REGENTS AND CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "helpers/common.hpp"
+
+#include <chrono>
+#include <string>
+
+#include "kademlia/value_cache.hpp"
+
+namespace k = kademlia;
+namespace kd = k::detail;
+
+namespace {
+
+using value_cache = kd::value_cache< std::string >;
+
+kd::timer::clock::time_point const NOW{ std::chrono::hours{ 1 } };
+
+kd::timer::clock::time_point
+in
+    ( int seconds )
+{ return NOW + std::chrono::seconds{ seconds }; }
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE( test_usage )
+
+BOOST_AUTO_TEST_CASE( can_find_a_value_until_it_expires )
+{
+    value_cache cache{ 2 };
+    BOOST_REQUIRE( cache.find( kd::id{ "1" }, NOW ) == nullptr );
+
+    cache.insert( kd::id{ "1" }, "a", in( 10 ), NOW );
+    BOOST_REQUIRE_EQUAL( 1, cache.size() );
+
+    auto const value = cache.find( kd::id{ "1" }, in( 9 ) );
+    BOOST_REQUIRE( value != nullptr );
+    BOOST_REQUIRE_EQUAL( "a", *value );
+
+    // The expired value is dropped.
+    BOOST_REQUIRE( cache.find( kd::id{ "1" }, in( 10 ) ) == nullptr );
+    BOOST_REQUIRE_EQUAL( 0, cache.size() );
+}
+
+BOOST_AUTO_TEST_CASE( can_replace_a_value_without_shortening_its_life )
+{
+    value_cache cache{ 2 };
+
+    cache.insert( kd::id{ "1" }, "a", in( 20 ), NOW );
+    cache.insert( kd::id{ "1" }, "b", in( 10 ), NOW );
+    BOOST_REQUIRE_EQUAL( 1, cache.size() );
+    BOOST_REQUIRE_EQUAL( "b", *cache.find( kd::id{ "1" }, in( 15 ) ) );
+
+    cache.insert( kd::id{ "1" }, "c", in( 30 ), NOW );
+    BOOST_REQUIRE_EQUAL( "c", *cache.find( kd::id{ "1" }, in( 25 ) ) );
+}
+
+BOOST_AUTO_TEST_CASE( can_erase_a_value )
+{
+    value_cache cache{ 2 };
+
+    cache.insert( kd::id{ "1" }, "a", in( 10 ), NOW );
+    cache.erase( kd::id{ "1" } );
+    cache.erase( kd::id{ "2" } );
+    BOOST_REQUIRE_EQUAL( 0, cache.size() );
+    BOOST_REQUIRE( cache.find( kd::id{ "1" }, NOW ) == nullptr );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE( test_eviction )
+
+BOOST_AUTO_TEST_CASE( expired_values_are_dropped_first_when_full )
+{
+    value_cache cache{ 3 };
+
+    cache.insert( kd::id{ "1" }, "a", in( 30 ), NOW );
+    cache.insert( kd::id{ "2" }, "b", in( 10 ), NOW );
+    cache.insert( kd::id{ "3" }, "c", in( 20 ), NOW );
+
+    // Both "2" and "3" have expired.
+    cache.insert( kd::id{ "4" }, "d", in( 40 ), in( 25 ) );
+    BOOST_REQUIRE_EQUAL( 2, cache.size() );
+    BOOST_REQUIRE( cache.find( kd::id{ "1" }, in( 25 ) ) != nullptr );
+    BOOST_REQUIRE( cache.find( kd::id{ "4" }, in( 25 ) ) != nullptr );
+}
+
+BOOST_AUTO_TEST_CASE( value_expiring_first_is_dropped_when_full )
+{
+    value_cache cache{ 2 };
+
+    cache.insert( kd::id{ "1" }, "a", in( 20 ), NOW );
+    cache.insert( kd::id{ "2" }, "b", in( 10 ), NOW );
+    // Extending "2" makes "1" the next to expire.
+    cache.insert( kd::id{ "2" }, "b", in( 30 ), NOW );
+
+    cache.insert( kd::id{ "3" }, "c", in( 15 ), NOW );
+    BOOST_REQUIRE_EQUAL( 2, cache.size() );
+    BOOST_REQUIRE( cache.find( kd::id{ "1" }, NOW ) == nullptr );
+    BOOST_REQUIRE( cache.find( kd::id{ "2" }, NOW ) != nullptr );
+    BOOST_REQUIRE( cache.find( kd::id{ "3" }, NOW ) != nullptr );
+}
+
+BOOST_AUTO_TEST_CASE( nothing_is_cached_without_room )
+{
+    value_cache cache{ 0 };
+
+    cache.insert( kd::id{ "1" }, "a", in( 10 ), NOW );
+    BOOST_REQUIRE_EQUAL( 0, cache.size() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()